@@ -0,0 +1,148 @@
+#include <epoxy/gl.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "shader.h"
+
+/* References
+ * ----------
+ * ARB_multi_draw_indirect
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_multi_draw_indirect.txt"
+ * ARB_shader_draw_parameters
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_shader_draw_parameters.txt"
+ */
+
+/* drawbase is 0 for multi draws, and the draw index when drawing one by one */
+static const char* batch_vert_src =
+"#version 460 core\n"
+"\n"
+"layout(location = 0) in vec3 pos;\n"
+"layout(location = 1) in vec3 clr_in;\n"
+"\n"
+"layout(location = 0) uniform int drawbase;\n"
+"\n"
+"layout(std430, binding = 0) readonly buffer drawdata {\n"
+"	vec4 xform[];\n"
+"};\n"
+"\n"
+"out vec3 clr;\n"
+"\n"
+"void main() {\n"
+"	vec4 x = xform[drawbase + gl_DrawID];\n"
+"	gl_Position = vec4(pos.xy * x.z + x.xy, pos.z, 1.0f);\n"
+"	clr = clr_in;\n"
+"}\n"
+;
+
+static const char* batch_frag_src =
+"#version 460 core\n"
+"\n"
+"in vec3 clr;\n"
+"\n"
+"out vec4 frag_clr;\n"
+"void main() {\n"
+"	frag_clr = vec4(clr, 1.0f);\n"
+"}\n"
+;
+
+/* Shader storage offsets must be aligned to at most this (GL spec maximum) */
+#define BATCH_ALIGN 256
+
+int f_batch_init(struct t_batch *b, unsigned int maxdraws) {
+	*b = (struct t_batch){ .maxdraws = maxdraws };
+
+	const size_t region = maxdraws * (sizeof(struct t_drawcmd) + sizeof(struct t_drawdata)) + BATCH_ALIGN;
+	if(f_stream_init(&b->sb, region)) return -1;
+
+	b->sp = f_program_load(batch_vert_src, batch_frag_src);
+	if(!b->sp) return f_batch_destroy(b), -2;
+
+	return 0;
+}
+
+void f_batch_destroy(struct t_batch *b) {
+	if(b->sb.buf) f_stream_destroy(&b->sb);
+	glDeleteProgram(b->sp);
+	glDeleteVertexArrays(1, &b->vao);
+	glDeleteBuffers(1, &b->vbo);
+	glDeleteBuffers(1, &b->ibo);
+
+	free(b->verts), free(b->idx), free(b->meshes);
+	*b = (struct t_batch){0};
+}
+
+/* Append a mesh to the shared buffers, returns its id or -1 */
+/* Indices are relative to the mesh's own vertices */
+int f_batch_addmesh(struct t_batch *b, const struct vert *v, unsigned int nv, const uint32_t *idx, unsigned int ni) {
+	struct vert *nverts = realloc(b->verts, (b->nverts + nv) * sizeof *v);
+	if(nverts) b->verts = nverts;
+	uint32_t *nidx = realloc(b->idx, (b->nidx + ni) * sizeof *idx);
+	if(nidx) b->idx = nidx;
+	struct t_batchmesh *nmeshes = realloc(b->meshes, (b->nmeshes + 1) * sizeof *nmeshes);
+	if(nmeshes) b->meshes = nmeshes;
+	if(!nverts || !nidx || !nmeshes) return -1;
+
+	memcpy(b->verts + b->nverts, v, nv * sizeof *v);
+	memcpy(b->idx + b->nidx, idx, ni * sizeof *idx);
+	b->meshes[b->nmeshes] = (struct t_batchmesh){ .count = ni, .first = b->nidx, .basevertex = b->nverts };
+
+	b->nverts += nv, b->nidx += ni;
+	return b->nmeshes++;
+}
+
+/* Move all added meshes into immutable GPU buffers */
+int f_batch_upload(struct t_batch *b) {
+	if(!b->nverts || !b->nidx) return -1;
+
+	glGenVertexArrays(1, &b->vao);
+	glBindVertexArray(b->vao);
+
+	glGenBuffers(1, &b->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+	glBufferStorage(GL_ARRAY_BUFFER, b->nverts * sizeof *b->verts, b->verts, 0);
+	f_vformat_apply(&vfmt_vert);
+
+	glGenBuffers(1, &b->ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b->ibo);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, b->nidx * sizeof *b->idx, b->idx, 0);
+
+	free(b->verts), free(b->idx);
+	b->verts = NULL, b->idx = NULL;
+	return 0;
+}
+
+/* Reserve this frame's command and draw data arrays */
+void f_batch_begin(struct t_batch *b) {
+	f_stream_begin(&b->sb);
+	b->ndraws = 0;
+	b->cmds = f_stream_alloc(&b->sb, b->maxdraws * sizeof *b->cmds, 4, &b->cmdoff);
+	b->data = f_stream_alloc(&b->sb, b->maxdraws * sizeof *b->data, BATCH_ALIGN, &b->dataoff);
+}
+
+/* Queue one draw of a mesh, returns -1 if the batch is full */
+int f_batch_draw(struct t_batch *b, unsigned int mesh, const struct t_drawdata *d) {
+	if(b->ndraws >= b->maxdraws || mesh >= b->nmeshes) return -1;
+
+	const struct t_batchmesh *m = &b->meshes[mesh];
+	b->cmds[b->ndraws] = (struct t_drawcmd){ m->count, 1, m->first, m->basevertex, b->ndraws };
+	b->data[b->ndraws] = *d;
+	b->ndraws++;
+	return 0;
+}
+
+/* Issue every queued draw with one multi draw call */
+void f_batch_submit(struct t_batch *b) {
+	if(b->ndraws) {
+		glUseProgram(b->sp);
+		glUniform1i(0, 0);
+		glBindVertexArray(b->vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, b->sb.buf);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, b->sb.buf, b->dataoff, b->ndraws * sizeof *b->data);
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)b->cmdoff, b->ndraws, 0);
+	}
+
+	f_stream_end(&b->sb);
+}
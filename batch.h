@@ -0,0 +1,57 @@
+#ifndef __H__BATCH_H___
+#define __H__BATCH_H___
+
+#include <stdint.h>
+
+#include "vertex.h"
+#include "stream.h"
+
+/* Location of a mesh inside the shared vertex and index buffers */
+struct t_batchmesh {
+	uint32_t count, first;
+	int32_t basevertex;
+};
+
+/* Layout fixed by glMultiDrawElementsIndirect */
+struct t_drawcmd {
+	uint32_t count, instances, first;
+	int32_t basevertex;
+	uint32_t baseinstance;
+};
+
+/* Per draw data, indexed with gl_DrawID in the vertex shader (std430) */
+/* Object space positions are scaled, then offset */
+struct t_drawdata {
+	float offset[2], scale, pad_;
+};
+
+/* Many meshes packed into one vertex and one index buffer, drawn with */
+/* a single glMultiDrawElementsIndirect per frame for one program */
+struct t_batch {
+	unsigned int vao, vbo, ibo, sp;
+
+	/* Mesh data staged on the CPU until f_batch_upload() */
+	struct vert *verts;
+	uint32_t *idx;
+	unsigned int nverts, nidx;
+
+	struct t_batchmesh *meshes;
+	unsigned int nmeshes;
+
+	/* Commands and draw data of the current frame, written straight into the stream buffer */
+	struct t_streambuf sb;
+	struct t_drawcmd *cmds;
+	struct t_drawdata *data;
+	size_t cmdoff, dataoff;
+	unsigned int ndraws, maxdraws;
+};
+
+int f_batch_init(struct t_batch *, unsigned int);
+void f_batch_destroy(struct t_batch *);
+int f_batch_addmesh(struct t_batch *, const struct vert *, unsigned int, const uint32_t *, unsigned int);
+int f_batch_upload(struct t_batch *);
+void f_batch_begin(struct t_batch *);
+int f_batch_draw(struct t_batch *, unsigned int, const struct t_drawdata *);
+void f_batch_submit(struct t_batch *);
+
+#endif
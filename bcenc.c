@@ -0,0 +1,334 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bcenc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+#endif
+
+#ifdef __SSE2__
+	#define BC_SSE 1
+#endif
+
+/* References
+ * ----------
+ * Khronos Data Format Specification 1.3, "S3TC Compressed Texture Image Formats",
+ * "RGTC Compressed Texture Image Formats", "BPTC Compressed Texture Image Formats"
+ * "https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html"
+ * S. Barrett, stb_dxt
+ * "https://github.com/nothings/stb/blob/master/stb_dxt.h"
+ * N. Reed, "Understanding BCn Texture Compression Formats"
+ * "https://www.reedbeta.com/blog/understanding-bcn-texture-compression-formats/"
+ */
+
+const char* const bcfmt_names[BCFMT_COUNT] = { "BC1", "BC3", "BC5", "BC7" };
+
+/* Blocks are fitted in float, one channel per row */
+struct t_bcblock {
+	float px[4][16];
+};
+
+size_t f_bc_blocksize(enum e_bcfmt fmt) {
+	return fmt == BCFMT_BC1 ? 8 : 16;
+}
+
+/* Bytes for a width x height image, partial blocks rounded up */
+size_t f_bc_size(enum e_bcfmt fmt, int width, int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * f_bc_blocksize(fmt);
+}
+
+static void f_bc_load(struct t_bcblock *b, const unsigned char *rgba) {
+	for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < 4; ++c) b->px[c][i] = rgba[i * 4 + c];
+}
+
+static void f_bc_bits(unsigned char *out, unsigned int *pos, uint32_t v, unsigned int n) {
+	for(unsigned int i = 0; i < n; ++i, ++*pos)
+		out[*pos >> 3] |= ((v >> i) & 1) << (*pos & 7);
+}
+
+
+/* ------------------------ *
+ * Endpoint and index fitting *
+ * ------------------------ */
+
+/* Principal axis of channels [c0, c0 + nch) through their mean (power iteration), */
+/* zero if the block is flat */
+static void f_bc_axis(const struct t_bcblock *b, int c0, int nch, float *mean, float *axis) {
+	float cov[4][4] = {{0}};
+	for(int c = 0; c < nch; ++c) {
+		mean[c] = 0;
+		for(int i = 0; i < 16; ++i) mean[c] += b->px[c0 + c][i];
+		mean[c] /= 16;
+	}
+	for(int i = 0; i < 16; ++i)
+		for(int c = 0; c < nch; ++c)
+			for(int d = 0; d < nch; ++d)
+				cov[c][d] += (b->px[c0 + c][i] - mean[c]) * (b->px[c0 + d][i] - mean[d]);
+
+	for(int c = 0; c < nch; ++c) axis[c] = 1;
+	for(int it = 0; it < 8; ++it) {
+		float v[4], len = 0;
+		for(int c = 0; c < nch; ++c) {
+			v[c] = 0;
+			for(int d = 0; d < nch; ++d) v[c] += cov[c][d] * axis[d];
+			len += v[c] * v[c];
+		}
+		len = sqrtf(len);
+		for(int c = 0; c < nch; ++c) axis[c] = len > 1e-6f ? v[c] / len : 0;
+	}
+}
+
+/* Position of every pixel between endpoints e0 and e1 in steps of 1 / (n - 1), */
+/* rounded and clamped to [0, n - 1] */
+static void f_bc_fit(const struct t_bcblock *b, int c0, int nch, const float *e0, const float *e1, int n, unsigned char *t) {
+	float d[4], len = 0;
+	for(int c = 0; c < nch; ++c) d[c] = e1[c] - e0[c], len += d[c] * d[c];
+	if(len < 1e-6f) {
+		memset(t, 0, 16);
+		return;
+	}
+	const float scale = (n - 1) / len;
+
+#ifdef BC_SSE
+	for(int i = 0; i < 16; i += 4) {
+		__m128 acc = _mm_setzero_ps();
+		for(int c = 0; c < nch; ++c) {
+			const __m128 p = _mm_sub_ps(_mm_loadu_ps(&b->px[c0 + c][i]), _mm_set1_ps(e0[c]));
+			acc = _mm_add_ps(acc, _mm_mul_ps(p, _mm_set1_ps(d[c])));
+		}
+		acc = _mm_min_ps(_mm_max_ps(_mm_mul_ps(acc, _mm_set1_ps(scale)), _mm_setzero_ps()), _mm_set1_ps(n - 1));
+
+		/* Rounds to nearest in the default MXCSR mode */
+		const __m128i q = _mm_cvtps_epi32(acc);
+		int32_t v[4];
+		_mm_storeu_si128((__m128i*)v, q);
+		for(int k = 0; k < 4; ++k) t[i + k] = v[k];
+	}
+#else
+	for(int i = 0; i < 16; ++i) {
+		float acc = 0;
+		for(int c = 0; c < nch; ++c) acc += (b->px[c0 + c][i] - e0[c]) * d[c];
+		acc *= scale;
+		t[i] = lrintf(acc < 0 ? 0 : acc > n - 1 ? n - 1 : acc);
+	}
+#endif
+}
+
+/* Least squares endpoints for the given positions, left as they are if degenerate */
+static void f_bc_refine(const struct t_bcblock *b, int c0, int nch, const unsigned char *t, int n, float *e0, float *e1) {
+	float aa = 0, ab = 0, bb = 0, x[4] = {0}, y[4] = {0};
+	for(int i = 0; i < 16; ++i) {
+		const float w = (float)t[i] / (n - 1), iw = 1 - w;
+		aa += iw * iw, ab += iw * w, bb += w * w;
+		for(int c = 0; c < nch; ++c) x[c] += iw * b->px[c0 + c][i], y[c] += w * b->px[c0 + c][i];
+	}
+
+	const float det = aa * bb - ab * ab;
+	if(fabsf(det) < 1e-6f) return;
+	for(int c = 0; c < nch; ++c) {
+		e0[c] = (bb * x[c] - ab * y[c]) / det;
+		e1[c] = (aa * y[c] - ab * x[c]) / det;
+	}
+}
+
+/* Endpoints at the extremes of the block's projection on its principal axis */
+static void f_bc_endpoints(const struct t_bcblock *b, int c0, int nch, float *e0, float *e1) {
+	float mean[4], axis[4], lo = 0, hi = 0;
+	f_bc_axis(b, c0, nch, mean, axis);
+
+	for(int i = 0; i < 16; ++i) {
+		float t = 0;
+		for(int c = 0; c < nch; ++c) t += (b->px[c0 + c][i] - mean[c]) * axis[c];
+		if(t < lo) lo = t;
+		if(t > hi) hi = t;
+	}
+	for(int c = 0; c < nch; ++c) e0[c] = mean[c] + lo * axis[c], e1[c] = mean[c] + hi * axis[c];
+}
+
+static int f_bc_clamp(float v, int hi) {
+	const long q = lrintf(v);
+	return q < 0 ? 0 : q > hi ? hi : (int)q;
+}
+
+
+/* ------------ *
+ * Block formats *
+ * ------------ */
+
+static uint16_t f_bc_565(const float *c) {
+	return f_bc_clamp(c[0] * 31 / 255, 31) << 11 | f_bc_clamp(c[1] * 63 / 255, 63) << 5 | f_bc_clamp(c[2] * 31 / 255, 31);
+}
+
+static void f_bc_565_decode(uint16_t v, float *c) {
+	const int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+	c[0] = r << 3 | r >> 2, c[1] = g << 2 | g >> 4, c[2] = b << 3 | b >> 2;
+}
+
+/* Four color mode only (c0 > c1), so there is no transparent index */
+static void f_bc1_color(unsigned char *out, const struct t_bcblock *b) {
+	static const unsigned char order[4] = { 0, 2, 3, 1 };
+
+	float e0[3], e1[3];
+	unsigned char t[16];
+	f_bc_endpoints(b, 0, 3, e0, e1);
+	f_bc_fit(b, 0, 3, e0, e1, 4, t);
+	f_bc_refine(b, 0, 3, t, 4, e0, e1);
+
+	uint16_t c0 = f_bc_565(e1), c1 = f_bc_565(e0);
+	if(c0 < c1) {
+		const uint16_t s = c0;
+		c0 = c1, c1 = s;
+	}
+
+	uint32_t idx = 0;
+	if(c0 != c1) {
+		f_bc_565_decode(c0, e0), f_bc_565_decode(c1, e1);
+		f_bc_fit(b, 0, 3, e0, e1, 4, t);
+		for(int i = 0; i < 16; ++i) idx |= (uint32_t)order[t[i]] << (2 * i);
+	}
+
+	const unsigned char blk[8] = { c0, c0 >> 8, c1, c1 >> 8, idx, idx >> 8, idx >> 16, idx >> 24 };
+	memcpy(out, blk, sizeof blk);
+}
+
+/* Eight value mode only (a0 > a1) */
+static void f_bc4_channel(unsigned char *out, const struct t_bcblock *b, int ch) {
+	static const unsigned char order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+	float e0, e1;
+	unsigned char t[16];
+	f_bc_endpoints(b, ch, 1, &e0, &e1);
+	f_bc_fit(b, ch, 1, &e1, &e0, 8, t);
+	f_bc_refine(b, ch, 1, t, 8, &e1, &e0);
+
+	int a0 = f_bc_clamp(e1, 255), a1 = f_bc_clamp(e0, 255);
+	if(a0 < a1) {
+		const int s = a0;
+		a0 = a1, a1 = s;
+	}
+
+	uint64_t idx = 0;
+	if(a0 != a1) {
+		e0 = a0, e1 = a1;
+		f_bc_fit(b, ch, 1, &e0, &e1, 8, t);
+		for(int i = 0; i < 16; ++i) idx |= (uint64_t)order[t[i]] << (3 * i);
+	}
+
+	out[0] = a0, out[1] = a1;
+	for(int i = 0; i < 6; ++i) out[2 + i] = idx >> (8 * i);
+}
+
+void f_bc1_block(unsigned char *out, const unsigned char *rgba) {
+	struct t_bcblock b;
+	f_bc_load(&b, rgba);
+	f_bc1_color(out, &b);
+}
+
+void f_bc3_block(unsigned char *out, const unsigned char *rgba) {
+	struct t_bcblock b;
+	f_bc_load(&b, rgba);
+	f_bc4_channel(out, &b, 3);
+	f_bc1_color(out + 8, &b);
+}
+
+void f_bc5_block(unsigned char *out, const unsigned char *rgba) {
+	struct t_bcblock b;
+	f_bc_load(&b, rgba);
+	f_bc4_channel(out, &b, 0);
+	f_bc4_channel(out + 8, &b, 1);
+}
+
+/* Nearest 7 bit value and p-bit for an 8 bit endpoint, shared p-bit over its channels */
+static void f_bc7_quantize(const float *e, int *q, int *p) {
+	float best = INFINITY;
+	for(int pb = 0; pb < 2; ++pb) {
+		int v[4];
+		float err = 0;
+		for(int c = 0; c < 4; ++c) {
+			v[c] = f_bc_clamp((e[c] - pb) / 2, 127);
+			const float d = (v[c] << 1 | pb) - e[c];
+			err += d * d;
+		}
+		if(err < best) best = err, *p = pb, memcpy(q, v, sizeof v);
+	}
+}
+
+/* Mode 6 only: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4 bit indices */
+void f_bc7_block(unsigned char *out, const unsigned char *rgba) {
+	struct t_bcblock b;
+	f_bc_load(&b, rgba);
+
+	float e0[4], e1[4];
+	unsigned char t[16];
+	f_bc_endpoints(&b, 0, 4, e0, e1);
+	f_bc_fit(&b, 0, 4, e0, e1, 16, t);
+	f_bc_refine(&b, 0, 4, t, 16, e0, e1);
+
+	int q0[4], q1[4], p0, p1;
+	f_bc7_quantize(e0, q0, &p0);
+	f_bc7_quantize(e1, q1, &p1);
+	for(int c = 0; c < 4; ++c) e0[c] = q0[c] << 1 | p0, e1[c] = q1[c] << 1 | p1;
+	f_bc_fit(&b, 0, 4, e0, e1, 16, t);
+
+	/* The first pixel's index has an implicit zero high bit */
+	if(t[0] >= 8) {
+		int s[4];
+		memcpy(s, q0, sizeof s), memcpy(q0, q1, sizeof s), memcpy(q1, s, sizeof s);
+		const int sp = p0;
+		p0 = p1, p1 = sp;
+		for(int i = 0; i < 16; ++i) t[i] = 15 - t[i];
+	}
+
+	unsigned int pos = 0;
+	memset(out, 0, 16);
+	f_bc_bits(out, &pos, 1 << 6, 7);
+	for(int c = 0; c < 4; ++c) f_bc_bits(out, &pos, q0[c], 7), f_bc_bits(out, &pos, q1[c], 7);
+	f_bc_bits(out, &pos, p0, 1), f_bc_bits(out, &pos, p1, 1);
+	for(int i = 0; i < 16; ++i) f_bc_bits(out, &pos, t[i], i ? 4 : 3);
+}
+
+
+/* ------------ *
+ * Whole images *
+ * ------------ */
+
+struct t_bcjob {
+	enum e_bcfmt fmt;
+	unsigned char *out;
+	const unsigned char *rgba;
+	int width, height;
+};
+
+/* Encode rows of blocks [begin, end), edge blocks repeat the last row and column */
+static void f_bc_rows(void *data, unsigned long begin, unsigned long end) {
+	const struct t_bcjob *j = data;
+	void (*const enc[BCFMT_COUNT])(unsigned char *, const unsigned char *) = {
+		f_bc1_block, f_bc3_block, f_bc5_block, f_bc7_block
+	};
+	const int bw = (j->width + 3) / 4;
+	const size_t bs = f_bc_blocksize(j->fmt);
+
+	for(unsigned long by = begin; by < end; ++by)
+		for(int bx = 0; bx < bw; ++bx) {
+			unsigned char px[64];
+			for(int y = 0; y < 4; ++y)
+				for(int x = 0; x < 4; ++x) {
+					const int sx = bx * 4 + x < j->width ? bx * 4 + x : j->width - 1;
+					const int sy = (int)by * 4 + y < j->height ? (int)by * 4 + y : j->height - 1;
+					memcpy(px + (y * 4 + x) * 4, j->rgba + ((size_t)sy * j->width + sx) * 4, 4);
+				}
+			enc[j->fmt](j->out + (by * bw + bx) * bs, px);
+		}
+}
+
+/* Encode an RGBA8 image into f_bc_size bytes, split by rows of blocks over the job system if given */
+void f_bc_encode(enum e_bcfmt fmt, unsigned char *out, const unsigned char *rgba, int width, int height, struct t_jobsys *js) {
+	struct t_bcjob j = { fmt, out, rgba, width, height };
+	const unsigned long rows = (height + 3) / 4;
+
+	if(js) f_jobs_parallel_for(js, rows, 4, f_bc_rows, &j);
+	else f_bc_rows(&j, 0, rows);
+}
@@ -0,0 +1,23 @@
+#ifndef __H__BCENC_H___
+#define __H__BCENC_H___
+
+#include <stddef.h>
+
+#include "jobs.h"
+
+/* GPU block compression formats, all on 4x4 pixel blocks */
+/* BC1: RGB, 8 bytes - BC3: BC1 color + BC4 alpha, 16 bytes */
+/* BC5: two BC4 channels (normal map XY), 16 bytes - BC7: RGBA, 16 bytes */
+enum e_bcfmt { BCFMT_BC1, BCFMT_BC3, BCFMT_BC5, BCFMT_BC7, BCFMT_COUNT };
+
+extern const char* const bcfmt_names[BCFMT_COUNT];
+
+size_t f_bc_blocksize(enum e_bcfmt);
+size_t f_bc_size(enum e_bcfmt, int, int);
+void f_bc1_block(unsigned char *, const unsigned char *);
+void f_bc3_block(unsigned char *, const unsigned char *);
+void f_bc5_block(unsigned char *, const unsigned char *);
+void f_bc7_block(unsigned char *, const unsigned char *);
+void f_bc_encode(enum e_bcfmt, unsigned char *, const unsigned char *, int, int, struct t_jobsys *);
+
+#endif
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+
+#include "bench.h"
+
+static int f_cmp_double(const void *a, const void *b) {
+	const double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* Compute summary statistics - sorts the samples in place */
+/* Percentiles use the nearest-rank method */
+void f_bench_stats(double *samples, unsigned int n, struct t_bench_stats *st) {
+	*st = (struct t_bench_stats){ .n = n };
+	if(!n) return;
+
+	qsort(samples, n, sizeof *samples, f_cmp_double);
+
+	double sum = 0;
+	for(unsigned int i = 0; i < n; ++i) sum += samples[i];
+
+	st->min = samples[0];
+	st->max = samples[n-1];
+	st->median = samples[(n-1) / 2];
+	st->p99 = samples[(n * 99 + 99) / 100 - 1];
+	st->mean = sum / n;
+}
+
+void f_bench_print(FILE *f, const char *name, const struct t_bench_stats *st) {
+	fprintf(f, "%s: n = %u, min = %.3f ms, median = %.3f ms, p99 = %.3f ms, max = %.3f ms, mean = %.3f ms\n",
+		name, st->n, st->min * 1e3, st->median * 1e3, st->p99 * 1e3, st->max * 1e3, st->mean * 1e3);
+}
@@ -0,0 +1,15 @@
+#ifndef __H__BENCH_H___
+#define __H__BENCH_H___
+
+#include <stdio.h>
+
+/* Summary of a set of timing samples (all values in seconds) */
+struct t_bench_stats {
+	double min, median, p99, max, mean;
+	unsigned int n;
+};
+
+void f_bench_stats(double *, unsigned int, struct t_bench_stats *);
+void f_bench_print(FILE *, const char *, const struct t_bench_stats *);
+
+#endif
@@ -0,0 +1,1246 @@
+#define _DEFAULT_SOURCE
+#include <epoxy/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "benchmarks.h"
+#include "window.h"
+#include "render.h"
+#include "headless.h"
+#include "bench.h"
+#include "clock.h"
+#include "stream.h"
+#include "vertex.h"
+#include "batch.h"
+#include "instance.h"
+#include "shader.h"
+#include "cmdqueue.h"
+#include "vecmath.h"
+#include "cull.h"
+#include "scene.h"
+#include "jobs.h"
+#include "mesh.h"
+#include "meshbin.h"
+#include "meshopt.h"
+#include "texture.h"
+#include "bcenc.h"
+#include "texbin.h"
+#include "pacing.h"
+
+/* Stream CPU generated vertices through the persistent mapped buffer */
+/* Arguments: [megabytes per frame] [frames] */
+int f_bench_stream(int argc, char* argv[]) {
+	const int mb = argc > 0 ? atoi(argv[0]) : 32;
+	const int frames = argc > 1 ? atoi(argv[1]) : 300;
+	if(mb <= 0 || frames <= 0) return -1;
+
+	struct t_render_state rs;
+	if(f_render_init(&rs, NULL)) return -2;
+
+	struct t_streambuf sb;
+	if(f_stream_init(&sb, (size_t)mb << 20)) return f_render_destroy(&rs), fprintf(stderr, "Unable to map stream buffer\n"), -2;
+
+	/* Vertex array reading struct vert from the stream buffer */
+	unsigned int vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, sb.buf);
+	f_vformat_apply(&vfmt_vert);
+
+	/* Degenerate triangles, so only vertex fetch and transform is measured */
+	const size_t chunk = 3 * 21845;
+	double *ft = malloc(frames * sizeof *ft);
+	if(!ft) return -3;
+
+	const double start = f_clock_now();
+	for(int i = 0; i < frames; ++i) {
+		const double t0 = f_clock_now();
+		f_stream_begin(&sb);
+
+		size_t off;
+		struct vert *v;
+		while((v = f_stream_alloc(&sb, chunk * sizeof *v, sizeof *v, &off))) {
+			for(size_t j = 0; j < chunk; ++j)
+				v[j] = (struct vert){ { i, i, 0 }, { j, j >> 8, i } };
+			glDrawArrays(GL_TRIANGLES, off / sizeof *v, chunk);
+		}
+
+		f_stream_end(&sb);
+		ft[i] = f_clock_now() - t0;
+	}
+	glFinish();
+	const double total = f_clock_now() - start;
+
+	struct t_bench_stats st;
+	f_bench_stats(ft, frames, &st);
+	f_bench_print(stdout, "CPU frame time", &st);
+	printf("Streamed %d MB/frame, %.1f MB/s overall, %lu/%d frames stalled on fences\n",
+		mb, (double)mb * frames / total, sb.stalls, frames);
+
+	free(ft);
+	glDeleteVertexArrays(1, &vao);
+	f_stream_destroy(&sb);
+	f_render_destroy(&rs);
+	return 0;
+}
+
+/* Submit a grid of small meshes, one draw call per object versus one multi draw */
+/* Arguments: [objects] [frames] */
+int f_bench_mdi(int argc, char* argv[]) {
+	const int objects = argc > 0 ? atoi(argv[0]) : 10000;
+	const int frames = argc > 1 ? atoi(argv[1]) : 100;
+	if(objects <= 0 || frames <= 0) return -1;
+
+	struct t_batch b;
+	if(f_batch_init(&b, objects)) return fprintf(stderr, "Unable to create batch\n"), -2;
+
+	const struct vert quad[] = {
+		{ { -1, -1, 0 }, { 0xFF, 0xFF, 0x00 } },
+		{ {  1, -1, 0 }, { 0x00, 0xFF, 0xFF } },
+		{ {  1,  1, 0 }, { 0xFF, 0x00, 0xFF } },
+		{ { -1,  1, 0 }, { 0xFF, 0xFF, 0xFF } },
+	};
+	const uint32_t tri_idx[] = { 0, 1, 2 }, quad_idx[] = { 0, 1, 2, 0, 2, 3 };
+	f_batch_addmesh(&b, vertices, 3, tri_idx, 3);
+	f_batch_addmesh(&b, quad, 4, quad_idx, 6);
+	f_batch_upload(&b);
+
+	int side = 1;
+	while(side * side < objects) side++;
+
+	double *cpu = malloc(frames * sizeof *cpu), *ft = malloc(frames * sizeof *ft);
+	if(!cpu || !ft) return free(cpu), free(ft), f_batch_destroy(&b), -3;
+
+	const char* const names[] = { "glDrawElementsBaseVertex loop", "glMultiDrawElementsIndirect" };
+	for(int multi = 0; multi < 2; ++multi) {
+		for(int i = 0; i < frames; ++i) {
+			const double t0 = f_clock_now();
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			f_batch_begin(&b);
+			for(int j = 0; j < objects; ++j) {
+				const struct t_drawdata d = {
+					{ (2.0f * (j % side) + 1) / side - 1, (2.0f * (j / side) + 1) / side - 1 },
+					0.8f / side, 0
+				};
+				f_batch_draw(&b, j & 1, &d);
+			}
+
+			const double t1 = f_clock_now();
+			if(multi) {
+				f_batch_submit(&b);
+			} else {
+				glUseProgram(b.sp);
+				glBindVertexArray(b.vao);
+				glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, b.sb.buf, b.dataoff, b.ndraws * sizeof *b.data);
+				for(unsigned int j = 0; j < b.ndraws; ++j) {
+					const struct t_drawcmd *c = &b.cmds[j];
+					glUniform1i(0, j);
+					glDrawElementsBaseVertex(GL_TRIANGLES, c->count, GL_UNSIGNED_INT,
+						(void*)(c->first * sizeof(uint32_t)), c->basevertex);
+				}
+				f_stream_end(&b.sb);
+			}
+			cpu[i] = f_clock_now() - t1;
+
+			glFinish();
+			ft[i] = f_clock_now() - t0;
+		}
+
+		struct t_bench_stats st;
+		printf("%s, %d objects:\n", names[multi], objects);
+		f_bench_stats(cpu, frames, &st);
+		f_bench_print(stdout, "  CPU submission", &st);
+		f_bench_stats(ft, frames, &st);
+		f_bench_print(stdout, "  Frame time", &st);
+	}
+
+	free(cpu), free(ft);
+	f_batch_destroy(&b);
+	return 0;
+}
+
+/* Instanced triangles, scaling from 1 to [max instances] by powers of 10 */
+/* Arguments: [max instances] [frames] */
+int f_bench_instance(int argc, char* argv[]) {
+	const int maxinst = argc > 0 ? atoi(argv[0]) : 1000000;
+	const int frames = argc > 1 ? atoi(argv[1]) : 50;
+	if(maxinst <= 0 || frames <= 0) return -1;
+
+	struct t_instmesh im;
+	if(f_instmesh_init(&im, vertices, 3, NULL, 0, maxinst))
+		return fprintf(stderr, "Unable to create instanced mesh\n"), -2;
+
+	double *ft = malloc(frames * sizeof *ft);
+	if(!ft) return f_instmesh_destroy(&im), -3;
+
+	for(long n = 1;; n *= 10) {
+		if(n > maxinst) n = maxinst;
+
+		int side = 1;
+		while((long)side * side < n) side++;
+
+		for(int i = 0; i < frames; ++i) {
+			const double t0 = f_clock_now();
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			struct t_instance *inst = f_instmesh_begin(&im);
+			for(long j = 0; j < n; ++j)
+				inst[j] = (struct t_instance){
+					{ (2.0f * (j % side) + 1) / side - 1, (2.0f * (j / side) + 1) / side - 1, 0.8f / side, 0.01f * i },
+					{ 0xFF, j, j >> 8, 0xFF }
+				};
+			f_instmesh_draw(&im, n);
+
+			glFinish();
+			ft[i] = f_clock_now() - t0;
+		}
+
+		struct t_bench_stats st;
+		f_bench_stats(ft, frames, &st);
+		printf("%8ld instances: median = %.3f ms, p99 = %.3f ms, %.2f ns/instance\n",
+			n, st.median * 1e3, st.p99 * 1e3, st.median * 1e9 / n);
+
+		if(n == maxinst) break;
+	}
+
+	free(ft);
+	f_instmesh_destroy(&im);
+	return 0;
+}
+
+/* Program startup cost with a cold and a warm binary cache */
+/* Programs are unique variants of the main shaders, in a throwaway cache directory */
+/* Arguments: [programs] */
+int f_bench_progcache(int argc, char* argv[]) {
+	const int nprog = argc > 0 ? atoi(argv[0]) : 64;
+	if(nprog <= 0) return -1;
+
+	char dir[] = "/tmp/render-progcache-XXXXXX";
+	if(!mkdtemp(dir)) return fprintf(stderr, "Unable to create cache directory\n"), -2;
+	setenv("RENDER_SHADER_CACHE", dir, 1);
+
+	/* The nonce keeps the driver's own shader cache from hiding the cold compile */
+	char (*vs)[1024] = malloc(nprog * sizeof *vs);
+	unsigned int *sp = malloc(nprog * sizeof *sp);
+	if(!vs || !sp) return free(vs), free(sp), -3;
+
+	char *vert_src = f_shader_read(MAIN_VERT), *frag_src = f_shader_read(MAIN_FRAG);
+	if(!vert_src || !frag_src) return free(vert_src), free(frag_src), free(vs), free(sp), -4;
+
+	const long nonce = (long)(f_clock_now() * 1e6);
+	for(int i = 0; i < nprog; ++i)
+		snprintf(vs[i], sizeof *vs, "%s// variant %d/%ld\n", vert_src, i, nonce);
+
+	const char* const names[] = { "Cold cache", "Warm cache" };
+	for(int pass = 0; pass < 2; ++pass) {
+		const unsigned long hits = atomic_load(&progcache_stats.hits), misses = atomic_load(&progcache_stats.misses);
+		const unsigned long rejected = atomic_load(&progcache_stats.rejected);
+		const double t0 = f_clock_now();
+
+		for(int i = 0; i < nprog; ++i) sp[i] = f_program_load(vs[i], frag_src);
+
+		const double t = f_clock_now() - t0;
+		printf("%s: %d programs in %.2f ms (%.3f ms/program), %lu hits, %lu misses, %lu rejected\n",
+			names[pass], nprog, t * 1e3, t * 1e3 / nprog,
+			atomic_load(&progcache_stats.hits) - hits, atomic_load(&progcache_stats.misses) - misses,
+			atomic_load(&progcache_stats.rejected) - rejected);
+
+		for(int i = 0; i < nprog; ++i) glDeleteProgram(sp[i]);
+	}
+
+	for(int i = 0; i < nprog; ++i) {
+		char path[sizeof dir + 32];
+		snprintf(path, sizeof path, "%s/%016llx.bin", dir, (unsigned long long)f_program_key(vs[i], frag_src));
+		remove(path);
+	}
+	remove(dir);
+
+	free(vert_src), free(frag_src);
+	free(vs), free(sp);
+	return 0;
+}
+
+/* Build unique variants of the main program one at a time, then all at once */
+/* (compiles and links issued up front, statuses checked as they complete) */
+/* Arguments: [programs] */
+int f_bench_progbuild(int argc, char* argv[]) {
+	const int nprog = argc > 0 ? atoi(argv[0]) : 64;
+	if(nprog <= 0) return -1;
+
+	char (*vs)[1024] = malloc(2 * nprog * sizeof *vs);
+	struct t_progreq *req = malloc(nprog * sizeof *req);
+	char *vert_src = f_shader_read(MAIN_VERT), *frag_src = f_shader_read(MAIN_FRAG);
+	if(!vs || !req || !vert_src || !frag_src) return free(vs), free(req), free(vert_src), free(frag_src), -2;
+
+	/* Every program is unique, so neither the driver's nor our cache can help */
+	const long nonce = (long)(f_clock_now() * 1e6);
+	for(int i = 0; i < 2 * nprog; ++i)
+		snprintf(vs[i], sizeof *vs, "%s// variant %d/%ld\n", vert_src, i, nonce);
+
+	const char* const names[] = { "Serial", "Batched" };
+	for(int pass = 0; pass < 2; ++pass) {
+		for(int i = 0; i < nprog; ++i)
+			req[i] = (struct t_progreq){ .vs = vs[pass * nprog + i], .fs = frag_src, .nocache = 1 };
+
+		const double t0 = f_clock_now();
+		unsigned int failed = 0;
+		if(pass) {
+			f_program_begin(req, nprog);
+			failed = f_program_wait(req, nprog);
+		} else {
+			for(int i = 0; i < nprog; ++i)
+				f_program_begin(&req[i], 1), failed += f_program_wait(&req[i], 1);
+		}
+		const double t = f_clock_now() - t0;
+
+		printf("%s: %d programs in %.2f ms (%.3f ms/program), %u failed\n",
+			names[pass], nprog, t * 1e3, t * 1e3 / nprog, failed);
+
+		for(int i = 0; i < nprog; ++i) glDeleteProgram(req[i].sp);
+	}
+
+	free(vert_src), free(frag_src);
+	free(vs), free(req);
+	return 0;
+}
+
+static void f_bench_material(unsigned int material, void *user) {
+	(void)material, (void)user;
+}
+
+/* Draws with random programs, vertex arrays and materials, executed */
+/* in submission order versus sorted by key */
+/* Arguments: [draws] [frames] */
+int f_bench_cmdqueue(int argc, char* argv[]) {
+	const int ndraws = argc > 0 ? atoi(argv[0]) : 20000;
+	const int frames = argc > 1 ? atoi(argv[1]) : 10;
+	if(ndraws <= 0 || frames <= 0) return -1;
+
+	enum { NPROGS = 4, NVAOS = 16, NMATERIALS = 64 };
+
+	char *vert_src = f_shader_read(MAIN_VERT), *frag_src = f_shader_read(MAIN_FRAG);
+	if(!vert_src || !frag_src) return free(vert_src), free(frag_src), -2;
+
+	char vs[NPROGS][1024];
+	struct t_progreq req[NPROGS];
+	for(int i = 0; i < NPROGS; ++i) {
+		snprintf(vs[i], sizeof *vs, "%s// variant %d\n", vert_src, i);
+		req[i] = (struct t_progreq){ .vs = vs[i], .fs = frag_src };
+	}
+	f_program_begin(req, NPROGS);
+	const unsigned int failed = f_program_wait(req, NPROGS);
+	free(vert_src), free(frag_src);
+	if(failed) return -3;
+
+	unsigned int vbo, vao[NVAOS];
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof vertices, vertices, GL_STATIC_DRAW);
+	glGenVertexArrays(NVAOS, vao);
+	for(int i = 0; i < NVAOS; ++i) glBindVertexArray(vao[i]), f_vformat_apply(&vfmt_vert);
+
+	struct t_cmdqueue q;
+	if(f_cmdq_init(&q, ndraws, f_bench_material, NULL)) return -4;
+
+	double *tsort = malloc(frames * sizeof *tsort), *texec = malloc(frames * sizeof *texec);
+	if(!tsort || !texec) return free(tsort), free(texec), f_cmdq_destroy(&q), -5;
+
+	const char* const names[] = { "Submission order", "Sorted by key" };
+	for(int sorted = 0; sorted < 2; ++sorted) {
+		uint32_t rng = 12345;
+		for(int i = 0; i < frames; ++i) {
+			for(int j = 0; j < ndraws; ++j) {
+				rng = rng * 1664525 + 1013904223;
+				const struct t_drawpacket p = {
+					.sp = req[(rng >> 8) % NPROGS].sp, .vao = vao[(rng >> 12) % NVAOS],
+					.material = (rng >> 16) % NMATERIALS,
+					.mode = GL_TRIANGLES, .count = 3, .instances = 1
+				};
+				f_cmdq_push(&q, f_cmdkey(0, p.sp, p.material, p.vao, (rng >> 24) / 255.0f), &p);
+			}
+
+			const double t0 = f_clock_now();
+			if(sorted) f_cmdq_sort(&q);
+			const double t1 = f_clock_now();
+			f_cmdq_execute(&q);
+			glFinish();
+
+			tsort[i] = t1 - t0, texec[i] = f_clock_now() - t1;
+		}
+
+		struct t_bench_stats st;
+		printf("%s, %d draws: %u programs, %u vertex arrays, %u materials bound per frame\n",
+			names[sorted], ndraws, q.stats.programs, q.stats.vaos, q.stats.materials);
+		if(sorted) f_bench_stats(tsort, frames, &st), f_bench_print(stdout, "  Sort", &st);
+		f_bench_stats(texec, frames, &st);
+		f_bench_print(stdout, "  Execute", &st);
+	}
+
+	free(tsort), free(texec);
+	f_cmdq_destroy(&q);
+	glDeleteVertexArrays(NVAOS, vao);
+	glDeleteBuffers(1, &vbo);
+	for(int i = 0; i < NPROGS; ++i) glDeleteProgram(req[i].sp);
+	return 0;
+}
+
+/* Transform points by a matrix: scalar reference versus SIMD, AoS and SoA layouts */
+/* Arguments: [points] [iterations] */
+int f_bench_vecmath(int argc, char* argv[]) {
+	const long n = argc > 0 ? atol(argv[0]) : 1 << 20;
+	const int iters = argc > 1 ? atoi(argv[1]) : 20;
+	if(n <= 0 || iters <= 0) return -1;
+
+	struct t_vec3 *aos = malloc(n * sizeof *aos);
+	struct t_vec4 *out[2] = { aligned_alloc(16, n * sizeof **out), aligned_alloc(16, n * sizeof **out) };
+	float *soa = malloc(n * 7 * sizeof *soa), *ref = malloc(n * 4 * sizeof *ref);
+	if(!aos || !out[0] || !out[1] || !soa || !ref) return -2;
+
+	const struct t_soa3 in = { soa, soa + n, soa + 2*n };
+	const struct t_soa4 o = { soa + 3*n, soa + 4*n, soa + 5*n, soa + 6*n };
+	const struct t_soa4 oref = { ref, ref + n, ref + 2*n, ref + 3*n };
+
+	uint32_t rng = 1;
+	for(long i = 0; i < n; ++i) {
+		float *p = &aos[i].x;
+		for(int c = 0; c < 3; ++c) {
+			rng = rng * 1664525 + 1013904223;
+			p[c] = (rng >> 8) * (200.0f / (1 << 24)) - 100;
+		}
+		in.x[i] = aos[i].x, in.y[i] = aos[i].y, in.z[i] = aos[i].z;
+	}
+
+	const struct t_quat rot = f_quat_axisangle((struct t_vec3){ 1, 2, 3 }, 0.7f);
+	const struct t_mat4 model = f_mat4_trs((struct t_vec3){ 1, -2, 5 }, rot, (struct t_vec3){ 2, 2, 2 });
+	const struct t_mat4 view = f_mat4_lookat((struct t_vec3){ 0, 0, 300 }, (struct t_vec3){ 0, 0, 0 }, (struct t_vec3){ 0, 1, 0 });
+	const struct t_mat4 proj = f_mat4_perspective(1.0f, 4.0f / 3, 0.1f, 1000);
+	const struct t_mat4 vp = f_mat4_mul(&proj, &view), mvp = f_mat4_mul(&vp, &model);
+
+	double *t = malloc(iters * sizeof *t);
+	if(!t) return -3;
+
+	printf("%ld points, AVX2 + FMA %s\n", n, f_vecmath_avx2() ? "available" : "unavailable");
+	for(int k = 0; k < 4; ++k) {
+		for(int i = 0; i < iters; ++i) {
+			const double t0 = f_clock_now();
+			switch(k) {
+				case 0: f_mat4_transform_aos_ref(&mvp, aos, out[0], n); break;
+				case 1: f_mat4_transform_aos(&mvp, aos, out[1], n); break;
+				case 2: f_mat4_transform_soa_ref(&mvp, in, oref, n); break;
+				case 3: f_mat4_transform_soa(&mvp, in, o, n); break;
+			}
+			t[i] = f_clock_now() - t0;
+		}
+
+		/* SIMD results against the scalar reference, error relative to |w| */
+		double err = 0;
+		for(long i = 0; (k & 1) && i < n; ++i) {
+			const float *r = &out[0][i].x, *v = &out[1][i].x;
+			float rs[4], vs[4];
+			if(k == 3) {
+				rs[0] = oref.x[i], rs[1] = oref.y[i], rs[2] = oref.z[i], rs[3] = oref.w[i];
+				vs[0] = o.x[i], vs[1] = o.y[i], vs[2] = o.z[i], vs[3] = o.w[i];
+				r = rs, v = vs;
+			}
+			for(int c = 0; c < 4; ++c) err = fmax(err, fabs(v[c] - r[c]) / (fabs(r[3]) + 1));
+		}
+
+		const char* const names[] = { "AoS scalar", "AoS SSE", "SoA scalar", "SoA AVX2" };
+		struct t_bench_stats st;
+		f_bench_stats(t, iters, &st);
+		printf("%-10s: median = %.3f ms, %.2f Mpoints/s, max error %.2e\n",
+			names[k], st.median * 1e3, n / st.median * 1e-6, err);
+	}
+
+	free(t), free(aos), free(out[0]), free(out[1]), free(soa), free(ref);
+	return 0;
+}
+
+/* Cull randomly placed objects against a camera frustum */
+/* Arguments: [objects] [iterations] */
+int f_bench_cull(int argc, char* argv[]) {
+	const long n = argc > 0 ? atol(argv[0]) : 1000000;
+	const int iters = argc > 1 ? atoi(argv[1]) : 100;
+	if(n <= 0 || iters <= 0) return -1;
+
+	struct t_cullset cs;
+	uint32_t *vis[2] = {
+		malloc((n + CULL_SLACK) * sizeof **vis),
+		malloc((n + CULL_SLACK) * sizeof **vis),
+	};
+	double *t = malloc(iters * sizeof *t);
+	if(f_cullset_init(&cs, n) || !vis[0] || !vis[1] || !t)
+		return free(vis[0]), free(vis[1]), free(t), f_cullset_destroy(&cs), -3;
+
+	uint32_t rng = 1;
+	for(long i = 0; i < n; ++i) {
+		float p[6];
+		for(int c = 0; c < 6; ++c) {
+			rng = rng * 1664525 + 1013904223;
+			p[c] = (rng >> 8) * (1.0f / (1 << 24));
+		}
+		f_cullset_add(&cs,
+			(struct t_vec3){ p[0] * 400 - 200, p[1] * 400 - 200, p[2] * 400 - 200 },
+			(struct t_vec3){ p[3] * 2 + 0.1f, p[4] * 2 + 0.1f, p[5] * 2 + 0.1f });
+	}
+
+	const struct t_mat4 view = f_mat4_lookat((struct t_vec3){ 0, 0, 150 }, (struct t_vec3){ 0, 0, 0 }, (struct t_vec3){ 0, 1, 0 });
+	const struct t_mat4 proj = f_mat4_perspective(1.0f, 16.0f / 9, 0.1f, 300);
+	const struct t_mat4 vp = f_mat4_mul(&proj, &view);
+	struct t_frustum fr;
+	f_frustum_extract(&fr, &vp);
+
+	printf("%ld objects, AVX2 + FMA %s\n", n, f_vecmath_avx2() ? "available" : "unavailable");
+	unsigned long nvis[2];
+	for(int k = 0; k < 4; ++k) {
+		for(int i = 0; i < iters; ++i) {
+			const double t0 = f_clock_now();
+			switch(k) {
+				case 0: nvis[0] = f_cull_spheres_ref(&fr, &cs, vis[0]); break;
+				case 1: nvis[1] = f_cull_spheres(&fr, &cs, vis[1]); break;
+				case 2: nvis[0] = f_cull_aabbs_ref(&fr, &cs, vis[0]); break;
+				case 3: nvis[1] = f_cull_aabbs(&fr, &cs, vis[1]); break;
+			}
+			t[i] = f_clock_now() - t0;
+		}
+
+		/* SIMD visible lists must match the scalar reference exactly */
+		const char *match = "";
+		if(k & 1) match = nvis[0] == nvis[1] && !memcmp(vis[0], vis[1], nvis[0] * sizeof **vis) ? ", matches reference" : ", MISMATCH";
+
+		const char* const names[] = { "Sphere scalar", "Sphere AVX2", "AABB scalar", "AABB AVX2" };
+		struct t_bench_stats st;
+		f_bench_stats(t, iters, &st);
+		printf("%-13s: min = %.3f ms, median = %.3f ms, p99 = %.3f ms, %lu visible%s\n",
+			names[k], st.min * 1e3, st.median * 1e3, st.p99 * 1e3, nvis[k & 1], match);
+	}
+
+	free(vis[0]), free(vis[1]), free(t);
+	f_cullset_destroy(&cs);
+	return 0;
+}
+
+/* Transform hierarchy updates: nothing changed, random nodes changed, */
+/* the root changed, and a full recompute for reference - an update only */
+/* walks the subtrees of changed nodes, so its cost per updated node stays flat */
+/* Arguments: [nodes] [frames] */
+int f_bench_scene(int argc, char* argv[]) {
+	const long n = argc > 0 ? atol(argv[0]) : 100000;
+	const int frames = argc > 1 ? atoi(argv[1]) : 100;
+	if(n <= 0 || frames <= 0) return -1;
+
+	struct t_scene sc;
+	double *t = malloc(frames * sizeof *t);
+	if(f_scene_init(&sc, n) || !t) return free(t), f_scene_destroy(&sc), -3;
+
+	/* Random tree - each node picks a parent among the nodes added before it */
+	uint32_t rng = 1;
+	for(long i = 0; i < n; ++i) {
+		rng = rng * 1664525 + 1013904223;
+		const struct t_mat4 local = f_mat4_trs((struct t_vec3){ 1, 0, 0 },
+			f_quat_axisangle((struct t_vec3){ 0, 1, 0 }, (rng >> 8) * (1.0f / (1 << 24))), (struct t_vec3){ 1, 1, 1 });
+		f_scene_add(&sc, i ? (long)((rng >> 8) % i) : -1, &local);
+	}
+
+	double t0 = f_clock_now();
+	if(f_scene_sort(&sc, NULL)) return free(t), f_scene_destroy(&sc), -3;
+	printf("%ld nodes, depth first sort in %.3f ms\n", n, (f_clock_now() - t0) * 1e3);
+
+	/* The sort marks every node dirty, settle it outside the timed frames */
+	f_scene_update(&sc, NULL);
+
+	const char* const names[] = { "Static", "0.1% changed", "1% changed", "Root changed", "Full recompute" };
+	const long changes[] = { 0, n / 1000, n / 100, 0, 0 };
+	for(int k = 0; k < 5; ++k) {
+		unsigned long updated = 0, roots = 0;
+		for(int i = 0; i < frames; ++i) {
+			for(long j = 0; j < changes[k]; ++j) {
+				rng = rng * 1664525 + 1013904223;
+				const unsigned long o = (rng >> 8) % n;
+				f_scene_setlocal(&sc, o, &sc.local[o]);
+			}
+			if(k == 3) f_scene_setlocal(&sc, 0, &sc.local[0]);
+
+			roots = sc.nroots;
+			t0 = f_clock_now();
+			if(k == 4) f_scene_update_all(&sc), updated = n;
+			else updated = f_scene_update(&sc, NULL);
+			t[i] = f_clock_now() - t0;
+		}
+
+		struct t_bench_stats st;
+		f_bench_stats(t, frames, &st);
+		printf("%-14s: median = %.3f ms, p99 = %.3f ms, %lu subtrees, %lu nodes updated, %.1f ns per node\n",
+			names[k], st.median * 1e3, st.p99 * 1e3, roots, updated, updated ? st.median * 1e9 / updated : 0);
+	}
+
+	free(t);
+	f_scene_destroy(&sc);
+	return 0;
+}
+
+/* Job system scaling: every frame animates and culls a set of objects */
+/* in chunks, with 1 up to [threads] workers */
+/* Arguments: [threads] [objects] [frames] */
+struct t_jobbench {
+	struct t_cullset cs;
+	struct t_aabb *bounds;
+	struct t_mat4 model;
+	struct t_frustum fr;
+	uint32_t *visible;
+	unsigned long *nvisible;
+};
+
+#define JOBBENCH_CHUNK 8192
+
+/* Animate and cull chunks [cbegin, cend) of JOBBENCH_CHUNK objects */
+void f_jobbench_chunk(void *data, unsigned long cbegin, unsigned long cend) {
+	struct t_jobbench *jb = data;
+	for(unsigned long c = cbegin; c < cend; ++c) {
+		const unsigned long begin = c * JOBBENCH_CHUNK;
+		const unsigned long end = jb->cs.n - begin > JOBBENCH_CHUNK ? begin + JOBBENCH_CHUNK : jb->cs.n;
+		for(unsigned long i = begin; i < end; ++i) {
+			const struct t_aabb wb = f_aabb_transform(&jb->model, jb->bounds[i]);
+			f_cullset_set(&jb->cs, i, wb.c, wb.e);
+		}
+		jb->nvisible[c] = f_cull_spheres_part(&jb->fr, &jb->cs, begin, end, jb->visible + c * (JOBBENCH_CHUNK + CULL_SLACK));
+	}
+}
+
+void f_jobbench_empty(void *data, unsigned long begin, unsigned long end) {
+	(void)data, (void)begin, (void)end;
+}
+
+int f_bench_jobs(int argc, char* argv[]) {
+	const int maxthreads = argc > 0 ? atoi(argv[0]) : (int)f_jobs_cores();
+	const long n = argc > 1 ? atol(argv[1]) : 1000000;
+	const int frames = argc > 2 ? atoi(argv[2]) : 50;
+	if(maxthreads <= 0 || maxthreads > JOBS_MAXTHREADS || n <= 0 || frames <= 0) return -1;
+
+	struct t_jobbench jb;
+	const unsigned long nchunks = (n + JOBBENCH_CHUNK - 1) / JOBBENCH_CHUNK;
+	jb.bounds = malloc(n * sizeof *jb.bounds);
+	jb.visible = malloc(nchunks * (JOBBENCH_CHUNK + CULL_SLACK) * sizeof *jb.visible);
+	jb.nvisible = malloc(nchunks * sizeof *jb.nvisible);
+	double *t = malloc(frames * sizeof *t);
+	if(f_cullset_init(&jb.cs, n) || !jb.bounds || !jb.visible || !jb.nvisible || !t) return -3;
+
+	uint32_t rng = 1;
+	for(long i = 0; i < n; ++i) {
+		float p[4];
+		for(int c = 0; c < 4; ++c) {
+			rng = rng * 1664525 + 1013904223;
+			p[c] = (rng >> 8) * (1.0f / (1 << 24));
+		}
+		jb.bounds[i] = (struct t_aabb){ { p[0] * 400 - 200, p[1] * 400 - 200, p[2] * 400 - 200 }, { p[3] + 0.1f, p[3] + 0.1f, p[3] + 0.1f } };
+		f_cullset_add(&jb.cs, jb.bounds[i].c, jb.bounds[i].e);
+	}
+
+	const struct t_mat4 view = f_mat4_lookat((struct t_vec3){ 0, 0, 150 }, (struct t_vec3){ 0, 0, 0 }, (struct t_vec3){ 0, 1, 0 });
+	const struct t_mat4 proj = f_mat4_perspective(1.0f, 16.0f / 9, 0.1f, 300);
+	const struct t_mat4 vp = f_mat4_mul(&proj, &view);
+	f_frustum_extract(&jb.fr, &vp);
+
+	printf("%ld objects in %lu jobs, %u cores\n", n, nchunks, f_jobs_cores());
+	double base = 0;
+	for(int nt = 1; nt <= maxthreads; ++nt) {
+		struct t_jobsys js;
+		if(f_jobs_init(&js, nt)) return fprintf(stderr, "Unable to start %d threads\n", nt), -2;
+
+		unsigned long vis = 0;
+		for(int i = 0; i < frames; ++i) {
+			jb.model = f_mat4_trs((struct t_vec3){ 0, 0, 0 },
+				f_quat_axisangle((struct t_vec3){ 0, 1, 0 }, 0.01f * i), (struct t_vec3){ 1, 1, 1 });
+
+			const double t0 = f_clock_now();
+			f_jobs_parallel_for(&js, nchunks, 1, f_jobbench_chunk, &jb);
+			t[i] = f_clock_now() - t0;
+		}
+		for(unsigned long c = 0; c < nchunks; ++c) vis += jb.nvisible[c];
+
+		/* Scheduling overhead alone */
+		const unsigned long empty = JOBS_POOL / 4;
+		double t0 = f_clock_now();
+		for(int i = 0; i < frames; ++i) f_jobs_parallel_for(&js, empty, 1, f_jobbench_empty, NULL);
+		const double overhead = (f_clock_now() - t0) / ((double)frames * empty);
+
+		f_jobs_destroy(&js);
+
+		struct t_bench_stats st;
+		f_bench_stats(t, frames, &st);
+		if(nt == 1) base = st.median;
+		printf("%2d threads: median = %.3f ms, p99 = %.3f ms, speedup %.2fx, %lu visible, %.0f ns/empty job\n",
+			nt, st.median * 1e3, st.p99 * 1e3, base / st.median, vis, overhead * 1e9);
+	}
+
+	free(t), free(jb.bounds), free(jb.visible), free(jb.nvisible);
+	f_cullset_destroy(&jb.cs);
+	return 0;
+}
+
+/* Write a wavy grid with normals of roughly the given size as OBJ */
+int f_objbench_write(const char *path, long mb) {
+	FILE *f = fopen(path, "w");
+	if(!f) return -1;
+
+	/* About 150 bytes per grid vertex */
+	int side = 2;
+	while((long)side * side * 150 < mb << 20) side++;
+
+	for(int y = 0; y < side; ++y)
+		for(int x = 0; x < side; ++x) {
+			const float u = (float)x / (side - 1) * 2 - 1, v = (float)y / (side - 1) * 2 - 1;
+			fprintf(f, "v %.6f %.6f %.6f\n", u, v, 0.1f * sinf(u * 10) * cosf(v * 10));
+			fprintf(f, "vn %.6f %.6f %.6f\n", -cosf(u * 10) * cosf(v * 10), sinf(u * 10) * sinf(v * 10), 1.0f);
+		}
+
+	for(int y = 0; y + 1 < side; ++y)
+		for(int x = 0; x + 1 < side; ++x) {
+			const long a = (long)y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+			fprintf(f, "f %ld//%ld %ld//%ld %ld//%ld\n", a, a, b, b, d, d);
+			fprintf(f, "f %ld//%ld %ld//%ld %ld//%ld\n", a, a, d, d, c, c);
+		}
+
+	return fclose(f) ? -1 : 0;
+}
+
+/* OBJ loading throughput, mapped and parsed in parallel versus fgets and sscanf */
+/* The file is generated if it does not exist */
+/* Arguments: [MB] [path] */
+int f_bench_objload(int argc, char* argv[]) {
+	const long mb = argc > 0 ? atol(argv[0]) : 256;
+	const char *path = argc > 1 ? argv[1] : "/tmp/render_bench.obj";
+	if(mb <= 0) return -1;
+
+	FILE *f = fopen(path, "r");
+	if(f) fclose(f);
+	else if(printf("Writing %s\n", path), f_objbench_write(path, mb))
+		return fprintf(stderr, "Unable to write '%s'\n", path), -2;
+
+	struct t_jobsys js;
+	if(f_jobs_init(&js, 0)) return -3;
+
+	struct t_mesh m[2];
+	double t[2], size = 0;
+	for(int k = 0; k < 2; ++k) {
+		const double t0 = f_clock_now();
+		const int err = k ? f_obj_load(&m[k], path, &js) : f_obj_load_naive(&m[k], path);
+		t[k] = f_clock_now() - t0;
+		if(err) return fprintf(stderr, "Unable to load '%s' (%d)\n", path, err), f_jobs_destroy(&js), -4;
+	}
+
+	if((f = fopen(path, "r"))) fseek(f, 0, SEEK_END), size = ftell(f) / 1048576.0, fclose(f);
+
+	/* Same vertices and indices, positions up to float parsing differences */
+	int same = m[0].nv == m[1].nv && m[0].ni == m[1].ni && !memcmp(m[0].idx, m[1].idx, m[0].ni * sizeof *m[0].idx);
+	for(unsigned long i = 0; same && i < m[0].nv; ++i)
+		for(int c = 0; c < 3; ++c) same &= fabsf(m[0].v[i].pos[c] - m[1].v[i].pos[c]) <= 1e-6f * (1 + fabsf(m[0].v[i].pos[c]));
+
+	printf("%.1f MB, %lu vertices, %lu triangles\n", size, m[1].nv, m[1].ni / 3);
+	printf("fgets + sscanf: %.3f s, %.1f MB/s\n", t[0], size / t[0]);
+	printf("mmap, %u threads: %.3f s, %.1f MB/s (%.2fx), %s\n",
+		js.nthreads, t[1], size / t[1], t[0] / t[1], same ? "matches" : "MISMATCH");
+
+	f_mesh_free(&m[0]), f_mesh_free(&m[1]);
+	f_jobs_destroy(&js);
+	return 0;
+}
+
+/* Startup cost of a mesh: OBJ parsing and conversion versus mapping its container, */
+/* both up to the uploaded GL buffers */
+/* Arguments: [MB] [path.obj] */
+int f_bench_meshbin(int argc, char* argv[]) {
+	const long mb = argc > 0 ? atol(argv[0]) : 64;
+	const char *path = argc > 1 ? argv[1] : "/tmp/render_bench.obj";
+	if(mb <= 0) return -1;
+
+	FILE *f = fopen(path, "r");
+	if(f) fclose(f);
+	else if(printf("Writing %s\n", path), f_objbench_write(path, mb))
+		return fprintf(stderr, "Unable to write '%s'\n", path), -2;
+
+	char binpath[4096];
+	snprintf(binpath, sizeof binpath, "%s.rmesh", path);
+	if(f_bake_mesh(path, binpath)) return -3;
+
+	struct t_jobsys js;
+	if(f_jobs_init(&js, 0)) return -3;
+
+	const char* const names[] = { "OBJ + convert", "Mapped container" };
+	for(int k = 0; k < 2; ++k) {
+		const double t0 = f_clock_now();
+
+		struct t_meshbin m;
+		if(f_render_loadmesh(&m, k ? binpath : path, &js, NULL)) return f_jobs_destroy(&js), -4;
+		const double t1 = f_clock_now();
+
+		unsigned int bufs[2];
+		f_meshbin_upload(&m, &bufs[0], &bufs[1]);
+		glFinish();
+		const double t2 = f_clock_now();
+
+		printf("%-16s: %.3f s to memory, %.3f s uploaded (%lu vertices, %lu indices)\n",
+			names[k], t1 - t0, t2 - t0, (unsigned long)m.h->nverts, (unsigned long)m.h->nindices);
+
+		glDeleteBuffers(2, bufs);
+		f_meshbin_close(&m);
+	}
+
+	f_jobs_destroy(&js);
+	return 0;
+}
+
+/* Vertex cache optimization of a generated (or given) OBJ mesh, with its */
+/* triangles shuffled first, as exported meshes often are in poor order */
+/* Arguments: [MB] [path.obj] */
+int f_bench_meshopt(int argc, char* argv[]) {
+	const long mb = argc > 0 ? atol(argv[0]) : 64;
+	const char *path = argc > 1 ? argv[1] : "/tmp/render_bench.obj";
+	if(mb <= 0) return -1;
+
+	FILE *f = fopen(path, "r");
+	if(f) fclose(f);
+	else if(printf("Writing %s\n", path), f_objbench_write(path, mb))
+		return fprintf(stderr, "Unable to write '%s'\n", path), -2;
+
+	struct t_mesh m;
+	if(f_obj_load(&m, path, NULL)) return fprintf(stderr, "Unable to load '%s'\n", path), -3;
+
+	struct t_vcachestats st;
+	f_mesh_vcache_stats(m.idx, m.ni, m.nv, MESHOPT_CACHE_SIZE, &st);
+	printf("%lu vertices, %lu triangles\n", m.nv, m.ni / 3);
+	printf("File order    : ACMR %.3f, ATVR %.3f\n", st.acmr, st.atvr);
+
+	uint32_t rng = 1;
+	for(unsigned long i = m.ni / 3 - 1; i > 0; --i) {
+		rng = rng * 1664525 + 1013904223;
+		const unsigned long j = (rng >> 8) % (i + 1);
+		uint32_t t[3];
+		memcpy(t, m.idx + i * 3, sizeof t);
+		memcpy(m.idx + i * 3, m.idx + j * 3, sizeof t);
+		memcpy(m.idx + j * 3, t, sizeof t);
+	}
+	f_mesh_vcache_stats(m.idx, m.ni, m.nv, MESHOPT_CACHE_SIZE, &st);
+	printf("Shuffled      : ACMR %.3f, ATVR %.3f\n", st.acmr, st.atvr);
+
+	const double t0 = f_clock_now();
+	const int err = f_mesh_optimize(&m);
+	const double t = f_clock_now() - t0;
+
+	f_mesh_vcache_stats(m.idx, m.ni, m.nv, MESHOPT_CACHE_SIZE, &st);
+	printf("Optimized     : ACMR %.3f, ATVR %.3f, in %.3f s (%.1f Mtriangles/s)\n",
+		st.acmr, st.atvr, t, m.ni / 3 / t * 1e-6);
+
+	f_mesh_free(&m);
+	return err ? -4 : 0;
+}
+
+/* Level of detail generation of a generated (or given) OBJ mesh, and the levels */
+/* selected at increasing distances for a 1080 pixel high, 60 degree view */
+/* Arguments: [MB] [path.obj] */
+int f_bench_lod(int argc, char* argv[]) {
+	const long mb = argc > 0 ? atol(argv[0]) : 16;
+	const char *path = argc > 1 ? argv[1] : "/tmp/render_bench.obj";
+	if(mb <= 0) return -1;
+
+	FILE *f = fopen(path, "r");
+	if(f) fclose(f);
+	else if(printf("Writing %s\n", path), f_objbench_write(path, mb))
+		return fprintf(stderr, "Unable to write '%s'\n", path), -2;
+
+	struct t_mesh m;
+	if(f_obj_load(&m, path, NULL)) return fprintf(stderr, "Unable to load '%s'\n", path), -3;
+	const unsigned long nt = m.ni / 3;
+
+	const double t0 = f_clock_now();
+	const int err = f_mesh_build_lods(&m);
+	const double t = f_clock_now() - t0;
+	if(err) return f_mesh_free(&m), -4;
+
+	printf("%lu vertices, %lu triangles, %u levels in %.3f s (%.2f Mtriangles/s)\n",
+		m.nv, nt, m.nlods, t, nt / t * 1e-6);
+	for(unsigned int l = 0; l < m.nlods; ++l)
+		printf("LOD %u: %8u triangles (%5.1f%%), error %g\n",
+			l, m.lods[l].count / 3, 100.0 * m.lods[l].count / 3 / nt, m.lods[l].error);
+
+	const float pxscale = 1080 / (2 * tanf(3.14159265f / 6));
+	for(float dist = 1; dist <= 256; dist *= 4) {
+		const unsigned int l = f_mesh_lod_select(m.lods, m.nlods, dist, pxscale, RENDER_LOD_PIXELS);
+		printf("Distance %5.0f: LOD %u, %u triangles\n", dist, l, m.lods[l].count / 3);
+	}
+
+	f_mesh_free(&m);
+	return 0;
+}
+
+/* GL thread time per frame while loading a set of generated textures: one decoded */
+/* and uploaded synchronously per frame, versus streamed by the texture loader */
+/* (frames are paced at 4 ms, standing in for the rest of the frame's work) */
+/* Arguments: [count] [size] [budget MB] */
+int f_bench_texload(int argc, char* argv[]) {
+	const int count = argc > 0 ? atoi(argv[0]) : 32;
+	const int size = argc > 1 ? atoi(argv[1]) : 1024;
+	const long budget = argc > 2 ? atol(argv[2]) << 20 : TEXLOAD_BUDGET;
+	if(count <= 0 || count > TEXLOAD_MAXTEX || size <= 0 || budget <= 0) return -1;
+
+	/* A different gradient in every file */
+	unsigned char *px = malloc((size_t)size * size * 3);
+	if(!px) return -2;
+	char path[64];
+	for(int i = 0; i < count; ++i) {
+		snprintf(path, sizeof path, "/tmp/render_tex%d_%d.ppm", size, i);
+		FILE *f = fopen(path, "rb");
+		if(f) { fclose(f); continue; }
+
+		for(long p = 0; p < (long)size * size; ++p)
+			px[p * 3] = p % size + i, px[p * 3 + 1] = p / size, px[p * 3 + 2] = i * 8;
+		if(f_ppm_write(path, px, size, size)) return free(px), fprintf(stderr, "Unable to write '%s'\n", path), -2;
+	}
+	free(px);
+
+	const double mb = (double)count * size * size * 4 / 1048576;
+	const struct timespec pace = { 0, 4000000 };
+	double *ft = malloc(100000 * sizeof *ft);
+	if(!ft) return -2;
+
+	/* One texture per frame, read, uploaded and mipmapped on the GL thread */
+	unsigned int *tex = malloc(count * sizeof *tex);
+	if(!tex) return free(ft), -2;
+	const double s0 = f_clock_now();
+	for(int i = 0; i < count; ++i) {
+		const double t0 = f_clock_now();
+		snprintf(path, sizeof path, "/tmp/render_tex%d_%d.ppm", size, i);
+
+		int w, h, levels = 1;
+		unsigned char *img = f_ppm_read(path, &w, &h);
+		if(!img) return free(ft), free(tex), -3;
+		while((w | h) >> levels) levels++;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &tex[i]);
+		glTextureStorage2D(tex[i], levels, GL_SRGB8_ALPHA8, w, h);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(tex[i], 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, img);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glGenerateTextureMipmap(tex[i]);
+		glFlush();
+		free(img);
+
+		ft[i] = f_clock_now() - t0;
+		nanosleep(&pace, NULL);
+	}
+	glFinish();
+	const double tsync = f_clock_now() - s0;
+	glDeleteTextures(count, tex);
+	free(tex);
+
+	struct t_bench_stats st;
+	f_bench_stats(ft, count, &st);
+	printf("%d textures of %dx%d (%.1f MB as RGBA8)\n", count, size, size, mb);
+	f_bench_print(stdout, "Synchronous", &st);
+	printf("Synchronous: %u frames, %.3f s, %.1f MB/s\n", st.n, tsync, mb / tsync);
+
+	struct t_texloader *tl = malloc(sizeof *tl);
+	if(!tl || f_texload_init(tl, 0, budget)) return free(tl), free(ft), -4;
+
+	const double l0 = f_clock_now();
+	for(int i = 0; i < count; ++i) {
+		snprintf(path, sizeof path, "/tmp/render_tex%d_%d.ppm", size, i);
+		f_texload_request(tl, path, 1);
+	}
+
+	unsigned int frames = 0;
+	while(f_texload_pending(tl) && frames < 100000) {
+		const double t0 = f_clock_now();
+		f_texload_update(tl);
+		glFlush();
+		ft[frames++] = f_clock_now() - t0;
+		nanosleep(&pace, NULL);
+	}
+	glFinish();
+	const double tstream = f_clock_now() - l0;
+
+	unsigned int loaded = 0;
+	for(int i = 0; i < count; ++i) loaded += f_texload_texture(tl, i) != 0;
+
+	f_bench_stats(ft, frames, &st);
+	f_bench_print(stdout, "Streamed", &st);
+	printf("Streamed: %u frames, %.3f s, %.1f MB/s, %u threads, %.1f MB budget, %lu ring stalls, %u/%d loaded\n",
+		st.n, tstream, mb / tstream, tl->nthreads, budget / 1048576.0, tl->stalls, loaded, count);
+
+	f_texload_destroy(tl);
+	free(tl), free(ft);
+	return loaded == (unsigned int)count ? 0 : -5;
+}
+
+/* Texture baking per block format: encode time on all threads and on one, size, */
+/* and PSNR of the top level as decoded by the driver, then the upload of the */
+/* mapped container versus RGBA8 with glGenerateTextureMipmap */
+/* Arguments: [size] */
+int f_bench_texbake(int argc, char* argv[]) {
+	const int size = argc > 0 ? atoi(argv[0]) : 1024;
+	if(size <= 0) return -1;
+
+	/* Smooth gradients with sharp edges and noise, and a matching normal map */
+	const size_t npx = (size_t)size * size;
+	unsigned char *px = malloc(npx * 4), *back = malloc(npx * 4);
+	if(!px || !back) return free(px), free(back), -2;
+	uint32_t rng = 1;
+	for(int y = 0; y < size; ++y)
+		for(int x = 0; x < size; ++x) {
+			rng = rng * 1664525 + 1013904223;
+			unsigned char *p = px + ((size_t)y * size + x) * 4;
+			const int edge = ((x / 32) ^ (y / 32)) & 1;
+			p[0] = x * 255 / size, p[1] = y * 255 / size, p[2] = edge ? 200 : 40 + (rng >> 28);
+			p[3] = 255 - (x + y) * 127 / size;
+		}
+
+	struct t_jobsys js;
+	if(f_jobs_init(&js, 0)) return free(px), free(back), -3;
+	printf("%dx%d, %u threads\n", size, size, js.nthreads);
+
+	char path[64];
+	for(int f = 0; f < BCFMT_COUNT; ++f) {
+		double t[2];
+		struct t_texbin tb;
+		for(int k = 0; k < 2; ++k) {
+			const double t0 = f_clock_now();
+			if(f_texbin_build(&tb, px, size, size, f, f != BCFMT_BC5, k ? &js : NULL)) return f_jobs_destroy(&js), -4;
+			t[k] = f_clock_now() - t0;
+			if(!k) f_texbin_close(&tb);
+		}
+
+		snprintf(path, sizeof path, "/tmp/render_bench_%s.rtex", bcfmt_names[f]);
+		const int werr = f_texbin_write(&tb, path);
+		f_texbin_close(&tb);
+		if(werr || f_texbin_open(&tb, path)) return f_jobs_destroy(&js), -5;
+
+		const double u0 = f_clock_now();
+		unsigned int tex = f_texbin_upload(&tb);
+		glFinish();
+		const double tu = f_clock_now() - u0;
+
+		/* Channels the format stores, compared in the stored (sRGB) encoding */
+		const int nch = f == BCFMT_BC1 ? 3 : f == BCFMT_BC5 ? 2 : 4;
+		glGetTextureImage(tex, 0, GL_RGBA, GL_UNSIGNED_BYTE, npx * 4, back);
+		double se = 0;
+		for(size_t i = 0; i < npx; ++i)
+			for(int c = 0; c < nch; ++c) {
+				const double d = (double)px[i * 4 + c] - back[i * 4 + c];
+				se += d * d;
+			}
+		const double mse = se / (npx * nch);
+
+		printf("%s: %.3f s (1 thread %.3f s, %.2fx), %.1f KB with mips, PSNR %.2f dB, upload %.3f ms\n",
+			bcfmt_names[f], t[1], t[0], t[0] / t[1], tb.size / 1024.0,
+			mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : INFINITY, tu * 1e3);
+
+		glDeleteTextures(1, &tex);
+		f_texbin_close(&tb);
+	}
+
+	/* The runtime alternative: uncompressed level 0, mips generated by the driver */
+	int levels = 1;
+	while(size >> levels) levels++;
+	const double u0 = f_clock_now();
+	unsigned int tex;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, levels, GL_SRGB8_ALPHA8, size, size);
+	glTextureSubImage2D(tex, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, px);
+	glGenerateTextureMipmap(tex);
+	glFinish();
+	printf("RGBA8 + glGenerateTextureMipmap: %.1f KB, upload %.3f ms\n", npx * 4 * 4 / 3 / 1024.0, (f_clock_now() - u0) * 1e3);
+	glDeleteTextures(1, &tex);
+
+	f_jobs_destroy(&js);
+	free(px), free(back);
+	return 0;
+}
+
+/* Producer side of the input queue benchmark: numbered events, retried when full */
+/* so none are lost, or sent once through a mutex protected ring as the baseline */
+struct t_iqbench {
+	struct t_inputqueue q;
+	pthread_mutex_t lock;
+	unsigned int n, locked;
+	unsigned long total, retries;
+};
+
+static void* f_iqbench_producer(void *data) {
+	struct t_iqbench *b = data;
+
+	for(unsigned long i = 0; i < b->total; ++i) {
+		const struct t_glfw_inputevent ev = {
+			.type = IEV_KEYPRESS, .data = { .key_ev = { (int)i, 1, 0 } }, .mx = (double)i
+		};
+
+		if(!b->locked) {
+			while(f_iqappend(&b->q, &ev)) b->retries++, sched_yield();
+			continue;
+		}
+
+		for(;;) {
+			pthread_mutex_lock(&b->lock);
+			const int full = b->n > b->q.mask;
+			if(!full) b->q.ev[(b->q.tailcache + b->n++) & b->q.mask] = ev;
+			pthread_mutex_unlock(&b->lock);
+			if(!full) break;
+			b->retries++, sched_yield();
+		}
+	}
+	return NULL;
+}
+
+/* Input queue stress test and throughput: one thread appends numbered events while */
+/* this one drains them in batches, checking none are lost, duplicated or reordered */
+/* Arguments: [events] [capacity] [batch] */
+int f_bench_iqueue(int argc, char* argv[]) {
+	const unsigned long total = argc > 0 ? atol(argv[0]) : 10000000;
+	const unsigned int cap = argc > 1 ? atoi(argv[1]) : RENDER_MAXEVENTS;
+	const unsigned int batch = argc > 2 ? atoi(argv[2]) : 64;
+	if(!total || !batch) return -1;
+
+	struct t_glfw_inputevent *out = malloc(batch * sizeof *out);
+	struct t_iqbench *b = aligned_alloc(64, sizeof *b);
+	if(!out || !b) return free(out), free(b), -2;
+
+	const char* const names[] = { "SPSC ring", "Mutex ring" };
+	for(unsigned int locked = 0; locked < 2; ++locked) {
+		if(f_iq_init(&b->q, cap)) return free(out), free(b), fprintf(stderr, "Capacity must be a power of two\n"), -1;
+		pthread_mutex_init(&b->lock, NULL);
+		b->n = 0, b->locked = locked, b->total = total, b->retries = 0;
+
+		pthread_t producer;
+		const double t0 = f_clock_now();
+		if(pthread_create(&producer, NULL, f_iqbench_producer, b)) return f_iq_destroy(&b->q), free(out), free(b), -3;
+
+		unsigned long next = 0, bad = 0, empty = 0;
+		while(next < total) {
+			unsigned int n = 0;
+			if(!locked) n = f_iqdrain(&b->q, out, batch);
+			else {
+				pthread_mutex_lock(&b->lock);
+				n = b->n < batch ? b->n : batch;
+				for(unsigned int i = 0; i < n; ++i) out[i] = b->q.ev[(b->q.tailcache + i) & b->q.mask];
+				b->q.tailcache += n, b->n -= n;
+				pthread_mutex_unlock(&b->lock);
+			}
+
+			if(!n) empty++, sched_yield();
+			for(unsigned int i = 0; i < n; ++i, ++next)
+				bad += out[i].data.key_ev.key != (int)next || out[i].mx != (double)next;
+		}
+		pthread_join(producer, NULL);
+		const double t = f_clock_now() - t0;
+
+		printf("%-10s: %lu events in %.3f s, %.1f Mevents/s, %lu full, %lu empty, %lu dropped, %s\n",
+			names[locked], total, t, total / t * 1e-6, b->retries, empty,
+			atomic_load(&b->q.dropped) - (locked ? 0 : b->retries), bad ? "MISMATCH" : "in order");
+
+		pthread_mutex_destroy(&b->lock);
+		f_iq_destroy(&b->q);
+		if(bad) return free(out), free(b), -4;
+	}
+
+	free(out), free(b);
+	return 0;
+}
+
+/* Frame pacing jitter without a display: frames of random CPU work (0.5 to 1.5 */
+/* times the given time), vsync is emulated by waiting for the next multiple of */
+/* the refresh period in place of the swap - the limiter is run with and without */
+/* its final spin, and the input to swap time shows what the latch gains */
+/* Arguments: [frames] [hz] [work ms] */
+int f_bench_pacing(int argc, char* argv[]) {
+	const unsigned int frames = argc > 0 ? atoi(argv[0]) : 300;
+	const double hz = argc > 1 ? atof(argv[1]) : 60;
+	const double work = (argc > 2 ? atof(argv[2]) : 4) * 1e-3;
+	if(!frames || hz <= 0 || work < 0) return -1;
+
+	const struct { const char *name; enum e_pacemode mode; double spin; } runs[] = {
+		{ "vsync", PACE_VSYNC, PACE_SPIN },
+		{ "off", PACE_OFF, PACE_SPIN },
+		{ "limit sleep", PACE_LIMIT, 0 },
+		{ "limit sleep+spin", PACE_LIMIT, PACE_SPIN },
+		{ "latch", PACE_LATCH, PACE_SPIN },
+	};
+
+	srand(1);
+	for(unsigned int r = 0; r < sizeof runs / sizeof *runs; ++r) {
+		struct t_pacer pc;
+		f_pace_init(&pc, runs[r].mode, hz, NULL);
+		pc.spin = runs[r].spin;
+
+		const double t0 = f_clock_now();
+		for(unsigned int f = 0; f < frames; ++f) {
+			const double start = f_pace_begin(&pc);
+			const double t = work * (0.5 + (double)rand() / RAND_MAX);
+			while(f_clock_now() - start < t);
+
+			f_pace_submit(&pc);
+			if(pc.interval) f_pace_sleepuntil(t0 + ceil((f_clock_now() - t0) * hz) / hz, PACE_SPIN);
+			f_pace_end(&pc);
+		}
+
+		struct t_pace_stats st;
+		f_pace_stats(&pc, &st);
+		printf("%-16s: mean = %.3f ms, jitter = %.3f ms, p99 deviation = %.3f ms, input to swap = %.3f ms\n",
+			runs[r].name, st.mean * 1e3, st.jitter * 1e3, st.p99dev * 1e3, st.latency * 1e3);
+	}
+	return 0;
+}
+
+/* Benchmarks take their own arguments, and run on a small headless context if they need GL */
+struct t_benchmark {
+	const char *name;
+	int (*run)(int, char**);
+	int gl;
+} const benchmarks[] = {
+	{ "stream", f_bench_stream, 1 },
+	{ "mdi", f_bench_mdi, 1 },
+	{ "instance", f_bench_instance, 1 },
+	{ "progcache", f_bench_progcache, 1 },
+	{ "progbuild", f_bench_progbuild, 1 },
+	{ "cmdqueue", f_bench_cmdqueue, 1 },
+	{ "vecmath", f_bench_vecmath, 0 },
+	{ "cull", f_bench_cull, 0 },
+	{ "scene", f_bench_scene, 0 },
+	{ "jobs", f_bench_jobs, 0 },
+	{ "objload", f_bench_objload, 0 },
+	{ "meshbin", f_bench_meshbin, 1 },
+	{ "meshopt", f_bench_meshopt, 0 },
+	{ "lod", f_bench_lod, 0 },
+	{ "texload", f_bench_texload, 1 },
+	{ "texbake", f_bench_texbake, 1 },
+	{ "iqueue", f_bench_iqueue, 0 },
+	{ "pacing", f_bench_pacing, 0 },
+};
+
+int f_run_bench(int argc, char* argv[]) {
+	for(size_t i = 0; i < sizeof benchmarks / sizeof *benchmarks; ++i) {
+		if(strcmp(argv[0], benchmarks[i].name)) continue;
+		if(!benchmarks[i].gl) return benchmarks[i].run(argc - 1, argv + 1);
+
+		struct t_headless hl;
+		if(f_headless_init(&hl, 64, 64)) {
+			fprintf(stderr, "Unable to create headless OpenGL 4.6 context\n");
+			return -3;
+		}
+
+		const int ret = benchmarks[i].run(argc - 1, argv + 1);
+		f_headless_destroy(&hl);
+		return ret;
+	}
+
+	fprintf(stderr, "Unknown benchmark '%s'\n", argv[0]);
+	return -1;
+}
@@ -0,0 +1,8 @@
+#ifndef __H__BENCHMARKS_H___
+#define __H__BENCHMARKS_H___
+
+/* Run the named benchmark (argv[0]) with its own arguments, on a small */
+/* headless context if it needs GL - usage: render --bench <name> [args...] */
+int f_run_bench(int, char **);
+
+#endif
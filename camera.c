@@ -0,0 +1,62 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <math.h>
+
+#include "camera.h"
+
+/* Radians per pixel of mouse movement, and zoom factor per scroll step */
+#define CAMERA_ROTATE_SPEED 0.005f
+#define CAMERA_ZOOM_STEP 0.9f
+
+void f_camera_init(struct t_camera *cam) {
+	*cam = (struct t_camera){
+		.target = { 0, 0, 0 },
+		.yaw = 0, .pitch = 0, .dist = 3,
+		.fovy = 1.0f, .near = 0.1f, .far = 1000,
+	};
+	cam->view = cam->proj = cam->viewproj = f_mat4_identity();
+}
+
+/* Feed input events popped from the queue */
+void f_camera_event(struct t_camera *cam, const struct t_glfw_inputevent *ev) {
+	switch(ev->type) {
+		case IEV_MOUSEBUTTON:
+			if(ev->data.mb_ev.button != GLFW_MOUSE_BUTTON_LEFT) break;
+			cam->dragging = ev->data.mb_ev.action == GLFW_PRESS;
+			cam->lastmx = ev->mx, cam->lastmy = ev->my;
+			break;
+
+		case IEV_SCROLL:
+			cam->dist *= powf(CAMERA_ZOOM_STEP, ev->data.scroll_ev.sy);
+			if(cam->dist < cam->near * 2) cam->dist = cam->near * 2;
+			break;
+
+		case IEV_KEYPRESS:
+		default:
+			break;
+	}
+}
+
+/* Once per frame, with the current mouse position and framebuffer size */
+void f_camera_update(struct t_camera *cam, double mx, double my, int width, int height) {
+	if(cam->dragging) {
+		cam->yaw -= (mx - cam->lastmx) * CAMERA_ROTATE_SPEED;
+		cam->pitch += (my - cam->lastmy) * CAMERA_ROTATE_SPEED;
+
+		/* Stop short of the poles, where the up vector degenerates */
+		const float lim = 1.5f;
+		cam->pitch = cam->pitch < -lim ? -lim : cam->pitch > lim ? lim : cam->pitch;
+		cam->lastmx = mx, cam->lastmy = my;
+	}
+
+	cam->eye = f_vec3_add(cam->target, (struct t_vec3){
+		cam->dist * cosf(cam->pitch) * sinf(cam->yaw),
+		cam->dist * sinf(cam->pitch),
+		cam->dist * cosf(cam->pitch) * cosf(cam->yaw),
+	});
+
+	cam->view = f_mat4_lookat(cam->eye, cam->target, (struct t_vec3){ 0, 1, 0 });
+	cam->proj = f_mat4_perspective(cam->fovy, height > 0 ? (float)width / height : 1, cam->near, cam->far);
+	cam->viewproj = f_mat4_mul(&cam->proj, &cam->view);
+}
@@ -0,0 +1,26 @@
+#ifndef __H__CAMERA_H___
+#define __H__CAMERA_H___
+
+#include "vecmath.h"
+#include "window.h"
+
+/* Orbit camera: dragging with the left mouse button rotates around the target, */
+/* scrolling moves towards or away from it */
+struct t_camera {
+	struct t_vec3 target;
+	float yaw, pitch, dist;
+	float fovy, near, far;
+
+	double lastmx, lastmy;
+	unsigned char dragging:1;
+
+	/* Derived by f_camera_update */
+	struct t_vec3 eye;
+	struct t_mat4 view, proj, viewproj;
+};
+
+void f_camera_init(struct t_camera *);
+void f_camera_event(struct t_camera *, const struct t_glfw_inputevent *);
+void f_camera_update(struct t_camera *, double, double, int, int);
+
+#endif
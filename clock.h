@@ -0,0 +1,8 @@
+#ifndef __H__CLOCK_H___
+#define __H__CLOCK_H___
+
+/* Monotonic time in seconds, independent of GLFW so it works without a window */
+/* and from any thread (input events, pacing, latency and benchmarks share it) */
+double f_clock_now(void);
+
+#endif
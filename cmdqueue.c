@@ -0,0 +1,112 @@
+#include <epoxy/gl.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdqueue.h"
+
+/* References
+ * ----------
+ * C. Ericson, "Order your graphics draw calls around!"
+ * "https://realtimecollisiondetection.net/blog/?p=86"
+ */
+
+
+/* Build a sort key - ids are truncated to their field width, which only */
+/* affects ordering, since the backend compares the full names */
+/* depth is in [0, 1], pass 1 - depth for back to front ordering */
+uint64_t f_cmdkey(unsigned int pass, unsigned int sp, unsigned int material, unsigned int vao, float depth) {
+	depth = depth < 0 ? 0 : depth > 1 ? 1 : depth;
+	const uint64_t d = (uint64_t)(depth * ((1 << CMDKEY_DEPTH_BITS) - 1));
+
+	return (uint64_t)(pass & 0xF) << 60
+		| (uint64_t)(sp & 0xFFF) << 48
+		| (uint64_t)(material & 0xFFF) << 36
+		| (uint64_t)(vao & 0xFFF) << 24
+		| d;
+}
+
+int f_cmdq_init(struct t_cmdqueue *q, unsigned int cap, void (*bindmaterial)(unsigned int, void *), void *user) {
+	*q = (struct t_cmdqueue){ .cap = cap, .bindmaterial = bindmaterial, .user = user };
+
+	q->packets = malloc(cap * sizeof *q->packets);
+	q->entries = malloc(cap * sizeof *q->entries);
+	q->tmp = malloc(cap * sizeof *q->tmp);
+	if(!q->packets || !q->entries || !q->tmp) return f_cmdq_destroy(q), -1;
+
+	return 0;
+}
+
+void f_cmdq_destroy(struct t_cmdqueue *q) {
+	free(q->packets), free(q->entries), free(q->tmp);
+	*q = (struct t_cmdqueue){0};
+}
+
+/* Returns -1 if the queue is full */
+int f_cmdq_push(struct t_cmdqueue *q, uint64_t key, const struct t_drawpacket *p) {
+	if(q->n >= q->cap) return -1;
+
+	q->packets[q->n] = *p;
+	q->entries[q->n] = (struct t_cmdentry){ key, q->n };
+	q->n++;
+	return 0;
+}
+
+/* LSD radix sort on 8 bit digits - stable, so equal keys keep push order */
+/* Digits where every key is the same are skipped */
+void f_cmdq_sort(struct t_cmdqueue *q) {
+	if(q->n < 2) return;
+
+	unsigned int hist[8][256];
+	memset(hist, 0, sizeof hist);
+
+	for(unsigned int i = 0; i < q->n; ++i)
+		for(int d = 0; d < 8; ++d)
+			hist[d][(q->entries[i].key >> (8 * d)) & 0xFF]++;
+
+	struct t_cmdentry *src = q->entries, *dst = q->tmp;
+	for(int d = 0; d < 8; ++d) {
+		if(hist[d][(src[0].key >> (8 * d)) & 0xFF] == q->n) continue;
+
+		unsigned int off[256], sum = 0;
+		for(int b = 0; b < 256; ++b) off[b] = sum, sum += hist[d][b];
+
+		for(unsigned int i = 0; i < q->n; ++i)
+			dst[off[(src[i].key >> (8 * d)) & 0xFF]++] = src[i];
+
+		struct t_cmdentry *t = src;
+		src = dst, dst = t;
+	}
+
+	q->entries = src, q->tmp = dst;
+}
+
+/* Issue all packets in queue order, binding state only when it changes */
+/* Empties the queue */
+void f_cmdq_execute(struct t_cmdqueue *q) {
+	q->stats = (struct t_cmdstats){0};
+	unsigned int sp = 0, vao = 0, material = 0;
+	int first = 1;
+
+	for(unsigned int i = 0; i < q->n; ++i) {
+		const struct t_drawpacket *p = &q->packets[q->entries[i].idx];
+
+		if(first || p->sp != sp) glUseProgram(sp = p->sp), q->stats.programs++;
+		if(first || p->vao != vao) glBindVertexArray(vao = p->vao), q->stats.vaos++;
+		if(first || p->material != material) {
+			material = p->material, q->stats.materials++;
+			if(q->bindmaterial) q->bindmaterial(material, q->user);
+		}
+		first = 0;
+
+		if(p->indexed)
+			glDrawElementsInstancedBaseVertex(p->mode, p->count, GL_UNSIGNED_INT,
+				(void*)((uintptr_t)p->first * sizeof(uint32_t)), p->instances, p->basevertex);
+		else
+			glDrawArraysInstanced(p->mode, p->first, p->count, p->instances);
+
+		q->stats.draws++;
+	}
+
+	q->n = 0;
+}
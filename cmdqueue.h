@@ -0,0 +1,50 @@
+#ifndef __H__CMDQUEUE_H___
+#define __H__CMDQUEUE_H___
+
+#include <stdint.h>
+
+/* Sort key layout, most significant first: */
+/* pass (4 bits) | program (12) | material (12) | vertex array (12) | depth (24) */
+#define CMDKEY_DEPTH_BITS 24
+
+/* A draw call and the state it needs */
+/* Indexed draws use 32 bit indices from the vertex array's element buffer */
+struct t_drawpacket {
+	unsigned int sp, vao, material;
+	unsigned int mode, count, first, instances;
+	int basevertex;
+	unsigned char indexed;
+};
+
+/* GL state changes and draws issued by the last execute */
+struct t_cmdstats {
+	unsigned int draws, programs, vaos, materials;
+};
+
+struct t_cmdentry {
+	uint64_t key;
+	uint32_t idx;
+};
+
+/* Per frame queue: systems push packets in any order, */
+/* the queue is radix sorted by key and executed skipping redundant binds */
+struct t_cmdqueue {
+	struct t_drawpacket *packets;
+	struct t_cmdentry *entries, *tmp;
+	unsigned int n, cap;
+
+	/* Called when the material changes between draws */
+	void (*bindmaterial)(unsigned int, void *);
+	void *user;
+
+	struct t_cmdstats stats;
+};
+
+uint64_t f_cmdkey(unsigned int, unsigned int, unsigned int, unsigned int, float);
+int f_cmdq_init(struct t_cmdqueue *, unsigned int, void (*)(unsigned int, void *), void *);
+void f_cmdq_destroy(struct t_cmdqueue *);
+int f_cmdq_push(struct t_cmdqueue *, uint64_t, const struct t_drawpacket *);
+void f_cmdq_sort(struct t_cmdqueue *);
+void f_cmdq_execute(struct t_cmdqueue *);
+
+#endif
@@ -0,0 +1,244 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "cull.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define CULL_X86 1
+#endif
+
+/* References
+ * ----------
+ * G. Gribb, K. Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+ * "https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf"
+ * F. Gilardi, "Frustum culling" (SoA + SIMD layout)
+ */
+
+
+/* All arrays are allocated together, aligned and padded to a multiple of 8 */
+int f_cullset_init(struct t_cullset *cs, unsigned long cap) {
+	*cs = (struct t_cullset){ .cap = cap };
+
+	const unsigned long stride = (cap + 7) & ~7ul;
+	float *mem = aligned_alloc(32, 7 * stride * sizeof *mem);
+	if(!mem) return -1;
+
+	float **arr[7] = { &cs->cx, &cs->cy, &cs->cz, &cs->ex, &cs->ey, &cs->ez, &cs->r };
+	for(int i = 0; i < 7; ++i) *arr[i] = mem + i * stride;
+	return 0;
+}
+
+void f_cullset_destroy(struct t_cullset *cs) {
+	free(cs->cx);
+	*cs = (struct t_cullset){0};
+}
+
+/* Add an object by center and half extents, returns its index or -1 */
+long f_cullset_add(struct t_cullset *cs, struct t_vec3 c, struct t_vec3 e) {
+	if(cs->n >= cs->cap) return -1;
+
+	const unsigned long i = cs->n++;
+	f_cullset_set(cs, i, c, e);
+	return i;
+}
+
+void f_cullset_set(struct t_cullset *cs, unsigned long i, struct t_vec3 c, struct t_vec3 e) {
+	cs->cx[i] = c.x, cs->cy[i] = c.y, cs->cz[i] = c.z;
+	cs->ex[i] = e.x, cs->ey[i] = e.y, cs->ez[i] = e.z;
+	cs->r[i] = f_vec3_len(e);
+}
+
+/* Box enclosing a transformed box (J. Arvo, Graphics Gems) */
+struct t_aabb f_aabb_transform(const struct t_mat4 *m, struct t_aabb b) {
+	const float *a = m->m, c[3] = { b.c.x, b.c.y, b.c.z }, e[3] = { b.e.x, b.e.y, b.e.z };
+	float rc[3], re[3];
+	for(int r = 0; r < 3; ++r) {
+		rc[r] = a[12 + r], re[r] = 0;
+		for(int k = 0; k < 3; ++k) rc[r] += a[k*4 + r] * c[k], re[r] += fabsf(a[k*4 + r]) * e[k];
+	}
+	return (struct t_aabb){ { rc[0], rc[1], rc[2] }, { re[0], re[1], re[2] } };
+}
+
+/* Planes of the clip volume in the space the matrix transforms from */
+/* (world space for a view projection matrix) */
+void f_frustum_extract(struct t_frustum *f, const struct t_mat4 *vp) {
+	const float *m = vp->m;
+	for(int i = 0; i < 3; ++i)
+		for(int s = 0; s < 2; ++s) {
+			float *p = f->p[i*2 + s];
+			const float sign = s ? -1 : 1;
+			for(int c = 0; c < 4; ++c) p[c] = m[c*4 + 3] + sign * m[c*4 + i];
+
+			const float l = sqrtf(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+			if(l > 0) for(int c = 0; c < 4; ++c) p[c] /= l;
+		}
+}
+
+
+/* -------------------- *
+ * Scalar reference path *
+ * -------------------- */
+
+static unsigned long f_cull_spheres_range(const struct t_frustum *f, const struct t_cullset *cs, unsigned long i, unsigned long end, uint32_t *out) {
+	unsigned long k = 0;
+	for(; i < end; ++i) {
+		int in = 1;
+		for(int p = 0; p < 6 && in; ++p) {
+			const float *pl = f->p[p];
+			in = pl[0]*cs->cx[i] + pl[1]*cs->cy[i] + pl[2]*cs->cz[i] + pl[3] >= -cs->r[i];
+		}
+		if(in) out[k++] = i;
+	}
+	return k;
+}
+
+static inline int f_cull_aabb_in(const struct t_frustum *f, const struct t_cullset *cs, unsigned long i) {
+	int in = 1;
+	for(int p = 0; p < 6 && in; ++p) {
+		const float *pl = f->p[p];
+		const float d = pl[0]*cs->cx[i] + pl[1]*cs->cy[i] + pl[2]*cs->cz[i] + pl[3];
+		const float rad = fabsf(pl[0])*cs->ex[i] + fabsf(pl[1])*cs->ey[i] + fabsf(pl[2])*cs->ez[i];
+		in = d >= -rad;
+	}
+	return in;
+}
+
+static unsigned long f_cull_aabbs_range(const struct t_frustum *f, const struct t_cullset *cs, unsigned long i, unsigned long end, uint32_t *out) {
+	unsigned long k = 0;
+	for(; i < end; ++i) if(f_cull_aabb_in(f, cs, i)) out[k++] = i;
+	return k;
+}
+
+unsigned long f_cull_spheres_ref(const struct t_frustum *f, const struct t_cullset *cs, uint32_t *out) {
+	return f_cull_spheres_range(f, cs, 0, cs->n, out);
+}
+
+unsigned long f_cull_aabbs_ref(const struct t_frustum *f, const struct t_cullset *cs, uint32_t *out) {
+	return f_cull_aabbs_range(f, cs, 0, cs->n, out);
+}
+
+
+/* --------- *
+ * AVX2 path *
+ * --------- */
+
+#ifdef CULL_X86
+/* Lane permutations moving the set lanes of an 8 bit mask to the front */
+static uint32_t cull_lut[256][8] __attribute__((aligned(32)));
+static int cull_avx2;
+static pthread_once_t cull_once = PTHREAD_ONCE_INIT;
+
+static void f_cull_setup(void) {
+	for(int m = 0; m < 256; ++m) {
+		int k = 0;
+		for(int b = 0; b < 8; ++b) if(m & (1 << b)) cull_lut[m][k++] = b;
+		while(k < 8) cull_lut[m][k++] = 0;
+	}
+	cull_avx2 = f_vecmath_avx2();
+}
+
+/* Store the indices of visible lanes contiguously (always writes 8 entries) */
+__attribute__((target("avx2")))
+static inline unsigned long f_cull_compact(uint32_t *out, __m256i idx, int mask) {
+	const __m256i perm = _mm256_load_si256((const __m256i*)cull_lut[mask]);
+	_mm256_storeu_si256((__m256i*)out, _mm256_permutevar8x32_epi32(idx, perm));
+	return __builtin_popcount(mask);
+}
+
+/* 8 objects per iteration: signed distance of the centers to every plane, */
+/* a sphere is visible unless it is fully behind one of them (min over planes + r < 0) */
+__attribute__((target("avx2,fma")))
+static unsigned long f_cull_spheres_avx2(const struct t_frustum *f, const struct t_cullset *cs, unsigned long i, unsigned long end, uint32_t *out) {
+	__m256 pl[6][4];
+	for(int p = 0; p < 6; ++p)
+		for(int c = 0; c < 4; ++c) pl[p][c] = _mm256_set1_ps(f->p[p][c]);
+
+	/* Lane indices advance with the loop instead of being rebuilt per group */
+	const __m256i step = _mm256_set1_epi32(8);
+	__m256i idx = _mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	unsigned long k = 0;
+	for(; i + 8 <= end; i += 8, idx = _mm256_add_epi32(idx, step)) {
+		const __m256 x = _mm256_load_ps(cs->cx + i), y = _mm256_load_ps(cs->cy + i), z = _mm256_load_ps(cs->cz + i);
+
+		__m256 dmin = _mm256_set1_ps(INFINITY);
+		for(int p = 0; p < 6; ++p) {
+			__m256 d = _mm256_fmadd_ps(pl[p][0], x, pl[p][3]);
+			d = _mm256_fmadd_ps(pl[p][1], y, d);
+			d = _mm256_fmadd_ps(pl[p][2], z, d);
+			dmin = _mm256_min_ps(dmin, d);
+		}
+
+		/* Outside when dmin + r < 0, only its sign bit is kept by the movemask */
+		const __m256 outside = _mm256_add_ps(dmin, _mm256_load_ps(cs->r + i));
+		k += f_cull_compact(out + k, idx, ~_mm256_movemask_ps(outside) & 0xFF);
+	}
+
+	return k + f_cull_spheres_range(f, cs, i, end, out + k);
+}
+
+/* Same for boxes, with the box extents projected onto each plane normal */
+/* in place of the radius, so the planes cannot share one reduction */
+__attribute__((target("avx2,fma")))
+static unsigned long f_cull_aabbs_avx2(const struct t_frustum *f, const struct t_cullset *cs, unsigned long i, unsigned long end, uint32_t *out) {
+	__m256 pl[6][4], apl[6][3];
+	for(int p = 0; p < 6; ++p)
+		for(int c = 0; c < 4; ++c) {
+			pl[p][c] = _mm256_set1_ps(f->p[p][c]);
+			if(c < 3) apl[p][c] = _mm256_set1_ps(fabsf(f->p[p][c]));
+		}
+
+	const __m256i step = _mm256_set1_epi32(8);
+	__m256i idx = _mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	unsigned long k = 0;
+	for(; i + 8 <= end; i += 8, idx = _mm256_add_epi32(idx, step)) {
+		const __m256 x = _mm256_load_ps(cs->cx + i), y = _mm256_load_ps(cs->cy + i), z = _mm256_load_ps(cs->cz + i);
+		const __m256 ex = _mm256_load_ps(cs->ex + i), ey = _mm256_load_ps(cs->ey + i), ez = _mm256_load_ps(cs->ez + i);
+
+		__m256 outside = _mm256_setzero_ps();
+		for(int p = 0; p < 6; ++p) {
+			__m256 d = _mm256_fmadd_ps(pl[p][0], x, pl[p][3]);
+			d = _mm256_fmadd_ps(pl[p][1], y, d);
+			d = _mm256_fmadd_ps(pl[p][2], z, d);
+
+			/* Projected radius of the box onto the plane normal */
+			__m256 r = _mm256_mul_ps(apl[p][0], ex);
+			r = _mm256_fmadd_ps(apl[p][1], ey, r);
+			r = _mm256_fmadd_ps(apl[p][2], ez, r);
+			outside = _mm256_or_ps(outside, _mm256_add_ps(d, r));
+		}
+
+		k += f_cull_compact(out + k, idx, ~_mm256_movemask_ps(outside) & 0xFF);
+	}
+
+	return k + f_cull_aabbs_range(f, cs, i, end, out + k);
+}
+#endif
+
+/* Write the indices of objects in [begin, end) intersecting the frustum, returns their count */
+/* begin must be a multiple of 8, and out needs room for end - begin + CULL_SLACK entries */
+unsigned long f_cull_spheres_part(const struct t_frustum *f, const struct t_cullset *cs, unsigned long begin, unsigned long end, uint32_t *out) {
+#ifdef CULL_X86
+	pthread_once(&cull_once, f_cull_setup);
+	if(cull_avx2) return f_cull_spheres_avx2(f, cs, begin, end, out);
+#endif
+	return f_cull_spheres_range(f, cs, begin, end, out);
+}
+
+unsigned long f_cull_aabbs_part(const struct t_frustum *f, const struct t_cullset *cs, unsigned long begin, unsigned long end, uint32_t *out) {
+#ifdef CULL_X86
+	pthread_once(&cull_once, f_cull_setup);
+	if(cull_avx2) return f_cull_aabbs_avx2(f, cs, begin, end, out);
+#endif
+	return f_cull_aabbs_range(f, cs, begin, end, out);
+}
+
+/* Whole set, out needs room for n + CULL_SLACK entries */
+unsigned long f_cull_spheres(const struct t_frustum *f, const struct t_cullset *cs, uint32_t *out) {
+	return f_cull_spheres_part(f, cs, 0, cs->n, out);
+}
+
+unsigned long f_cull_aabbs(const struct t_frustum *f, const struct t_cullset *cs, uint32_t *out) {
+	return f_cull_aabbs_part(f, cs, 0, cs->n, out);
+}
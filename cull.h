@@ -0,0 +1,45 @@
+#ifndef __H__CULL_H___
+#define __H__CULL_H___
+
+#include <stdint.h>
+
+#include "vecmath.h"
+
+/* Bounding volumes in structure of arrays layout: */
+/* a box (center, half extents) and a sphere (same center, radius) per object */
+struct t_cullset {
+	float *cx, *cy, *cz;
+	float *ex, *ey, *ez;
+	float *r;
+	unsigned long n, cap;
+};
+
+/* Box by center and half extents */
+struct t_aabb {
+	struct t_vec3 c, e;
+};
+
+/* Planes a*x + b*y + c*z + d >= 0 inside, normalized */
+struct t_frustum {
+	float p[6][4];
+};
+
+/* Culling output must have room for this many entries past the object count */
+#define CULL_SLACK 8
+
+int f_cullset_init(struct t_cullset *, unsigned long);
+void f_cullset_destroy(struct t_cullset *);
+long f_cullset_add(struct t_cullset *, struct t_vec3, struct t_vec3);
+void f_cullset_set(struct t_cullset *, unsigned long, struct t_vec3, struct t_vec3);
+struct t_aabb f_aabb_transform(const struct t_mat4 *, struct t_aabb);
+
+void f_frustum_extract(struct t_frustum *, const struct t_mat4 *);
+
+unsigned long f_cull_spheres_part(const struct t_frustum *, const struct t_cullset *, unsigned long, unsigned long, uint32_t *);
+unsigned long f_cull_aabbs_part(const struct t_frustum *, const struct t_cullset *, unsigned long, unsigned long, uint32_t *);
+unsigned long f_cull_spheres(const struct t_frustum *, const struct t_cullset *, uint32_t *);
+unsigned long f_cull_spheres_ref(const struct t_frustum *, const struct t_cullset *, uint32_t *);
+unsigned long f_cull_aabbs(const struct t_frustum *, const struct t_cullset *, uint32_t *);
+unsigned long f_cull_aabbs_ref(const struct t_frustum *, const struct t_cullset *, uint32_t *);
+
+#endif
@@ -0,0 +1,67 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <epoxy/gl.h>
+
+#include <stdlib.h>
+
+#include "frame.h"
+
+/* The pacing mode and rate come from the main thread (which owns the monitor), */
+/* RENDER_INPUT_CSV and RENDER_RECORD from the environment */
+void f_frame_init(struct t_framectl *fc, enum e_pacemode mode, double hz, const struct t_winsnapshot *snap) {
+	f_pace_init(&fc->pc, mode, hz, f_glfw_swapinterval);
+	f_inputlat_init(&fc->lt, getenv("RENDER_INPUT_CSV"));
+	fc->resizes = snap->resizes;
+
+	fc->recpath = getenv("RENDER_RECORD");
+	fc->recording = fc->recpath && !f_record_open(&fc->rec, fc->recpath, snap->width, snap->height);
+	if(fc->recpath && !fc->recording) fprintf(stderr, "Unable to record input to '%s'\n", fc->recpath);
+}
+
+/* Print the pacing and latency totals, and finish the recording */
+void f_frame_destroy(struct t_framectl *fc, FILE *out) {
+	f_pace_print(out, &fc->pc);
+	f_inputlat_print(out, &fc->lt);
+	f_inputlat_destroy(&fc->lt);
+	if(!fc->recording) return;
+
+	const unsigned long frames = fc->rec.frames;
+	if(f_record_close(&fc->rec)) fprintf(stderr, "Unable to write input recording '%s'\n", fc->recpath);
+	else fprintf(out, "Recorded %lu frames of input to '%s'\n", frames, fc->recpath);
+}
+
+/* Wait as long as the pacing mode wants before the frame samples its input */
+void f_frame_begin(struct t_framectl *fc) {
+	f_pace_begin(&fc->pc);
+}
+
+/* Whether the window was resized since the last frame (the resize is recorded) */
+int f_frame_resized(struct t_framectl *fc, const struct t_winsnapshot *snap) {
+	if(snap->resizes == fc->resizes) return 0;
+
+	fc->resizes = snap->resizes;
+	if(fc->recording) f_record_resize(&fc->rec, snap->width, snap->height);
+	return 1;
+}
+
+/* Events consumed by the frame */
+void f_frame_input(struct t_framectl *fc, const struct t_glfw_inputevent *ev, unsigned int n) {
+	f_inputlat_consume(&fc->lt, ev, n);
+	if(fc->recording) for(unsigned int i = 0; i < n; ++i) f_record_event(&fc->rec, &ev[i]);
+}
+
+/* The frame's input is complete, with the cursor where the frame sees it */
+void f_frame_sampled(struct t_framectl *fc, double mx, double my) {
+	if(fc->recording) f_record_frame(&fc->rec, mx, my);
+}
+
+/* Swap on the pacing clock and stamp the presentation of the frame's input */
+void f_frame_present(struct t_framectl *fc, void *win) {
+	f_pace_submit(&fc->pc);
+	glfwSwapBuffers(win);
+
+	/* The latch predicts the next refresh from the swap actually completing */
+	if(fc->pc.mode == PACE_LATCH) glFinish();
+	f_pace_end(&fc->pc);
+	f_inputlat_present(&fc->lt);
+}
@@ -0,0 +1,33 @@
+#ifndef __H__FRAME_H___
+#define __H__FRAME_H___
+
+#include <stdio.h>
+
+#include "window.h"
+#include "pacing.h"
+#include "inputlat.h"
+#include "record.h"
+
+/* Bookkeeping around every windowed frame: pacing, input latency and, with */
+/* RENDER_RECORD, the input recording read back by --replay */
+struct t_framectl {
+	struct t_pacer pc;
+	struct t_inputlat lt;
+
+	struct t_recorder rec;
+	const char *recpath;
+	int recording;
+
+	/* Resize count of the last snapshot */
+	unsigned int resizes;
+};
+
+void f_frame_init(struct t_framectl *, enum e_pacemode, double, const struct t_winsnapshot *);
+void f_frame_destroy(struct t_framectl *, FILE *);
+void f_frame_begin(struct t_framectl *);
+int f_frame_resized(struct t_framectl *, const struct t_winsnapshot *);
+void f_frame_input(struct t_framectl *, const struct t_glfw_inputevent *, unsigned int);
+void f_frame_sampled(struct t_framectl *, double, double);
+void f_frame_present(struct t_framectl *, void *);
+
+#endif
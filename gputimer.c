@@ -0,0 +1,87 @@
+#include <epoxy/gl.h>
+
+#include <stdint.h>
+
+#include "gputimer.h"
+
+/* References
+ * ----------
+ * ARB_timer_query
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_timer_query.txt"
+ */
+
+const char* const gpupass_names[GPASS_COUNT] = { "clear", "draw", "swap" };
+
+
+/* Create queries, and optionally a CSV file receiving one line per resolved frame */
+void f_gputimer_init(struct t_gputimer *gt, const char *csvpath) {
+	*gt = (struct t_gputimer){0};
+	glGenQueries(GPUTIMER_LATENCY * (GPASS_COUNT + 1), &gt->q[0][0]);
+
+	if(csvpath && (gt->csv = fopen(csvpath, "w"))) {
+		fprintf(gt->csv, "frame");
+		for(int p = 0; p < GPASS_COUNT; ++p) fprintf(gt->csv, ",%s_ms", gpupass_names[p]);
+		fputc('\n', gt->csv);
+	}
+}
+
+void f_gputimer_destroy(struct t_gputimer *gt) {
+	glDeleteQueries(GPUTIMER_LATENCY * (GPASS_COUNT + 1), &gt->q[0][0]);
+	if(gt->csv) fclose(gt->csv);
+	gt->csv = NULL;
+}
+
+/* Read back the queries of a slot if the GPU has finished them - never waits */
+static void f_gputimer_collect(struct t_gputimer *gt, unsigned int slot) {
+	if(!gt->pending[slot]) return;
+	gt->pending[slot] = 0;
+
+	/* Timestamps complete in order, so the last one being ready implies all are */
+	int avail = 0;
+	glGetQueryObjectiv(gt->q[slot][GPASS_COUNT], GL_QUERY_RESULT_AVAILABLE, &avail);
+	if(!avail) { gt->dropped++; return; }
+
+	uint64_t ts[GPASS_COUNT + 1];
+	for(int i = 0; i <= GPASS_COUNT; ++i)
+		glGetQueryObjectui64v(gt->q[slot][i], GL_QUERY_RESULT, &ts[i]);
+
+	/* Frame number of the collected slot */
+	const unsigned long frame = gt->frames - GPUTIMER_LATENCY;
+	double *h = gt->hist[gt->resolved % GPUTIMER_HISTORY];
+	for(int p = 0; p < GPASS_COUNT; ++p)
+		h[p] = gt->last[p] = (ts[p+1] - ts[p]) * 1e-6;
+	gt->resolved++;
+
+	if(gt->csv) {
+		fprintf(gt->csv, "%lu", frame);
+		for(int p = 0; p < GPASS_COUNT; ++p) fprintf(gt->csv, ",%.4f", gt->last[p]);
+		fputc('\n', gt->csv);
+	}
+}
+
+/* Start of frame: recycle the oldest query set, then stamp the frame start */
+void f_gputimer_begin(struct t_gputimer *gt) {
+	gt->slot = gt->frames % GPUTIMER_LATENCY;
+	f_gputimer_collect(gt, gt->slot);
+	glQueryCounter(gt->q[gt->slot][0], GL_TIMESTAMP);
+}
+
+/* Stamp the end of a pass (passes must be marked in order) */
+void f_gputimer_mark(struct t_gputimer *gt, enum e_gpupass p) {
+	glQueryCounter(gt->q[gt->slot][p + 1], GL_TIMESTAMP);
+}
+
+void f_gputimer_end(struct t_gputimer *gt) {
+	gt->pending[gt->slot] = 1;
+	gt->frames++;
+}
+
+/* Average GPU milliseconds of a pass over the history window */
+double f_gputimer_avg(const struct t_gputimer *gt, enum e_gpupass p) {
+	const unsigned long n = gt->resolved < GPUTIMER_HISTORY ? gt->resolved : GPUTIMER_HISTORY;
+	if(!n) return 0;
+
+	double sum = 0;
+	for(unsigned long i = 0; i < n; ++i) sum += gt->hist[i][p];
+	return sum / n;
+}
@@ -0,0 +1,39 @@
+#ifndef __H__GPUTIMER_H___
+#define __H__GPUTIMER_H___
+
+#include <stdio.h>
+
+/* Render passes timed on the GPU, in submission order */
+enum e_gpupass { GPASS_CLEAR, GPASS_DRAW, GPASS_SWAP, GPASS_COUNT };
+
+/* Number of frames of queries in flight - results are read this many frames late */
+#define GPUTIMER_LATENCY 3
+/* Number of resolved frames averaged over */
+#define GPUTIMER_HISTORY 64
+
+/* Timestamp queries bracketing each pass, one set per frame in flight */
+struct t_gputimer {
+	unsigned int q[GPUTIMER_LATENCY][GPASS_COUNT + 1];
+	unsigned char pending[GPUTIMER_LATENCY];
+	unsigned int slot;
+
+	/* Frames submitted, resolved, and discarded because results were late */
+	unsigned long frames, resolved, dropped;
+
+	/* Per pass GPU milliseconds: latest resolved frame and rolling history */
+	double last[GPASS_COUNT];
+	double hist[GPUTIMER_HISTORY][GPASS_COUNT];
+
+	FILE *csv;
+};
+
+void f_gputimer_init(struct t_gputimer *, const char *);
+void f_gputimer_destroy(struct t_gputimer *);
+void f_gputimer_begin(struct t_gputimer *);
+void f_gputimer_mark(struct t_gputimer *, enum e_gpupass);
+void f_gputimer_end(struct t_gputimer *);
+double f_gputimer_avg(const struct t_gputimer *, enum e_gpupass);
+
+extern const char* const gpupass_names[GPASS_COUNT];
+
+#endif
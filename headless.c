@@ -0,0 +1,140 @@
+#define _POSIX_C_SOURCE 200112L
+#include <epoxy/egl.h>
+#include <epoxy/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "headless.h"
+
+/* References
+ * ----------
+ * EGL_MESA_platform_surfaceless
+ * "https://registry.khronos.org/EGL/extensions/MESA/EGL_MESA_platform_surfaceless.txt"
+ * EGL_KHR_no_config_context
+ * "https://registry.khronos.org/EGL/extensions/KHR/EGL_KHR_no_config_context.txt"
+ */
+
+
+/* Create an OpenGL 4.6 core context with no window surface, */
+/* and an RGBA8 framebuffer object to render into instead */
+int f_headless_init(struct t_headless *hl, int width, int height) {
+	/* Mesa software rasterizers only advertise 4.5 by default, */
+	/* but support everything the renderer uses (user settings take precedence) */
+	setenv("MESA_GL_VERSION_OVERRIDE", "4.6", 0);
+	setenv("MESA_GLSL_VERSION_OVERRIDE", "460", 0);
+
+	*hl = (struct t_headless){ .width = width, .height = height };
+
+	EGLDisplay dpy = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if(dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, NULL, NULL)) return -1;
+
+	if(!eglBindAPI(EGL_OPENGL_API)) return eglTerminate(dpy), -2;
+
+	const EGLint attr[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 6,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	EGLContext ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attr);
+	if(ctx == EGL_NO_CONTEXT) return eglTerminate(dpy), -3;
+
+	if(!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx))
+		return eglDestroyContext(dpy, ctx), eglTerminate(dpy), -4;
+
+	hl->dpy = dpy, hl->ctx = ctx;
+
+	/* Offscreen target replacing the default framebuffer */
+	glGenRenderbuffers(1, &hl->rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, hl->rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenFramebuffers(1, &hl->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, hl->fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, hl->rbo);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		return f_headless_destroy(hl), -5;
+
+	return 0;
+}
+
+void f_headless_destroy(struct t_headless *hl) {
+	if(hl->fbo) glDeleteFramebuffers(1, &hl->fbo);
+	if(hl->rbo) glDeleteRenderbuffers(1, &hl->rbo);
+
+	eglMakeCurrent(hl->dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(hl->dpy, hl->ctx);
+	eglTerminate(hl->dpy);
+
+	*hl = (struct t_headless){0};
+}
+
+/* Read back the color attachment as tightly packed RGB, top row first */
+/* Caller frees the returned buffer */
+unsigned char* f_headless_readback(struct t_headless *hl) {
+	const size_t stride = (size_t)hl->width * 3;
+	unsigned char *px = malloc(stride * hl->height);
+	unsigned char *row = malloc(stride);
+	if(!px || !row) return free(px), free(row), NULL;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, hl->fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, hl->width, hl->height, GL_RGB, GL_UNSIGNED_BYTE, px);
+
+	/* OpenGL origin is bottom left */
+	for(int y = 0; y < hl->height / 2; ++y) {
+		unsigned char *a = px + y * stride, *b = px + (hl->height - 1 - y) * stride;
+		memcpy(row, a, stride), memcpy(a, b, stride), memcpy(b, row, stride);
+	}
+
+	free(row);
+	return px;
+}
+
+
+/* ------------------------------ *
+ * Binary PPM (P6) image handling *
+ * ------------------------------ */
+
+unsigned char* f_ppm_read(const char *path, int *width, int *height) {
+	FILE *f = fopen(path, "rb");
+	if(!f) return NULL;
+
+	int maxval;
+	unsigned char *px = NULL;
+	if(fscanf(f, "P6 %d %d %d", width, height, &maxval) != 3 || maxval != 255 || fgetc(f) == EOF)
+		goto end;
+	if(*width <= 0 || *height <= 0) goto end;
+
+	const size_t sz = (size_t)*width * *height * 3;
+	px = malloc(sz);
+	if(px && fread(px, 1, sz, f) != sz) free(px), px = NULL;
+
+end:
+	fclose(f);
+	return px;
+}
+
+int f_ppm_write(const char *path, const unsigned char *px, int width, int height) {
+	FILE *f = fopen(path, "wb");
+	if(!f) return -1;
+
+	const size_t sz = (size_t)width * height * 3;
+	fprintf(f, "P6\n%d %d\n255\n", width, height);
+	const int ok = fwrite(px, 1, sz, f) == sz;
+
+	return (fclose(f) || !ok) ? -1 : 0;
+}
+
+/* Count pixels where any channel differs by more than the tolerance */
+unsigned long f_image_diff(const unsigned char *a, const unsigned char *b, unsigned long npx, int tol) {
+	unsigned long bad = 0;
+	for(unsigned long i = 0; i < npx * 3; i += 3)
+		for(int c = 0; c < 3; ++c)
+			if(abs(a[i+c] - b[i+c]) > tol) { bad++; break; }
+	return bad;
+}
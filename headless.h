@@ -0,0 +1,20 @@
+#ifndef __H__HEADLESS_H___
+#define __H__HEADLESS_H___
+
+/* Offscreen rendering target for machines without a display or GPU */
+/* (EGL surfaceless platform - works with Mesa llvmpipe/softpipe) */
+struct t_headless {
+	void *dpy, *ctx;
+	unsigned int fbo, rbo;
+	int width, height;
+};
+
+int f_headless_init(struct t_headless *, int, int);
+void f_headless_destroy(struct t_headless *);
+unsigned char* f_headless_readback(struct t_headless *);
+
+unsigned char* f_ppm_read(const char *, int *, int *);
+int f_ppm_write(const char *, const unsigned char *, int, int);
+unsigned long f_image_diff(const unsigned char *, const unsigned char *, unsigned long, int);
+
+#endif
@@ -0,0 +1,194 @@
+#include <epoxy/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "hotreload.h"
+
+/* References
+ * ----------
+ * inotify(7)
+ * "https://man7.org/linux/man-pages/man7/inotify.7.html"
+ * KHR_parallel_shader_compile
+ * "https://registry.khronos.org/OpenGL/extensions/KHR/KHR_parallel_shader_compile.txt"
+ */
+
+static void* f_hotreload_thread(void *);
+
+/* Start watching the shader directory, with a thread reading changed files */
+/* Without KHR_parallel_shader_compile, programs are also built on that thread, */
+/* which makes the shared context current with the given function */
+int f_hotreload_init(struct t_hotreload *hr, void *shared, void (*makecurrent)(void *)) {
+	*hr = (struct t_hotreload){ .shared = shared, .makecurrent = makecurrent };
+
+	hr->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(hr->fd < 0) return -1;
+
+	/* Editors often write a new file and rename it over the old one */
+	if(inotify_add_watch(hr->fd, f_shader_dir(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		return close(hr->fd), -2;
+
+	hr->parallel = epoxy_has_gl_extension("GL_KHR_parallel_shader_compile");
+	if(!hr->parallel && (!shared || !makecurrent)) return close(hr->fd), -3;
+
+	pthread_mutex_init(&hr->lock, NULL);
+	pthread_cond_init(&hr->cond, NULL);
+	if(pthread_create(&hr->thread, NULL, f_hotreload_thread, hr))
+		return close(hr->fd), -4;
+
+	return 0;
+}
+
+void f_hotreload_destroy(struct t_hotreload *hr) {
+	pthread_mutex_lock(&hr->lock);
+	hr->quit = 1;
+	pthread_cond_signal(&hr->cond);
+	pthread_mutex_unlock(&hr->lock);
+
+	pthread_join(hr->thread, NULL);
+	pthread_mutex_destroy(&hr->lock);
+	pthread_cond_destroy(&hr->cond);
+
+	/* Only programs built here and not swapped in are still ours - a queued */
+	/* build the thread never started has no program yet */
+	for(unsigned int i = 0; i < hr->nprogs; ++i) {
+		struct t_hotprog *p = &hr->progs[i];
+		if(p->req.pending) f_program_wait(&p->req, 1);
+		if(p->req.sp) glDeleteProgram(p->req.sp);
+		free(p->vsrc), free(p->fsrc);
+	}
+
+	close(hr->fd);
+}
+
+/* Rebuild *target from the two files (names in the shader directory) when they change */
+/* The strings must outlive the watcher */
+int f_hotreload_watch(struct t_hotreload *hr, const char *vname, const char *fname, unsigned int *target) {
+	if(hr->nprogs >= HOTRELOAD_MAXPROGS) return -1;
+
+	pthread_mutex_lock(&hr->lock);
+	hr->progs[hr->nprogs++] = (struct t_hotprog){ .vname = vname, .fname = fname, .target = target };
+	pthread_mutex_unlock(&hr->lock);
+	return 0;
+}
+
+/* Read both files, returns 0 if they could be (the caller frees either way) */
+static int f_hotreload_read(struct t_hotprog *p, char **vsrc, char **fsrc) {
+	*vsrc = f_shader_read(p->vname), *fsrc = f_shader_read(p->fname);
+	return *vsrc && *fsrc ? 0 : -1;
+}
+
+/* Issue compile and link without waiting for either */
+/* Edited sources rarely come back, so the binary cache is neither read nor written */
+static void f_hotreload_start(struct t_hotprog *p, const char *vsrc, const char *fsrc) {
+	p->req = (struct t_progreq){ .vs = vsrc, .fs = fsrc, .nocache = 1 };
+	f_program_begin(&p->req, 1);
+	p->req.vs = p->req.fs = NULL;
+}
+
+/* Builds that fail keep the old program */
+static int f_hotreload_finish(struct t_hotprog *p) {
+	if(!p->req.sp) fprintf(stderr, "Reloading %s + %s failed, keeping the old program\n", p->vname, p->fname);
+	return p->req.sp != 0;
+}
+
+/* Reads the sources of programs being rebuilt - with parallel compilation they are */
+/* handed back to the rendering thread, otherwise they are compiled synchronously */
+/* here on the shared context */
+static void* f_hotreload_thread(void *arg) {
+	struct t_hotreload *hr = arg;
+	if(!hr->parallel) hr->makecurrent(hr->shared);
+
+	pthread_mutex_lock(&hr->lock);
+	while(!hr->quit) {
+		struct t_hotprog *p = NULL;
+		for(unsigned int i = 0; i < hr->nprogs && !p; ++i)
+			if(hr->progs[i].reading) p = &hr->progs[i];
+
+		if(!p) {
+			pthread_cond_wait(&hr->cond, &hr->lock);
+			continue;
+		}
+
+		pthread_mutex_unlock(&hr->lock);
+		char *vsrc, *fsrc;
+		int ok = !f_hotreload_read(p, &vsrc, &fsrc);
+		if(ok && !hr->parallel) {
+			f_hotreload_start(p, vsrc, fsrc);
+			f_program_wait(&p->req, 1), ok = f_hotreload_finish(p);
+			/* Make sure the program is complete before another context uses it */
+			glFinish();
+		}
+		if(!ok || !hr->parallel) free(vsrc), free(fsrc), vsrc = fsrc = NULL;
+		pthread_mutex_lock(&hr->lock);
+
+		p->reading = 0;
+		if(ok && hr->parallel) p->vsrc = vsrc, p->fsrc = fsrc, p->loaded = 1;
+		else p->building = 0, p->ready = ok;
+	}
+	pthread_mutex_unlock(&hr->lock);
+
+	if(!hr->parallel) hr->makecurrent(NULL);
+	return NULL;
+}
+
+/* Mark programs using a changed file as dirty */
+static void f_hotreload_events(struct t_hotreload *hr) {
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while((len = read(hr->fd, buf, sizeof buf)) > 0) {
+		for(char *c = buf; c < buf + len; ) {
+			const struct inotify_event *ev = (const struct inotify_event*)c;
+			c += sizeof *ev + ev->len;
+			if(!ev->len) continue;
+
+			for(unsigned int i = 0; i < hr->nprogs; ++i) {
+				struct t_hotprog *p = &hr->progs[i];
+				if(!strcmp(ev->name, p->vname) || !strcmp(ev->name, p->fname)) p->dirty = 1;
+			}
+		}
+	}
+}
+
+/* Call once per frame on the rendering thread - never blocks, and only issues */
+/* builds and completion queries, the files are read on the thread */
+/* Returns the number of programs swapped in, so the caller can rebind them */
+unsigned int f_hotreload_update(struct t_hotreload *hr) {
+	unsigned int swapped = 0;
+
+	pthread_mutex_lock(&hr->lock);
+	f_hotreload_events(hr);
+
+	for(unsigned int i = 0; i < hr->nprogs; ++i) {
+		struct t_hotprog *p = &hr->progs[i];
+
+		if(p->loaded) {
+			f_hotreload_start(p, p->vsrc, p->fsrc);
+			free(p->vsrc), free(p->fsrc);
+			p->vsrc = p->fsrc = NULL;
+			p->loaded = 0;
+		}
+
+		/* Without parallel compilation the request belongs to the thread */
+		if(hr->parallel && p->req.pending && !f_program_poll(&p->req, 1))
+			p->building = 0, p->ready = f_hotreload_finish(p);
+
+		if(p->ready) {
+			glDeleteProgram(*p->target);
+			*p->target = p->req.sp;
+			p->req.sp = 0;
+			p->ready = 0;
+			swapped++;
+		}
+
+		/* Saving again while building restarts once the current build is done */
+		if(p->dirty && !p->building) p->dirty = 0, p->building = p->reading = 1;
+	}
+
+	pthread_cond_signal(&hr->cond), pthread_mutex_unlock(&hr->lock);
+	return swapped;
+}
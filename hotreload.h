@@ -0,0 +1,53 @@
+#ifndef __H__HOTRELOAD_H___
+#define __H__HOTRELOAD_H___
+
+#include <pthread.h>
+
+#include "shader.h"
+
+#define HOTRELOAD_MAXPROGS 16
+
+/* A program rebuilt from its shader files whenever one of them changes */
+struct t_hotprog {
+	const char *vname, *fname;
+	unsigned int *target;
+
+	/* Program being built - polled until complete, swapped in on success */
+	/* (req.sp is cleared once it is, the target owns it from then on) */
+	struct t_progreq req;
+
+	/* Sources read by the thread, compiled on the next update (parallel builds) */
+	char *vsrc, *fsrc;
+
+	/* Separate bytes, the thread writes building, reading, loaded and ready under the lock */
+	unsigned char dirty;
+	unsigned char building;
+	unsigned char reading;
+	unsigned char loaded;
+	unsigned char ready;
+};
+
+/* Watches the shader directory with inotify and rebuilds programs in the background, */
+/* either with KHR_parallel_shader_compile, or on a thread owning a shared context */
+/* The shader files are always read on the thread, never on the rendering one */
+struct t_hotreload {
+	int fd;
+	struct t_hotprog progs[HOTRELOAD_MAXPROGS];
+	unsigned int nprogs;
+
+	unsigned char parallel:1;
+	unsigned char quit:1;
+
+	void *shared;
+	void (*makecurrent)(void *);
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+int f_hotreload_init(struct t_hotreload *, void *, void (*)(void *));
+void f_hotreload_destroy(struct t_hotreload *);
+int f_hotreload_watch(struct t_hotreload *, const char *, const char *, unsigned int *);
+unsigned int f_hotreload_update(struct t_hotreload *);
+
+#endif
@@ -0,0 +1,106 @@
+#include <stdio.h>
+
+#include "clock.h"
+#include "inputlat.h"
+
+/* References
+ * ----------
+ * Intel, PresentMon [frame presentation and input to photon latency]
+ * "https://github.com/GameTechDev/PresentMon"
+ */
+
+
+static unsigned int f_inputlat_bin(double t) {
+	const double b = t / INPUTLAT_BINWIDTH;
+	return b <= 0 ? 0 : b >= INPUTLAT_BINS - 1 ? INPUTLAT_BINS - 1 : (unsigned int)b;
+}
+
+/* Optionally with a CSV file receiving one line per frame that consumed events */
+void f_inputlat_init(struct t_inputlat *lt, const char *csvpath) {
+	*lt = (struct t_inputlat){0};
+
+	if(csvpath && (lt->csv = fopen(csvpath, "w"))) {
+		fprintf(lt->csv, "frame,events,consume_ms,present_ms,worst_ms");
+		for(int b = 0; b < INPUTLAT_BINS - 1; ++b) fprintf(lt->csv, ",lt%g_ms", (b + 1) * INPUTLAT_BINWIDTH * 1e3);
+		fprintf(lt->csv, ",ge%g_ms", (INPUTLAT_BINS - 1) * INPUTLAT_BINWIDTH * 1e3);
+		fputc('\n', lt->csv);
+	}
+}
+
+void f_inputlat_destroy(struct t_inputlat *lt) {
+	if(lt->csv) fclose(lt->csv);
+	lt->csv = NULL;
+}
+
+/* A batch of events drained from the queue by the frame in progress */
+void f_inputlat_consume(struct t_inputlat *lt, const struct t_glfw_inputevent *ev, unsigned int n) {
+	const double now = f_clock_now();
+	for(unsigned int i = 0; i < n; ++i) {
+		lt->consumesum += now - ev[i].time;
+		if(lt->npending < INPUTLAT_MAXEVENTS) lt->pending[lt->npending++] = ev[i].time;
+	}
+	lt->nevents += n;
+}
+
+/* End of a frame, once its swap returned - frames without events are numbered */
+/* but not recorded */
+void f_inputlat_present(struct t_inputlat *lt) {
+	const unsigned long frame = lt->nframes++;
+	if(!lt->nevents) return;
+
+	const double now = f_clock_now();
+	struct t_latframe *f = &lt->frames[frame % INPUTLAT_HISTORY];
+	*f = (struct t_latframe){ .frame = frame, .nevents = lt->nevents };
+
+	double sum = 0;
+	for(unsigned int i = 0; i < lt->npending; ++i) {
+		const double t = now - lt->pending[i];
+		const unsigned int b = f_inputlat_bin(t);
+		f->hist[b]++, lt->hist[b]++;
+		sum += t;
+		if(t > f->worst) f->worst = t;
+	}
+	f->consume = lt->consumesum / lt->nevents;
+	f->present = sum / lt->npending;
+
+	lt->events += lt->nevents;
+	lt->unbinned += lt->nevents - lt->npending;
+	lt->consumesum_all += lt->consumesum;
+	lt->presentsum_all += sum;
+
+	if(lt->csv) {
+		fprintf(lt->csv, "%lu,%u,%.4f,%.4f,%.4f", frame, f->nevents, f->consume * 1e3, f->present * 1e3, f->worst * 1e3);
+		for(int b = 0; b < INPUTLAT_BINS; ++b) fprintf(lt->csv, ",%u", f->hist[b]);
+		fputc('\n', lt->csv);
+	}
+
+	lt->npending = lt->nevents = 0;
+	lt->consumesum = 0;
+}
+
+/* Record of a frame, NULL if it consumed no events or is no longer kept */
+const struct t_latframe* f_inputlat_frame(const struct t_inputlat *lt, unsigned long frame) {
+	if(frame >= lt->nframes || lt->nframes - frame > INPUTLAT_HISTORY) return NULL;
+
+	const struct t_latframe *f = &lt->frames[frame % INPUTLAT_HISTORY];
+	return f->nevents && f->frame == frame ? f : NULL;
+}
+
+/* Presentation latency below which a fraction p of the binned events fall, */
+/* to the bin width (the upper edge of its bin) */
+double f_inputlat_percentile(const struct t_inputlat *lt, double p) {
+	const unsigned long n = lt->events - lt->unbinned;
+	if(!n) return 0;
+
+	unsigned long sum = 0;
+	for(unsigned int b = 0; b < INPUTLAT_BINS; ++b)
+		if((sum += lt->hist[b]) >= p * n) return (b + 1) * INPUTLAT_BINWIDTH;
+	return INPUTLAT_BINS * INPUTLAT_BINWIDTH;
+}
+
+void f_inputlat_print(FILE *f, const struct t_inputlat *lt) {
+	const unsigned long binned = lt->events - lt->unbinned;
+	fprintf(f, "Input latency: %lu events, consume mean = %.3f ms, present mean = %.3f ms, median <= %.0f ms, p99 <= %.0f ms\n",
+		lt->events, lt->events ? lt->consumesum_all / lt->events * 1e3 : 0, binned ? lt->presentsum_all / binned * 1e3 : 0,
+		f_inputlat_percentile(lt, 0.5) * 1e3, f_inputlat_percentile(lt, 0.99) * 1e3);
+}
@@ -0,0 +1,55 @@
+#ifndef __H__INPUTLAT_H___
+#define __H__INPUTLAT_H___
+
+#include <stdio.h>
+
+#include "window.h"
+
+/* Latency histogram bins, the last one also counts everything above it */
+#define INPUTLAT_BINS 32
+#define INPUTLAT_BINWIDTH 0.001
+
+/* Events per frame whose presentation latency is binned, the rest are only counted */
+#define INPUTLAT_MAXEVENTS 1024
+
+/* Frames kept for the per frame API */
+#define INPUTLAT_HISTORY 256
+
+/* Input events consumed by one frame - latencies are from each event's callback */
+/* to the frame consuming it (draining the queue) and presenting it (the swap */
+/* returning), in seconds */
+struct t_latframe {
+	unsigned long frame;
+	unsigned int nevents;
+	double consume, present, worst;
+	unsigned int hist[INPUTLAT_BINS];
+};
+
+/* Input latency of every frame, kept for the last INPUTLAT_HISTORY frames, */
+/* summed over all of them, and optionally written to a CSV file per frame */
+struct t_inputlat {
+	/* Callback times of the events consumed by the frame in progress */
+	double pending[INPUTLAT_MAXEVENTS];
+	unsigned int npending, nevents;
+	double consumesum;
+
+	struct t_latframe frames[INPUTLAT_HISTORY];
+	unsigned long nframes;
+
+	/* All frames: presentation latency histogram, events, and their sums */
+	unsigned long hist[INPUTLAT_BINS];
+	unsigned long events, unbinned;
+	double consumesum_all, presentsum_all;
+
+	FILE *csv;
+};
+
+void f_inputlat_init(struct t_inputlat *, const char *);
+void f_inputlat_destroy(struct t_inputlat *);
+void f_inputlat_consume(struct t_inputlat *, const struct t_glfw_inputevent *, unsigned int);
+void f_inputlat_present(struct t_inputlat *);
+const struct t_latframe* f_inputlat_frame(const struct t_inputlat *, unsigned long);
+double f_inputlat_percentile(const struct t_inputlat *, double);
+void f_inputlat_print(FILE *, const struct t_inputlat *);
+
+#endif
@@ -0,0 +1,123 @@
+#include <epoxy/gl.h>
+
+#include <stddef.h>
+
+#include "instance.h"
+#include "shader.h"
+
+/* References
+ * ----------
+ * ARB_instanced_arrays
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_instanced_arrays.txt"
+ * ARB_vertex_attrib_binding
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_vertex_attrib_binding.txt"
+ */
+
+static const char* inst_vert_src =
+"#version 460 core\n"
+"\n"
+"layout(location = 0) in vec3 pos;\n"
+"layout(location = 1) in vec3 clr_in;\n"
+"layout(location = 2) in vec4 xform;\n"
+"layout(location = 3) in vec4 inst_clr;\n"
+"\n"
+"out vec3 clr;\n"
+"\n"
+"void main() {\n"
+"	vec2 cs = vec2(cos(xform.w), sin(xform.w));\n"
+"	vec2 p = mat2(cs.x, cs.y, -cs.y, cs.x) * pos.xy;\n"
+"	gl_Position = vec4(p * xform.z + xform.xy, pos.z, 1.0f);\n"
+"	clr = clr_in * inst_clr.rgb;\n"
+"}\n"
+;
+
+static const char* inst_frag_src =
+"#version 460 core\n"
+"\n"
+"in vec3 clr;\n"
+"\n"
+"out vec4 frag_clr;\n"
+"void main() {\n"
+"	frag_clr = vec4(clr, 1.0f);\n"
+"}\n"
+;
+
+/* Vertex buffer binding point of the instance stream */
+/* (0 and 1 are taken by f_vformat_apply, which binds each attribute to its own index) */
+#define INST_BINDING 2
+
+/* Register a mesh (indices are optional) for up to maxinst instances per frame */
+int f_instmesh_init(
+	struct t_instmesh *im,
+	const struct vert *v, unsigned int nv,
+	const uint32_t *idx, unsigned int ni,
+	unsigned int maxinst
+) {
+	*im = (struct t_instmesh){ .nverts = nv, .nidx = idx ? ni : 0, .maxinst = maxinst };
+
+	if(f_stream_init(&im->sb, maxinst * sizeof(struct t_instance))) return -1;
+
+	glGenVertexArrays(1, &im->vao);
+	glBindVertexArray(im->vao);
+
+	glGenBuffers(1, &im->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, im->vbo);
+	glBufferStorage(GL_ARRAY_BUFFER, nv * sizeof *v, v, 0);
+	f_vformat_apply(&vfmt_vert);
+
+	if(im->nidx) {
+		glGenBuffers(1, &im->ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, im->ibo);
+		glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, ni * sizeof *idx, idx, 0);
+	}
+
+	/* Instance attributes, advancing once per instance */
+	glEnableVertexAttribArray(2);
+	glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, offsetof(struct t_instance, xform));
+	glVertexAttribBinding(2, INST_BINDING);
+
+	glEnableVertexAttribArray(3);
+	glVertexAttribFormat(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(struct t_instance, clr));
+	glVertexAttribBinding(3, INST_BINDING);
+
+	glVertexBindingDivisor(INST_BINDING, 1);
+
+	im->sp = f_program_load(inst_vert_src, inst_frag_src);
+	if(!im->sp) return f_instmesh_destroy(im), -2;
+
+	return 0;
+}
+
+void f_instmesh_destroy(struct t_instmesh *im) {
+	if(im->sb.buf) f_stream_destroy(&im->sb);
+	glDeleteProgram(im->sp);
+	glDeleteVertexArrays(1, &im->vao);
+	glDeleteBuffers(1, &im->vbo);
+	glDeleteBuffers(1, &im->ibo);
+	*im = (struct t_instmesh){0};
+}
+
+/* Returns space for this frame's instances (maxinst entries), written in place */
+struct t_instance* f_instmesh_begin(struct t_instmesh *im) {
+	f_stream_begin(&im->sb);
+	im->inst = f_stream_alloc(&im->sb, im->maxinst * sizeof *im->inst, sizeof(float), &im->instoff);
+	return im->inst;
+}
+
+/* Draw the first n written instances with a single instanced draw call */
+void f_instmesh_draw(struct t_instmesh *im, unsigned int n) {
+	if(n > im->maxinst) n = im->maxinst;
+
+	if(n) {
+		glUseProgram(im->sp);
+		glBindVertexArray(im->vao);
+		glBindVertexBuffer(INST_BINDING, im->sb.buf, im->instoff, sizeof *im->inst);
+
+		if(im->nidx)
+			glDrawElementsInstanced(GL_TRIANGLES, im->nidx, GL_UNSIGNED_INT, NULL, n);
+		else
+			glDrawArraysInstanced(GL_TRIANGLES, 0, im->nverts, n);
+	}
+
+	f_stream_end(&im->sb);
+}
@@ -0,0 +1,33 @@
+#ifndef __H__INSTANCE_H___
+#define __H__INSTANCE_H___
+
+#include <stdint.h>
+
+#include "vertex.h"
+#include "stream.h"
+
+/* Per instance data, fed through a divisor 1 vertex stream */
+/* xform: x, y offset, scale, rotation (radians); clr multiplies the vertex color */
+struct t_instance {
+	float xform[4];
+	uint8_t clr[4];
+};
+
+/* A mesh registered once and drawn many times per call */
+struct t_instmesh {
+	unsigned int vao, vbo, ibo, sp;
+	unsigned int nverts, nidx;
+
+	/* Instance data of the current frame */
+	struct t_streambuf sb;
+	struct t_instance *inst;
+	size_t instoff;
+	unsigned int maxinst;
+};
+
+int f_instmesh_init(struct t_instmesh *, const struct vert *, unsigned int, const uint32_t *, unsigned int, unsigned int);
+void f_instmesh_destroy(struct t_instmesh *);
+struct t_instance* f_instmesh_begin(struct t_instmesh *);
+void f_instmesh_draw(struct t_instmesh *, unsigned int);
+
+#endif
@@ -0,0 +1,248 @@
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "jobs.h"
+
+/* References
+ * ----------
+ * D. Chase, Y. Lev, "Dynamic Circular Work-Stealing Deque" (SPAA 2005)
+ * N. M. Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+ * S. Reinalter, "Job System 2.0: Lock-Free Work Stealing"
+ * "https://blog.molecular-matters.com/2015/08/24/job-system-2-0-lock-free-work-stealing-part-1-basics/"
+ */
+
+/* Index of the calling thread in the (single) job system */
+static _Thread_local unsigned int jobs_tid;
+
+struct t_jobstart {
+	struct t_jobsys *js;
+	unsigned int tid;
+};
+
+
+/* ----- *
+ * Deque *
+ * ----- */
+
+static void f_deque_push(struct t_jobdeque *dq, struct t_job *j) {
+	const long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+	atomic_store_explicit(&dq->buf[b & (JOBS_POOL - 1)], j, memory_order_relaxed);
+	atomic_store_explicit(&dq->bottom, b + 1, memory_order_release);
+}
+
+static struct t_job* f_deque_pop(struct t_jobdeque *dq) {
+	const long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+	if(t > b) {
+		atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+
+	struct t_job *j = atomic_load_explicit(&dq->buf[b & (JOBS_POOL - 1)], memory_order_relaxed);
+	if(t == b) {
+		/* Last job, race against thieves for it */
+		if(!atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+			j = NULL;
+		atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+	}
+	return j;
+}
+
+static struct t_job* f_deque_steal(struct t_jobdeque *dq) {
+	long t = atomic_load_explicit(&dq->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	const long b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+	if(t >= b) return NULL;
+
+	struct t_job *j = atomic_load_explicit(&dq->buf[t & (JOBS_POOL - 1)], memory_order_relaxed);
+	if(!atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return j;
+}
+
+
+/* ---------- *
+ * Scheduling *
+ * ---------- */
+
+/* Own deque first, then a random victim */
+static struct t_job* f_jobs_get(struct t_jobsys *js) {
+	struct t_jobworker *w = &js->workers[jobs_tid];
+	struct t_job *j = f_deque_pop(&w->dq);
+
+	if(!j && js->nthreads > 1) {
+		w->rng ^= w->rng << 13, w->rng ^= w->rng >> 17, w->rng ^= w->rng << 5;
+		const unsigned int v = w->rng % js->nthreads;
+		if(v != jobs_tid) j = f_deque_steal(&js->workers[v].dq);
+	}
+
+	if(j) atomic_fetch_sub(&js->queued, 1);
+	return j;
+}
+
+/* The parent is read first, once unfinished reaches 0 a waiter may return */
+/* and the job's slot may be reused */
+static void f_job_finish(struct t_job *j) {
+	while(j) {
+		struct t_job *p = j->parent;
+		if(atomic_fetch_sub_explicit(&j->unfinished, 1, memory_order_acq_rel) != 1) break;
+		j = p;
+	}
+}
+
+static void f_job_execute(struct t_job *j) {
+	j->fn(j->data, j->begin, j->end);
+	f_job_finish(j);
+}
+
+static void* f_jobs_worker(void *arg) {
+	struct t_jobstart *st = arg;
+	struct t_jobsys *js = st->js;
+	jobs_tid = st->tid;
+	free(st);
+
+	while(!atomic_load(&js->quit)) {
+		struct t_job *j = f_jobs_get(js);
+		if(j) {
+			f_job_execute(j);
+			continue;
+		}
+
+		/* Queued jobs may sit in another deque we failed to steal from */
+		if(atomic_load(&js->queued) > 0) {
+			sched_yield();
+			continue;
+		}
+
+		/* Announce before checking again, so a producer either sees us sleeping */
+		/* or we see its job (both counters are sequentially consistent) */
+		pthread_mutex_lock(&js->lock);
+		atomic_fetch_add(&js->sleeping, 1);
+		while(atomic_load(&js->queued) <= 0 && !atomic_load(&js->quit))
+			pthread_cond_wait(&js->cond, &js->lock);
+		atomic_fetch_sub(&js->sleeping, 1);
+		pthread_mutex_unlock(&js->lock);
+	}
+
+	return NULL;
+}
+
+
+/* --- *
+ * API *
+ * --- */
+
+unsigned int f_jobs_cores(void) {
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n < 1 ? 1 : n > JOBS_MAXTHREADS ? JOBS_MAXTHREADS : n;
+}
+
+/* Start nthreads - 1 workers (0 for one per core) */
+int f_jobs_init(struct t_jobsys *js, unsigned int nthreads) {
+	if(!nthreads) nthreads = f_jobs_cores();
+	if(nthreads > JOBS_MAXTHREADS) nthreads = JOBS_MAXTHREADS;
+
+	*js = (struct t_jobsys){ .nthreads = nthreads };
+	js->workers = aligned_alloc(64, nthreads * sizeof *js->workers);
+	if(!js->workers) return -1;
+
+	for(unsigned int i = 0; i < nthreads; ++i) {
+		struct t_jobworker *w = &js->workers[i];
+		atomic_init(&w->dq.top, 0), atomic_init(&w->dq.bottom, 0);
+		w->allocated = 0;
+		w->rng = 0x9E3779B9u * (i + 1);
+	}
+
+	pthread_mutex_init(&js->lock, NULL);
+	pthread_cond_init(&js->cond, NULL);
+	jobs_tid = 0;
+
+	for(unsigned int i = 1; i < nthreads; ++i) {
+		struct t_jobstart *st = malloc(sizeof *st);
+		if(st) *st = (struct t_jobstart){ js, i };
+		if(!st || pthread_create(&js->workers[i].thread, NULL, f_jobs_worker, st)) {
+			free(st);
+			js->nthreads = i;
+			f_jobs_destroy(js);
+			return -2;
+		}
+	}
+
+	return 0;
+}
+
+void f_jobs_destroy(struct t_jobsys *js) {
+	if(!js->workers) return;
+
+	pthread_mutex_lock(&js->lock);
+	atomic_store(&js->quit, 1);
+	pthread_cond_broadcast(&js->cond);
+	pthread_mutex_unlock(&js->lock);
+
+	for(unsigned int i = 1; i < js->nthreads; ++i) pthread_join(js->workers[i].thread, NULL);
+
+	pthread_mutex_destroy(&js->lock);
+	pthread_cond_destroy(&js->cond);
+	free(js->workers);
+	*js = (struct t_jobsys){0};
+}
+
+/* A job processing items [begin, end) of data, counted as a child of parent (if any) */
+struct t_job* f_job_create(struct t_jobsys *js, f_jobfn fn, void *data, unsigned long begin, unsigned long end, struct t_job *parent) {
+	struct t_jobworker *w = &js->workers[jobs_tid];
+	struct t_job *j = &w->pool[w->allocated++ & (JOBS_POOL - 1)];
+
+	j->fn = fn, j->data = data;
+	j->begin = begin, j->end = end;
+	j->parent = parent;
+	atomic_store_explicit(&j->unfinished, 1, memory_order_relaxed);
+	if(parent) atomic_fetch_add_explicit(&parent->unfinished, 1, memory_order_relaxed);
+	return j;
+}
+
+void f_job_run(struct t_jobsys *js, struct t_job *j) {
+	f_deque_push(&js->workers[jobs_tid].dq, j);
+	atomic_fetch_add(&js->queued, 1);
+
+	if(atomic_load(&js->sleeping) > 0) {
+		pthread_mutex_lock(&js->lock);
+		pthread_cond_signal(&js->cond);
+		pthread_mutex_unlock(&js->lock);
+	}
+}
+
+/* Execute other jobs until this one and all its children are done */
+void f_job_wait(struct t_jobsys *js, struct t_job *j) {
+	while(atomic_load_explicit(&j->unfinished, memory_order_acquire) > 0) {
+		struct t_job *o = f_jobs_get(js);
+		if(o) f_job_execute(o);
+		else sched_yield();
+	}
+}
+
+static void f_jobs_nop(void *data, unsigned long begin, unsigned long end) {
+	(void)data, (void)begin, (void)end;
+}
+
+/* Call fn on chunks of [0, count) of exactly grain items (the last may be shorter), */
+/* each starting on a multiple of grain, across all workers, and wait */
+/* Chunks are queued in batches that fit in the job pool, waiting for each batch */
+void f_jobs_parallel_for(struct t_jobsys *js, unsigned long count, unsigned long grain, f_jobfn fn, void *data) {
+	if(!grain) grain = 1;
+
+	const unsigned long batch = grain > count / (JOBS_POOL / 2) ? count : grain * (JOBS_POOL / 2);
+	for(unsigned long b = 0; b < count; b += batch) {
+		const unsigned long bend = count - b > batch ? b + batch : count;
+
+		struct t_job *root = f_job_create(js, f_jobs_nop, NULL, 0, 0, NULL);
+		for(unsigned long i = b; i < bend; i += grain)
+			f_job_run(js, f_job_create(js, fn, data, i, bend - i > grain ? i + grain : bend, root));
+
+		f_job_run(js, root);
+		f_job_wait(js, root);
+	}
+}
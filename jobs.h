@@ -0,0 +1,61 @@
+#ifndef __H__JOBS_H___
+#define __H__JOBS_H___
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Per thread limits, both powers of two: jobs in flight, and workers */
+#define JOBS_POOL 4096
+#define JOBS_MAXTHREADS 64
+
+/* A function called on a range of items, e.g. one chunk of a parallel loop */
+typedef void (*f_jobfn)(void *, unsigned long, unsigned long);
+
+/* A job counts itself and its unfinished children, */
+/* it is complete once the count drops to zero */
+struct t_job {
+	f_jobfn fn;
+	void *data;
+	unsigned long begin, end;
+	struct t_job *parent;
+	atomic_int unfinished;
+};
+
+/* Chase-Lev deque: the owner pushes and pops at the bottom, */
+/* other threads steal from the top */
+struct t_jobdeque {
+	atomic_long top, bottom;
+	_Atomic(struct t_job *) buf[JOBS_POOL];
+};
+
+/* Jobs are taken from a per thread ring, and must finish before it wraps */
+struct t_jobworker {
+	struct t_jobdeque dq;
+	struct t_job pool[JOBS_POOL];
+	unsigned long allocated;
+	unsigned int rng;
+	pthread_t thread;
+} __attribute__((aligned(64)));
+
+/* The thread calling f_jobs_init is worker 0, the others are spawned */
+/* Only workers can create, run and wait for jobs */
+struct t_jobsys {
+	struct t_jobworker *workers;
+	unsigned int nthreads;
+
+	/* Idle workers sleep until jobs are queued */
+	atomic_long queued;
+	atomic_int sleeping, quit;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+unsigned int f_jobs_cores(void);
+int f_jobs_init(struct t_jobsys *, unsigned int);
+void f_jobs_destroy(struct t_jobsys *);
+struct t_job* f_job_create(struct t_jobsys *, f_jobfn, void *, unsigned long, unsigned long, struct t_job *);
+void f_job_run(struct t_jobsys *, struct t_job *);
+void f_job_wait(struct t_jobsys *, struct t_job *);
+void f_jobs_parallel_for(struct t_jobsys *, unsigned long, unsigned long, f_jobfn, void *);
+
+#endif
@@ -1,104 +1,385 @@
+#define _DEFAULT_SOURCE
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <epoxy/gl.h>
 
 #include <stdio.h>
-#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "window.h"
+#include "render.h"
+#include "benchmarks.h"
+#include "headless.h"
+#include "bench.h"
+#include "clock.h"
+#include "gputimer.h"
+#include "hotreload.h"
+#include "camera.h"
+#include "jobs.h"
+#include "texture.h"
+#include "bcenc.h"
+#include "texbin.h"
+#include "pacing.h"
+#include "frame.h"
+#include "record.h"
+
+/* Golden image comparison: per-channel tolerance, and how many pixels */
+/* (per thousand) may exceed it - rasterization rules differ slightly between drivers */
+#define GOLDEN_TOLERANCE 2
+#define GOLDEN_MAXBAD_PERMILLE 5
+
+/* Simulated time between two replayed frames (s) */
+#define RENDER_REPLAY_STEP (1.0 / 60)
 
 struct t_glfw_winstate ws = {
 	.width = 0, .height = 0,
 	.mx = 0, .my = 0,
 	.time = 0,
 
-	.iqstart = 0, .iqlength = 0, .iqmaxsz = 0,
-	.iq = (void*)0,
-
 	.szrefresh = 1,
 	.runstate = 1,
-	.iqoverflow = 0,
 };
 
-const char* vert_src =
-"#version 460 core\n"
-"\n"
-"layout(location = 0) in vec3 pos;\n"
-"layout(location = 1) in vec3 clr_in;\n"
-"\n"
-"out vec3 clr;\n"
-"\n"
-"void main() {\n"
-"	gl_Position = vec4(pos, 1.0f);\n"
-"	clr = clr_in;\n"
-"}\n"
-;
-
-const char* frag_src =
-"#version 460 core\n"
-"\n"
-"in vec3 clr;\n"
-"\n"
-"out vec4 frag_clr;\n"
-"void main() {\n"
-"	frag_clr = vec4(clr, 1.0f);\n"
-"}\n"
-;
-
-struct vert {
-	int32_t pos[3];
-	uint8_t clr[3];
-};
+/* Convert a PPM or TGA image to a texture container with its mip chain */
+/* Without a format, images named *_n or *_normal are normal maps (BC5, linear), */
+/* anything else is color (BC7, sRGB) */
+int f_bake_texture(const char *in, const char *out, const char *format) {
+	const char *dot = strrchr(in, '.');
+	const size_t stem = dot ? (size_t)(dot - in) : strlen(in);
+	const int normal = (stem > 2 && !strncmp(in + stem - 2, "_n", 2)) || (stem > 7 && !strncmp(in + stem - 7, "_normal", 7));
+
+	enum e_bcfmt fmt = normal ? BCFMT_BC5 : BCFMT_BC7;
+	for(int f = 0; format && f < BCFMT_COUNT; ++f)
+		if(!strcasecmp(format, bcfmt_names[f])) fmt = f;
+
+	int w, h;
+	unsigned char *px = f_image_read(in, &w, &h);
+	if(!px) return fprintf(stderr, "Unable to read '%s'\n", in), -1;
+
+	struct t_jobsys js;
+	struct t_jobsys *jobs = f_render_startjobs(&js);
+
+	struct t_texbin tb;
+	const double t0 = f_clock_now();
+	int ret = f_texbin_build(&tb, px, w, h, fmt, fmt != BCFMT_BC5, jobs);
+	if(!ret) {
+		printf("%s: %dx%d, %u levels, %s, %.1f KB in %.3f s\n",
+			out, w, h, tb.h->nlevels, bcfmt_names[fmt], tb.size / 1024.0, f_clock_now() - t0);
+		ret = f_texbin_write(&tb, out);
+		f_texbin_close(&tb);
+	}
 
-struct vert vertices[] = {
-	{ { -1, -1, 0 }, { 0xFF, 0x00, 0x00 } },
-	{ {  1, -1, 0 }, { 0x00, 0xFF, 0x00 } },
-	{ {  0,  1, 0 }, { 0x00, 0x00, 0xFF } },
+	if(jobs) f_jobs_destroy(jobs);
+	free(px);
+	if(ret) fprintf(stderr, "Unable to convert '%s' to '%s'\n", in, out);
+	return ret;
+}
+
+/* Shared by the event (main) thread and the render thread, which owns the GL */
+/* context - input goes through the window's queue, the rest through a snapshot */
+struct t_render_thread {
+	void *win, *shared;
+	const char *meshpath;
+	struct t_glfw_winstate *wst;
+	struct t_winshare share;
+	enum e_pacemode pacing;
+	double hz;
+	atomic_int done;
+	int ret;
 };
 
-void f_render_main(void* win) {
-	unsigned int VBO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+static int f_render_loop(struct t_render_thread *rt) {
+	struct t_jobsys js;
+	struct t_render_state rs;
+	if(f_render_setup(&rs, &js, rt->meshpath)) return -1;
+
+	/* Rebuild the main program when its shader files change */
+	struct t_hotreload hr;
+	const int reload = !f_hotreload_init(&hr, rt->shared, f_glfw_makecurrent);
+	if(reload) f_hotreload_watch(&hr, MAIN_VERT, MAIN_FRAG, &rs.sp);
+
+	struct t_camera cam;
+	f_camera_init(&cam);
+
+	/* Window state as of the last snapshot, the viewport follows its resizes */
+	/* (read after the pacing wait, with the input, so both are as late as can be) */
+	struct t_winsnapshot snap;
+	struct t_glfw_winstate rws = { .szrefresh = 1 };
+	f_winshare_read(&rt->share, &snap);
+
+	struct t_framectl fc;
+	f_frame_init(&fc, rt->pacing, rt->hz, &snap);
+
+	for(;;) {
+		f_frame_begin(&fc);
+		f_winshare_read(&rt->share, &snap);
+		if(!snap.runstate) break;
+
+		if(f_frame_resized(&fc, &snap)) rws.szrefresh = 1;
+		rws.width = snap.width, rws.height = snap.height;
+		rws.mx = snap.mx, rws.my = snap.my, rws.time = snap.time;
 
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+		if(reload && f_hotreload_update(&hr)) f_render_useprogram(&rs);
 
-	glBufferData(GL_ARRAY_BUFFER, sizeof vertices, vertices, GL_STATIC_DRAW);
+		/* Events queued by the callbacks since the last frame */
+		struct t_glfw_inputevent ev[RENDER_MAXEVENTS];
+		for(unsigned int n; (n = f_iqdrain(&rt->wst->iq, ev, RENDER_MAXEVENTS)); ) {
+			f_frame_input(&fc, ev, n);
+			for(unsigned int i = 0; i < n; ++i) f_camera_event(&cam, &ev[i]);
+		}
+		f_frame_sampled(&fc, rws.mx, rws.my);
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_INT, GL_FALSE, sizeof(struct vert), (void*)0);
+		f_camera_update(&cam, rws.mx, rws.my, rws.width, rws.height);
+		rs.viewproj = cam.viewproj;
+		rs.eye = cam.eye, rs.fovy = cam.fovy;
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(struct vert), (void*)(offsetof(struct vert, clr)));
+		f_render_frame(&rs, &rws);
+		f_frame_present(&fc, rt->win);
 
-	unsigned int vert = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vert, 1, &vert_src, NULL);
-	glCompileShader(vert);
+		f_gputimer_mark(&rs.gt, GPASS_SWAP);
+		f_gputimer_end(&rs.gt);
+	}
+	f_frame_destroy(&fc, stdout);
+
+	if(reload) f_hotreload_destroy(&hr);
+	f_render_destroy(&rs);
+	return 0;
+}
 
-	unsigned int frag = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(frag, 1, &frag_src, NULL);
-	glCompileShader(frag);
+/* Render thread: takes the context over from the main thread and hands it back */
+/* when done, then wakes the main thread up */
+static void* f_render_thread(void *data) {
+	struct t_render_thread *rt = data;
 
-	unsigned int sp = glCreateProgram();
-	glAttachShader(sp, vert);
-	glAttachShader(sp, frag);
-	glLinkProgram(sp);
-	glUseProgram(sp);
+	glfwMakeContextCurrent(rt->win);
+	rt->ret = f_render_loop(rt);
+	glfwMakeContextCurrent(NULL);
+
+	atomic_store(&rt->done, 1);
+	glfwPostEmptyEvent();
+	return NULL;
+}
 
-	struct t_glfw_winstate* wst = glfwGetWindowUserPointer(win);
-	for(glfwSetTime(0.0); wst->runstate; wst->time = glfwGetTime()) {
-		if(wst->szrefresh)
-			glViewport(0, 0, wst->width, wst->height), wst->szrefresh = 0;
+/* The main thread only waits for events and publishes the window state after */
+/* each batch, so input is picked up as it arrives instead of once per swap, */
+/* and the window stays responsive while a frame takes long */
+int f_render_main(void* win, const char *meshpath) {
+	struct t_render_thread rt = {
+		.win = win, .meshpath = meshpath,
+		.wst = glfwGetWindowUserPointer(win)
+	};
+	atomic_init(&rt.done, 0);
 
-		glClear(GL_COLOR_BUFFER_BIT);
-		glDrawArrays(GL_TRIANGLES, 0, 3);
+	/* Frame pacing: RENDER_PACING=vsync|off|adaptive|limit|latch, the limiter */
+	/* runs at RENDER_FPS frames per second, or the monitor's refresh rate */
+	const char *pace = getenv("RENDER_PACING"), *fps = getenv("RENDER_FPS");
+	const int mode = pace ? f_pace_parse(pace) : PACE_VSYNC;
+	if(mode < 0) fprintf(stderr, "Unknown pacing mode '%s', using vsync\n", pace);
+	rt.pacing = mode < 0 ? PACE_VSYNC : (enum e_pacemode)mode;
+	rt.hz = rt.pacing == PACE_LIMIT && fps ? atof(fps) : f_glfw_refreshrate();
 
-		glfwSwapBuffers(win);
-		glfwPollEvents();
+	/* A hidden shared context compiles edited shaders if the driver can't in */
+	/* parallel (windows are only created on the main thread) */
+	rt.shared = epoxy_has_gl_extension("GL_KHR_parallel_shader_compile") ? NULL : f_glfw_initshared(win);
+
+	glfwSetTime(0.0);
+	pthread_t thread;
+	if(f_winshare_init(&rt.share, rt.wst)) rt.ret = -1;
+	else {
+		glfwMakeContextCurrent(NULL);
+		if(pthread_create(&thread, NULL, f_render_thread, &rt)) {
+			glfwMakeContextCurrent(win);
+			rt.ret = -1;
+		} else {
+			while(!atomic_load(&rt.done)) {
+				glfwWaitEvents();
+				rt.wst->time = glfwGetTime();
+				f_winshare_publish(&rt.share, rt.wst);
+			}
+			pthread_join(thread, NULL);
+			glfwMakeContextCurrent(win);
+		}
+		f_winshare_destroy(&rt.share);
 	}
+
+	if(rt.shared) glfwDestroyWindow(rt.shared);
+	return rt.ret;
+}
+
+/* Render a fixed number of frames offscreen and report frame times */
+/* Each frame is synchronized with glFinish() so the GPU work is included */
+/* If a golden image path is given, compare the last frame against it */
+/* (a missing golden image is written instead, to bootstrap the check) */
+int f_render_headless(unsigned int frames, int width, int height, const char *golden) {
+	struct t_headless hl;
+	if(f_headless_init(&hl, width, height)) {
+		fprintf(stderr, "Unable to create headless OpenGL 4.6 context\n");
+		return -3;
+	}
+
+	struct t_glfw_winstate hws = {
+		.width = width, .height = height,
+		.szrefresh = 1, .runstate = 1,
+	};
+
+	struct t_render_state rs;
+	struct t_jobsys js;
+	if(f_render_init(&rs, NULL)) return f_headless_destroy(&hl), -4;
+	rs.js = f_render_startjobs(&js);
+
+	double *ft = malloc(frames * sizeof *ft);
+	if(!ft) return f_render_destroy(&rs), f_headless_destroy(&hl), -4;
+
+	const double start = f_clock_now();
+	for(unsigned int i = 0; i < frames; ++i) {
+		const double t0 = f_clock_now();
+		hws.time = t0 - start;
+
+		f_render_frame(&rs, &hws);
+		f_gputimer_mark(&rs.gt, GPASS_SWAP);
+		f_gputimer_end(&rs.gt);
+		glFinish();
+
+		ft[i] = f_clock_now() - t0;
+	}
+
+	struct t_bench_stats st;
+	f_bench_stats(ft, frames, &st);
+	printf("%s | %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+	printf("Resolution: %dx%d\n", width, height);
+	f_bench_print(stdout, "Frame time", &st);
+	free(ft);
+
+	printf("GPU time (average of last %d frames):", GPUTIMER_HISTORY);
+	for(int p = 0; p < GPASS_COUNT; ++p)
+		printf(" %s = %.3f ms", gpupass_names[p], f_gputimer_avg(&rs.gt, p));
+	printf(" (%lu resolved, %lu dropped)\n", rs.gt.resolved, rs.gt.dropped);
+	printf("State changes per frame: %u programs, %u vertex arrays, %u materials, %u draws\n",
+		rs.cq.stats.programs, rs.cq.stats.vaos, rs.cq.stats.materials, rs.cq.stats.draws);
+	f_render_destroy(&rs);
+
+	int ret = 0;
+	unsigned char *px = golden ? f_headless_readback(&hl) : NULL;
+	if(px) {
+		int gw, gh;
+		unsigned char *ref = f_ppm_read(golden, &gw, &gh);
+		if(!ref) {
+			ret = f_ppm_write(golden, px, width, height) ? -5 : 0;
+			printf("Golden image '%s' %s\n", golden, ret ? "could not be written" : "written");
+		} else if(gw != width || gh != height) {
+			printf("Golden image '%s' is %dx%d, expected %dx%d\n", golden, gw, gh, width, height);
+			ret = -6;
+		} else {
+			const unsigned long npx = (unsigned long)width * height;
+			const unsigned long bad = f_image_diff(px, ref, npx, GOLDEN_TOLERANCE);
+			ret = bad * 1000 > npx * GOLDEN_MAXBAD_PERMILLE ? -7 : 0;
+			printf("Golden image check: %lu/%lu pixels differ - %s\n", bad, npx, ret ? "FAILED" : "passed");
+		}
+		free(ref);
+	} else if(golden) {
+		ret = -5;
+	}
+
+	free(px);
+	f_headless_destroy(&hl);
+	return ret;
+}
+
+/* Replay recorded input offscreen on a fixed timestep, through the same input */
+/* queue and camera as the window, and report frame times - the framebuffer is */
+/* the largest size recorded, a hash of the last frame tells whether two builds */
+/* drew the same thing, and RENDER_REPLAY_CSV gets each frame's time */
+int f_render_replay(const char *path, const char *meshpath) {
+	struct t_replay rp;
+	const int err = f_replay_open(&rp, path);
+	if(err) {
+		fprintf(stderr, "Unable to replay '%s' (%d)\n", path, err);
+		return -1;
+	}
+
+	struct t_headless hl;
+	if(f_headless_init(&hl, rp.maxwidth, rp.maxheight)) {
+		fprintf(stderr, "Unable to create headless OpenGL 4.6 context\n");
+		return f_replay_close(&rp), -3;
+	}
+
+	/* Room for the busiest frame's events */
+	unsigned int cap = RENDER_MAXEVENTS;
+	while(cap < rp.maxevents) cap *= 2;
+
+	struct t_glfw_winstate hws = {
+		.width = rp.h.width, .height = rp.h.height,
+		.szrefresh = 1, .runstate = 1,
+	};
+	double *ft = malloc((rp.frames ? rp.frames : 1) * sizeof *ft);
+	if(!ft || f_iq_init(&hws.iq, cap)) return free(ft), f_headless_destroy(&hl), f_replay_close(&rp), -4;
+
+	struct t_jobsys js;
+	struct t_render_state rs;
+	if(f_render_setup(&rs, &js, meshpath)) return free(ft), f_iq_destroy(&hws.iq), f_headless_destroy(&hl), f_replay_close(&rp), -4;
+
+	struct t_camera cam;
+	f_camera_init(&cam);
+
+	const char *csvpath = getenv("RENDER_REPLAY_CSV");
+	FILE *csv = csvpath ? fopen(csvpath, "w") : NULL;
+	if(csv) fprintf(csv, "frame,cpu_ms\n");
+
+	unsigned long f = 0;
+	for(; f_replay_frame(&rp, &hws, f * RENDER_REPLAY_STEP) > 0; ++f) {
+		const double t0 = f_clock_now();
+		hws.time = f * RENDER_REPLAY_STEP;
+
+		struct t_glfw_inputevent ev[RENDER_MAXEVENTS];
+		for(unsigned int n; (n = f_iqdrain(&hws.iq, ev, RENDER_MAXEVENTS)); )
+			for(unsigned int i = 0; i < n; ++i) f_camera_event(&cam, &ev[i]);
+
+		f_camera_update(&cam, hws.mx, hws.my, hws.width, hws.height);
+		rs.viewproj = cam.viewproj;
+		rs.eye = cam.eye, rs.fovy = cam.fovy;
+
+		f_render_frame(&rs, &hws);
+		f_gputimer_mark(&rs.gt, GPASS_SWAP);
+		f_gputimer_end(&rs.gt);
+		glFinish();
+
+		ft[f] = f_clock_now() - t0;
+		if(csv) fprintf(csv, "%lu,%.4f\n", f, ft[f] * 1e3);
+	}
+	if(csv) fclose(csv);
+
+	struct t_bench_stats st;
+	f_bench_stats(ft, f, &st);
+	printf("%s | %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+	printf("Replayed %lu frames of '%s' at %dx%d (framebuffer %dx%d)\n",
+		f, path, rp.h.width, rp.h.height, rp.maxwidth, rp.maxheight);
+	f_bench_print(stdout, "Frame time", &st);
+	free(ft);
+
+	printf("GPU time (average of last %d frames):", GPUTIMER_HISTORY);
+	for(int p = 0; p < GPASS_COUNT; ++p)
+		printf(" %s = %.3f ms", gpupass_names[p], f_gputimer_avg(&rs.gt, p));
+	printf(" (%lu resolved, %lu dropped)\n", rs.gt.resolved, rs.gt.dropped);
+	f_render_destroy(&rs);
+
+	/* FNV-1a of the last frame */
+	unsigned char *px = f_headless_readback(&hl);
+	if(px) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for(size_t i = 0; i < (size_t)hl.width * hl.height * 3; ++i) h = (h ^ px[i]) * 0x100000001b3ull;
+		printf("Last frame hash: %016llx\n", (unsigned long long)h);
+	}
+
+	free(px);
+	f_iq_destroy(&hws.iq);
+	f_headless_destroy(&hl);
+	f_replay_close(&rp);
+	return 0;
 }
 
 void f_glfw_callback_error(int err, const char* desc) {
@@ -106,15 +387,47 @@ void f_glfw_callback_error(int err, const char* desc) {
 }
 
 /* Attempt initialization of GLFW and the window, exit if unsuccessful */
-int main(void) {
+/* Usage: render [mesh.obj | mesh.rmesh] */
+/*        render --bake <mesh.obj> <mesh.rmesh> */
+/*        render --bake-texture <image.ppm|tga> <image.rtex> [bc1|bc3|bc5|bc7] */
+/*        render --headless [frames] [width] [height] [golden.ppm] */
+/*        render --replay <input.rinp> [mesh.obj | mesh.rmesh] */
+/*        render --bench <name> [args...] */
+int main(int argc, char* argv[]) {
+	if(argc > 2 && !strcmp(argv[1], "--bench"))
+		return f_run_bench(argc - 2, argv + 2);
+
+	if(argc > 3 && !strcmp(argv[1], "--bake"))
+		return f_bake_mesh(argv[2], argv[3]) ? -1 : 0;
+
+	if(argc > 3 && !strcmp(argv[1], "--bake-texture"))
+		return f_bake_texture(argv[2], argv[3], argc > 4 ? argv[4] : NULL) ? -1 : 0;
+
+	if(argc > 2 && !strcmp(argv[1], "--replay"))
+		return f_render_replay(argv[2], argc > 3 ? argv[3] : NULL) ? -1 : 0;
+
+	if(argc > 1 && !strcmp(argv[1], "--headless")) {
+		const int frames = argc > 2 ? atoi(argv[2]) : 1000;
+		const int width = argc > 3 ? atoi(argv[3]) : 640;
+		const int height = argc > 4 ? atoi(argv[4]) : 480;
+		if(frames <= 0 || width <= 0 || height <= 0) {
+			fprintf(stderr, "Invalid headless arguments\n");
+			return -1;
+		}
+		return f_render_headless(frames, width, height, argc > 5 ? argv[5] : NULL);
+	}
+
 	glfwSetErrorCallback(f_glfw_callback_error);
 	if(!glfwInit()) return -1;
 
+	if(f_iq_init(&ws.iq, RENDER_MAXEVENTS)) return glfwTerminate(), -2;
+
 	void* win = f_glfw_initwin("[[Placeholder]]", 640, 480, WIN_MAX, &ws);
-	if(!win) return glfwTerminate(), -2;
+	if(!win) return f_iq_destroy(&ws.iq), glfwTerminate(), -2;
 
-	f_render_main(win);
+	const int ret = f_render_main(win, argc > 1 ? argv[1] : NULL) ? -3 : 0;
 
 	glfwDestroyWindow(win);
-	return glfwTerminate(), 0;
+	f_iq_destroy(&ws.iq);
+	return glfwTerminate(), ret;
 }
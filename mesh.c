@@ -0,0 +1,496 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mesh.h"
+
+/* References
+ * ----------
+ * P. Bourke, "Object Files (.obj)"
+ * "https://paulbourke.net/dataformats/obj/"
+ * mmap(2)
+ * "https://man7.org/linux/man-pages/man2/mmap.2.html"
+ */
+
+/* Face corner indices: relative (negative) indices are resolved against */
+/* the chunk's own count and flagged, until the chunk offsets are known */
+#define OBJ_LOCAL 0x80000000u
+#define OBJ_NONE 0x7FFFFFFFu
+
+/* Chunks per worker thread, so uneven chunks still balance out */
+#define OBJ_CHUNKS_PER_THREAD 4
+
+/* What one chunk of the file contains */
+struct t_objchunk {
+	const char *start, *end;
+
+	float *pos, *nrm;
+	unsigned long npos, nnrm, cappos, capnrm;
+
+	/* Position and normal index of every triangle corner */
+	uint32_t *corners;
+	unsigned long ncorners, capcorners;
+
+	/* Offsets of this chunk in the whole file */
+	unsigned long basepos, basenrm, basecorner;
+	int err;
+};
+
+struct t_objload {
+	struct t_objchunk *chunks;
+	unsigned long nchunks;
+	unsigned long npos, nnrm, ncorners;
+
+	/* Without normals vertices are the positions themselves, */
+	/* otherwise attributes and corners are gathered for deduplication */
+	unsigned char direct;
+	float *pos, *nrm;
+	uint32_t *resolved;
+
+	struct t_mesh *m;
+};
+
+
+/* ------- *
+ * Parsing *
+ * ------- */
+
+static int f_obj_grow(void **p, unsigned long *cap, unsigned long need, size_t elemsz) {
+	if(need <= *cap) return 0;
+
+	unsigned long n = *cap ? *cap : 1024;
+	while(n < need) n *= 2;
+	void *np = realloc(*p, n * elemsz);
+	if(!np) return -1;
+	*p = np, *cap = n;
+	return 0;
+}
+
+static const char* f_obj_skipws(const char *p, const char *end) {
+	while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+/* Decimal float without locale or error handling, not correctly rounded */
+/* in the last bit, which does not matter for geometry */
+static const char* f_obj_float(const char *p, const char *end, float *out) {
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	p = f_obj_skipws(p, end);
+	const int neg = p < end && *p == '-';
+	if(p < end && (*p == '-' || *p == '+')) p++;
+
+	uint64_t mant = 0;
+	int digits = 0, exp = 0;
+	for(; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+		if(mant < 1000000000000000000ull) mant = mant * 10 + (*p - '0');
+		else exp++;
+
+	if(p < end && *p == '.')
+		for(++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+			if(mant < 1000000000000000000ull) mant = mant * 10 + (*p - '0'), exp--;
+
+	if(!digits) return NULL;
+
+	if(p < end && (*p == 'e' || *p == 'E')) {
+		const char *q = p + 1;
+		const int eneg = q < end && *q == '-';
+		if(q < end && (*q == '-' || *q == '+')) q++;
+
+		int e = 0;
+		if(q < end && *q >= '0' && *q <= '9') {
+			for(; q < end && *q >= '0' && *q <= '9'; ++q) if(e < 10000) e = e * 10 + (*q - '0');
+			exp += eneg ? -e : e, p = q;
+		}
+	}
+
+	double v = mant;
+	while(exp > 22) v *= 1e22, exp -= 22;
+	while(exp < -22) v /= 1e22, exp += 22;
+	v = exp < 0 ? v / pow10[-exp] : v * pow10[exp];
+
+	*out = neg ? -v : v;
+	return p;
+}
+
+static const char* f_obj_int(const char *p, const char *end, long *out) {
+	const int neg = p < end && *p == '-';
+	if(neg) p++;
+	if(p >= end || *p < '0' || *p > '9') return NULL;
+
+	long v = 0;
+	for(; p < end && *p >= '0' && *p <= '9'; ++p) v = v * 10 + (*p - '0');
+	*out = neg ? -v : v;
+	return p;
+}
+
+/* 1 based, or negative relative to the elements read so far - which may */
+/* reach into earlier chunks, so local indices are kept modulo 2^31 */
+static uint32_t f_obj_index(long i, unsigned long count) {
+	if(i > 0) return i - 1 < OBJ_NONE ? (uint32_t)(i - 1) : OBJ_NONE;
+	if(i < 0) return OBJ_LOCAL | ((uint32_t)(count + i) & ~OBJ_LOCAL);
+	return OBJ_NONE;
+}
+
+/* Parse "v/t/n", "v//n", "v/t" or "v" into position and normal indices */
+static const char* f_obj_corner(struct t_objchunk *c, const char *p, const char *end, uint32_t *v, uint32_t *n) {
+	long i;
+	if(!(p = f_obj_int(p, end, &i))) return NULL;
+	*v = f_obj_index(i, c->npos), *n = OBJ_NONE;
+
+	if(p < end && *p == '/') {
+		p++;
+		const char *q = f_obj_int(p, end, &i);
+		if(q) p = q;
+		if(p < end && *p == '/') {
+			if(!(p = f_obj_int(p + 1, end, &i))) return NULL;
+			*n = f_obj_index(i, c->nnrm);
+		}
+	}
+
+	return *v == OBJ_NONE ? NULL : p;
+}
+
+/* Polygons are triangulated as fans */
+static int f_obj_face(struct t_objchunk *c, const char *p, const char *end) {
+	uint32_t first[2] = {0}, prev[2] = {0}, cur[2];
+	int k = 0;
+
+	for(p = f_obj_skipws(p, end); p < end; p = f_obj_skipws(p, end), ++k) {
+		if(!(p = f_obj_corner(c, p, end, &cur[0], &cur[1]))) return -1;
+
+		if(k == 0) memcpy(first, cur, sizeof cur);
+		if(k >= 2) {
+			if(f_obj_grow((void**)&c->corners, &c->capcorners, (c->ncorners + 3) * 2, sizeof *c->corners)) return -1;
+
+			uint32_t *o = c->corners + c->ncorners * 2;
+			memcpy(o, first, sizeof first), memcpy(o + 2, prev, sizeof prev), memcpy(o + 4, cur, sizeof cur);
+			c->ncorners += 3;
+		}
+		memcpy(prev, cur, sizeof cur);
+	}
+
+	return k >= 3 ? 0 : -1;
+}
+
+/* Returns 0, or -1 on allocation failure or a malformed line */
+static int f_obj_line(struct t_objchunk *c, const char *p, const char *end) {
+	p = f_obj_skipws(p, end);
+	if(end - p < 2 || p[1] == '\0') return 0;
+
+	float f[3];
+	if(p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+		p += 2;
+		for(int i = 0; i < 3; ++i) if(!(p = f_obj_float(p, end, &f[i]))) return -1;
+
+		/* Trailing vertex colors are ignored */
+		if(f_obj_grow((void**)&c->pos, &c->cappos, (c->npos + 1) * 3, sizeof *c->pos)) return -1;
+		memcpy(c->pos + c->npos++ * 3, f, sizeof f);
+	} else if(p[0] == 'v' && p[1] == 'n') {
+		p += 2;
+		for(int i = 0; i < 3; ++i) if(!(p = f_obj_float(p, end, &f[i]))) return -1;
+
+		if(f_obj_grow((void**)&c->nrm, &c->capnrm, (c->nnrm + 1) * 3, sizeof *c->nrm)) return -1;
+		memcpy(c->nrm + c->nnrm++ * 3, f, sizeof f);
+	} else if(p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+		return f_obj_face(c, p + 2, end);
+	}
+
+	/* Texture coordinates, groups, materials and comments are skipped */
+	return 0;
+}
+
+static void f_obj_parsechunk(struct t_objchunk *c) {
+	for(const char *p = c->start; p < c->end && !c->err;) {
+		const char *nl = memchr(p, '\n', c->end - p);
+		const char *eol = nl ? nl : c->end;
+
+		c->err = f_obj_line(c, p, eol);
+		p = eol + 1;
+	}
+}
+
+
+/* ------- *
+ * Merging *
+ * ------- */
+
+static void f_obj_job_parse(void *data, unsigned long begin, unsigned long end) {
+	struct t_objload *ld = data;
+	for(unsigned long i = begin; i < end; ++i) f_obj_parsechunk(&ld->chunks[i]);
+}
+
+static void f_obj_vsrc(struct t_vsrc *v, const float *pos, const float *nrm) {
+	*v = (struct t_vsrc){
+		{ pos[0], pos[1], pos[2] },
+		{ 0, 0, 0 },
+		{ 1, 1, 1, 1 }
+	};
+	if(nrm) memcpy(v->nrm, nrm, sizeof v->nrm);
+}
+
+/* Make corner indices global, and copy attributes to their final place */
+static void f_obj_job_resolve(void *data, unsigned long begin, unsigned long end) {
+	struct t_objload *ld = data;
+
+	for(unsigned long ci = begin; ci < end; ++ci) {
+		struct t_objchunk *c = &ld->chunks[ci];
+
+		for(unsigned long i = 0; i < c->ncorners * 2; ++i) {
+			uint32_t x = c->corners[i];
+			const unsigned long base = i & 1 ? c->basenrm : c->basepos;
+			const unsigned long count = i & 1 ? ld->nnrm : ld->npos;
+
+			if(x & OBJ_LOCAL) x = (x + base) & ~OBJ_LOCAL;
+			if(x >= count) {
+				/* A position is required, a bad normal index is dropped */
+				if(!(i & 1)) c->err = -1;
+				x = OBJ_NONE;
+			}
+
+			if(!ld->direct) ld->resolved[c->basecorner * 2 + i] = x;
+			else if(!(i & 1)) ld->m->idx[c->basecorner + i / 2] = x;
+		}
+
+		if(ld->direct) {
+			for(unsigned long i = 0; i < c->npos; ++i)
+				f_obj_vsrc(&ld->m->v[c->basepos + i], c->pos + i * 3, NULL);
+		} else {
+			memcpy(ld->pos + c->basepos * 3, c->pos, c->npos * 3 * sizeof *c->pos);
+			memcpy(ld->nrm + c->basenrm * 3, c->nrm, c->nnrm * 3 * sizeof *c->nrm);
+		}
+	}
+}
+
+static unsigned long f_obj_hash(uint64_t key, unsigned long mask) {
+	return (key * 0x9E3779B97F4A7C15ull) >> 20 & mask;
+}
+
+/* With normals, a vertex is a unique (position, normal) pair of a face corner */
+/* Found with an open addressing hash table, grown when half full */
+static int f_obj_dedup(struct t_objload *ld) {
+	struct t_mesh *m = ld->m;
+
+	unsigned long cap = 1024, vcap = ld->npos + 1;
+	while(cap < vcap * 2) cap *= 2;
+
+	uint64_t *keys = malloc(cap * sizeof *keys);
+	uint32_t *vals = malloc(cap * sizeof *vals);
+	m->v = malloc(vcap * sizeof *m->v);
+	if(!keys || !vals || !m->v) return free(keys), free(vals), -1;
+	memset(keys, 0xFF, cap * sizeof *keys);
+
+	for(unsigned long i = 0; i < ld->ncorners; ++i) {
+		const uint32_t *cr = ld->resolved + i * 2;
+		const uint64_t key = (uint64_t)cr[0] << 32 | cr[1];
+
+		unsigned long h = f_obj_hash(key, cap - 1);
+		while(keys[h] != key && keys[h] != UINT64_MAX) h = (h + 1) & (cap - 1);
+
+		if(keys[h] == key) {
+			m->idx[i] = vals[h];
+			continue;
+		}
+
+		if(m->nv >= vcap) {
+			void *nv = realloc(m->v, vcap * 2 * sizeof *m->v);
+			if(!nv) return free(keys), free(vals), -1;
+			m->v = nv, vcap *= 2;
+		}
+
+		f_obj_vsrc(&m->v[m->nv], ld->pos + cr[0] * 3UL, cr[1] == OBJ_NONE ? NULL : ld->nrm + cr[1] * 3UL);
+		keys[h] = key, vals[h] = m->nv;
+		m->idx[i] = m->nv++;
+
+		if(m->nv * 2 <= cap) continue;
+
+		const unsigned long ncap = cap * 2;
+		uint64_t *nk = malloc(ncap * sizeof *nk);
+		uint32_t *nvl = malloc(ncap * sizeof *nvl);
+		if(!nk || !nvl) return free(nk), free(nvl), free(keys), free(vals), -1;
+		memset(nk, 0xFF, ncap * sizeof *nk);
+
+		for(unsigned long j = 0; j < cap; ++j) {
+			if(keys[j] == UINT64_MAX) continue;
+			unsigned long g = f_obj_hash(keys[j], ncap - 1);
+			while(nk[g] != UINT64_MAX) g = (g + 1) & (ncap - 1);
+			nk[g] = keys[j], nvl[g] = vals[j];
+		}
+		free(keys), free(vals);
+		keys = nk, vals = nvl, cap = ncap;
+	}
+
+	free(keys), free(vals);
+	return 0;
+}
+
+/* Combine parsed chunks into the mesh, in parallel if a job system is given */
+static int f_obj_merge(struct t_objload *ld, struct t_jobsys *js) {
+	int used = 0;
+	for(unsigned long i = 0; i < ld->nchunks; ++i) {
+		struct t_objchunk *c = &ld->chunks[i];
+		if(c->err) return -2;
+
+		c->basepos = ld->npos, c->basenrm = ld->nnrm, c->basecorner = ld->ncorners;
+		ld->npos += c->npos, ld->nnrm += c->nnrm, ld->ncorners += c->ncorners;
+		for(unsigned long j = 0; j < c->ncorners && !used; ++j) used = c->corners[j*2 + 1] != OBJ_NONE;
+	}
+
+	if(ld->npos >= OBJ_NONE || ld->nnrm >= OBJ_NONE) return -3;
+	struct t_mesh *m = ld->m;
+
+	ld->direct = !used;
+	m->ni = ld->ncorners;
+	m->idx = malloc((m->ni + 1) * sizeof *m->idx);
+	if(ld->direct) {
+		m->nv = ld->npos;
+		m->v = malloc((m->nv + 1) * sizeof *m->v);
+	} else {
+		ld->pos = malloc((ld->npos * 3 + 1) * sizeof *ld->pos);
+		ld->nrm = malloc((ld->nnrm * 3 + 1) * sizeof *ld->nrm);
+		ld->resolved = malloc((ld->ncorners * 2 + 1) * sizeof *ld->resolved);
+	}
+	if(!m->idx || (ld->direct ? !m->v : !ld->pos || !ld->nrm || !ld->resolved)) return -1;
+
+	if(js) f_jobs_parallel_for(js, ld->nchunks, 1, f_obj_job_resolve, ld);
+	else f_obj_job_resolve(ld, 0, ld->nchunks);
+
+	for(unsigned long i = 0; i < ld->nchunks; ++i) if(ld->chunks[i].err) return -2;
+	return ld->direct ? 0 : f_obj_dedup(ld);
+}
+
+static void f_obj_cleanup(struct t_objload *ld) {
+	for(unsigned long i = 0; ld->chunks && i < ld->nchunks; ++i)
+		free(ld->chunks[i].pos), free(ld->chunks[i].nrm), free(ld->chunks[i].corners);
+	free(ld->chunks), free(ld->pos), free(ld->nrm), free(ld->resolved);
+}
+
+static int f_obj_finish(struct t_objload *ld, int ret) {
+	f_obj_cleanup(ld);
+	if(ret) f_mesh_free(ld->m);
+	return ret;
+}
+
+
+/* --- *
+ * API *
+ * --- */
+
+/* Load positions, normals and triangulated faces of a Wavefront OBJ file */
+/* The file is mapped and split at line boundaries into chunks parsed in parallel */
+/* Returns 0, -1 if the file can't be read or memory runs out, -2 if it is malformed */
+int f_obj_load(struct t_mesh *m, const char *path, struct t_jobsys *js) {
+	*m = (struct t_mesh){0};
+
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) || st.st_size <= 0) return close(fd), -1;
+
+	const size_t size = st.st_size;
+	const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return -1;
+
+	/* Equal sized chunks, each extended to the end of its last line */
+	struct t_objload ld = { .m = m };
+	unsigned long n = js ? js->nthreads * OBJ_CHUNKS_PER_THREAD : 1;
+	if(n > size / 4096 + 1) n = size / 4096 + 1;
+
+	ld.chunks = calloc(n, sizeof *ld.chunks);
+	if(!ld.chunks) return munmap((void*)map, size), -1;
+
+	const char *p = map, *const end = map + size;
+	for(unsigned long i = 0; i < n && p < end; ++i) {
+		const char *ce = i == n - 1 ? end : map + size / n * (i + 1);
+		if(ce < p) ce = p;
+		const char *nl = ce < end ? memchr(ce, '\n', end - ce) : NULL;
+		ce = nl ? nl + 1 : end;
+
+		ld.chunks[ld.nchunks++] = (struct t_objchunk){ .start = p, .end = ce };
+		p = ce;
+	}
+
+	if(js) f_jobs_parallel_for(js, ld.nchunks, 1, f_obj_job_parse, &ld);
+	else f_obj_job_parse(&ld, 0, ld.nchunks);
+
+	const int ret = f_obj_merge(&ld, js);
+	munmap((void*)map, size);
+	return f_obj_finish(&ld, ret);
+}
+
+/* Reference loader: one line at a time with fgets and sscanf */
+int f_obj_load_naive(struct t_mesh *m, const char *path) {
+	*m = (struct t_mesh){0};
+
+	FILE *f = fopen(path, "r");
+	if(!f) return -1;
+
+	struct t_objload ld = { .m = m, .nchunks = 1 };
+	struct t_objchunk *c = ld.chunks = calloc(1, sizeof *ld.chunks);
+	if(!c) return fclose(f), -1;
+
+	char line[1024];
+	while(!c->err && fgets(line, sizeof line, f)) {
+		float x[3];
+		if(!strncmp(line, "v ", 2)) {
+			if(sscanf(line + 2, "%f %f %f", &x[0], &x[1], &x[2]) != 3
+			|| f_obj_grow((void**)&c->pos, &c->cappos, (c->npos + 1) * 3, sizeof *c->pos)) c->err = -1;
+			else memcpy(c->pos + c->npos++ * 3, x, sizeof x);
+		} else if(!strncmp(line, "vn ", 3)) {
+			if(sscanf(line + 3, "%f %f %f", &x[0], &x[1], &x[2]) != 3
+			|| f_obj_grow((void**)&c->nrm, &c->capnrm, (c->nnrm + 1) * 3, sizeof *c->nrm)) c->err = -1;
+			else memcpy(c->nrm + c->nnrm++ * 3, x, sizeof x);
+		} else if(!strncmp(line, "f ", 2)) {
+			uint32_t first[2] = {0}, prev[2] = {0}, cur[2];
+			int k = 0;
+			for(char *save, *tok = strtok_r(line + 2, " \t\r\n", &save); tok && !c->err; tok = strtok_r(NULL, " \t\r\n", &save), ++k) {
+				long v, t, nr = 0;
+				if(sscanf(tok, "%ld//%ld", &v, &nr) != 2 && sscanf(tok, "%ld/%ld/%ld", &v, &t, &nr) < 1) {
+					c->err = -1;
+					break;
+				}
+
+				cur[0] = f_obj_index(v, c->npos), cur[1] = nr ? f_obj_index(nr, c->nnrm) : OBJ_NONE;
+				if(cur[0] == OBJ_NONE) c->err = -1;
+				if(k == 0) memcpy(first, cur, sizeof cur);
+				if(k >= 2 && !c->err) {
+					if(f_obj_grow((void**)&c->corners, &c->capcorners, (c->ncorners + 3) * 2, sizeof *c->corners)) c->err = -1;
+					else {
+						uint32_t *o = c->corners + c->ncorners * 2;
+						memcpy(o, first, sizeof first), memcpy(o + 2, prev, sizeof prev), memcpy(o + 4, cur, sizeof cur);
+						c->ncorners += 3;
+					}
+				}
+				memcpy(prev, cur, sizeof cur);
+			}
+			if(k < 3) c->err = -1;
+		}
+	}
+
+	fclose(f);
+	return f_obj_finish(&ld, f_obj_merge(&ld, NULL));
+}
+
+void f_mesh_free(struct t_mesh *m) {
+	free(m->v), free(m->idx);
+	*m = (struct t_mesh){0};
+}
+
+/* Coarsest level whose error projects to at most maxpx pixels at the given distance */
+/* pxscale is pixels per unit at distance 1: height / (2 tan(fovy / 2)), 0 for full detail */
+unsigned int f_mesh_lod_select(const struct t_meshlod *lods, unsigned int n, float dist, float pxscale, float maxpx) {
+	if(pxscale <= 0 || dist <= 0) return 0;
+
+	unsigned int l = 0;
+	while(l + 1 < n && lods[l + 1].error * pxscale <= maxpx * dist) l++;
+	return l;
+}
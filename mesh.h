@@ -0,0 +1,35 @@
+#ifndef __H__MESH_H___
+#define __H__MESH_H___
+
+#include <stdint.h>
+
+#include "vertex.h"
+#include "jobs.h"
+
+#define MESH_MAXLODS 8
+
+/* A contiguous range of the index buffer, coarser levels have larger error */
+/* (an object space distance) - all levels share the vertices */
+struct t_meshlod {
+	uint32_t first, count;
+	float error;
+	uint32_t pad_;
+};
+
+/* Indexed triangle mesh, with vertices ready for f_vformat_encode */
+/* Without levels of detail (nlods = 0) the whole index buffer is drawn */
+struct t_mesh {
+	struct t_vsrc *v;
+	uint32_t *idx;
+	unsigned long nv, ni;
+
+	struct t_meshlod lods[MESH_MAXLODS];
+	unsigned int nlods;
+};
+
+int f_obj_load(struct t_mesh *, const char *, struct t_jobsys *);
+int f_obj_load_naive(struct t_mesh *, const char *);
+void f_mesh_free(struct t_mesh *);
+unsigned int f_mesh_lod_select(const struct t_meshlod *, unsigned int, float, float, float);
+
+#endif
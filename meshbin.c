@@ -0,0 +1,140 @@
+#include <epoxy/gl.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "meshbin.h"
+
+/* References
+ * ----------
+ * ARB_buffer_storage
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_buffer_storage.txt"
+ * mmap(2)
+ * "https://man7.org/linux/man-pages/man2/mmap.2.html"
+ */
+
+static uint64_t f_meshbin_align(uint64_t x) {
+	return (x + MESHBIN_ALIGN - 1) & ~(uint64_t)(MESHBIN_ALIGN - 1);
+}
+
+/* Pointers into the container, after checking the vertex format and that every */
+/* offset is in bounds */
+static int f_meshbin_bind(struct t_meshbin *mb) {
+	const struct t_meshbin_header *h = mb->base;
+	if(mb->size < sizeof *h || memcmp(h->magic, MESHBIN_MAGIC, 4)) return -2;
+	if(h->version != MESHBIN_VERSION) return -3;
+
+	/* Counts are bounded by the file size first, so the stream sizes can't wrap */
+	if(h->nlods == 0 || h->nlods > MESHBIN_MAXLODS || f_vformat_check(&h->fmt)
+	|| h->vtxoff % MESHBIN_ALIGN || h->idxoff % MESHBIN_ALIGN
+	|| h->nverts > mb->size / h->fmt.stride || h->nindices > mb->size / sizeof(uint32_t)
+	|| h->vtxsize != h->nverts * h->fmt.stride || h->idxsize != h->nindices * sizeof(uint32_t)
+	|| h->vtxoff > mb->size || h->vtxsize > mb->size - h->vtxoff
+	|| h->idxoff > mb->size || h->idxsize > mb->size - h->idxoff) return -4;
+
+	for(uint32_t i = 0; i < h->nlods; ++i)
+		if(h->lods[i].first > h->nindices || h->lods[i].count > h->nindices - h->lods[i].first) return -4;
+
+	mb->h = h;
+	mb->verts = (const char*)mb->base + h->vtxoff;
+	mb->idx = (const uint32_t*)((const char*)mb->base + h->idxoff);
+	return 0;
+}
+
+/* Encode a mesh and its levels of detail into a container in memory */
+int f_meshbin_build(struct t_meshbin *mb, const struct t_mesh *m, const struct t_vformat *fmt) {
+	*mb = (struct t_meshbin){0};
+
+	const uint64_t vtxoff = f_meshbin_align(sizeof(struct t_meshbin_header));
+	const uint64_t vtxsize = (uint64_t)m->nv * fmt->stride;
+	const uint64_t idxoff = f_meshbin_align(vtxoff + vtxsize);
+	const uint64_t idxsize = (uint64_t)m->ni * sizeof *m->idx;
+	if(m->ni > UINT32_MAX) return -1;
+
+	mb->size = idxoff + idxsize;
+	mb->base = aligned_alloc(MESHBIN_ALIGN, f_meshbin_align(mb->size));
+	if(!mb->base) return -1;
+	memset(mb->base, 0, mb->size);
+
+	struct t_meshbin_header *h = mb->base;
+	memcpy(h->magic, MESHBIN_MAGIC, 4);
+	h->version = MESHBIN_VERSION;
+	h->nverts = m->nv, h->nindices = m->ni;
+	h->vtxoff = vtxoff, h->vtxsize = vtxsize;
+	h->idxoff = idxoff, h->idxsize = idxsize;
+	h->fmt = *fmt;
+
+	f_vformat_encode(fmt, m->v, m->nv, (char*)mb->base + vtxoff, &h->q);
+	memcpy((char*)mb->base + idxoff, m->idx, idxsize);
+
+	/* Object space bounding box */
+	float lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+	for(unsigned long i = 0; i < m->nv; ++i)
+		for(int c = 0; c < 3; ++c) {
+			const float p = m->v[i].pos[c];
+			if(!i || p < lo[c]) lo[c] = p;
+			if(!i || p > hi[c]) hi[c] = p;
+		}
+	for(int c = 0; c < 3; ++c) h->center[c] = (hi[c] + lo[c]) / 2, h->extent[c] = (hi[c] - lo[c]) / 2;
+
+	h->nlods = m->nlods ? m->nlods : 1;
+	if(m->nlods) memcpy(h->lods, m->lods, m->nlods * sizeof *m->lods);
+	else h->lods[0] = (struct t_meshlod){ 0, m->ni, 0, 0 };
+
+	return f_meshbin_bind(mb);
+}
+
+/* Written to a temporary file and renamed, so readers never see a partial file */
+int f_meshbin_write(const struct t_meshbin *mb, const char *path) {
+	char tmp[4096];
+	if(snprintf(tmp, sizeof tmp, "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof tmp) return -1;
+
+	FILE *f = fopen(tmp, "wb");
+	if(!f) return -1;
+
+	const int ok = fwrite(mb->base, 1, mb->size, f) == mb->size;
+	if(fclose(f) || !ok || rename(tmp, path)) return remove(tmp), -1;
+	return 0;
+}
+
+/* Map a container file - nothing is read or converted until the pages are touched */
+/* Returns 0, -1 if it can't be mapped, -2 (not a container), -3 (other version), -4 (corrupt) */
+int f_meshbin_open(struct t_meshbin *mb, const char *path) {
+	*mb = (struct t_meshbin){0};
+
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) || st.st_size <= 0) return close(fd), -1;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return -1;
+
+	*mb = (struct t_meshbin){ .base = map, .size = st.st_size, .mapped = 1 };
+	const int ret = f_meshbin_bind(mb);
+	if(ret) f_meshbin_close(mb);
+	return ret;
+}
+
+void f_meshbin_close(struct t_meshbin *mb) {
+	if(mb->mapped) munmap(mb->base, mb->size);
+	else free(mb->base);
+	*mb = (struct t_meshbin){0};
+}
+
+/* Create immutable vertex and index buffers straight from the container's streams */
+/* The container can be closed afterwards */
+void f_meshbin_upload(const struct t_meshbin *mb, unsigned int *vbo, unsigned int *ebo) {
+	glCreateBuffers(1, vbo);
+	glNamedBufferStorage(*vbo, mb->h->vtxsize, mb->verts, 0);
+
+	glCreateBuffers(1, ebo);
+	glNamedBufferStorage(*ebo, mb->h->idxsize, mb->idx, 0);
+}
@@ -0,0 +1,54 @@
+#ifndef __H__MESHBIN_H___
+#define __H__MESHBIN_H___
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vertex.h"
+#include "mesh.h"
+
+#define MESHBIN_MAGIC "RMSH"
+#define MESHBIN_VERSION 1
+#define MESHBIN_MAXLODS MESH_MAXLODS
+
+/* Streams start on this boundary within the file */
+#define MESHBIN_ALIGN 64
+
+/* File header, little endian - vertex and index streams follow at the */
+/* given offsets, already in the layout described by fmt */
+struct t_meshbin_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t nlods, pad0_;
+	uint64_t nverts, nindices;
+	uint64_t vtxoff, vtxsize;
+	uint64_t idxoff, idxsize;
+
+	struct t_vformat fmt;
+	uint8_t pad1_[2];
+	struct t_vquant q;
+
+	/* Object space box, center and half extents */
+	float center[3], extent[3];
+
+	struct t_meshlod lods[MESHBIN_MAXLODS];
+} __attribute__((aligned(MESHBIN_ALIGN)));
+
+/* A mapped (or built in memory) container - pointers reference its data directly */
+struct t_meshbin {
+	void *base;
+	size_t size;
+	unsigned char mapped:1;
+
+	const struct t_meshbin_header *h;
+	const void *verts;
+	const uint32_t *idx;
+};
+
+int f_meshbin_build(struct t_meshbin *, const struct t_mesh *, const struct t_vformat *);
+int f_meshbin_write(const struct t_meshbin *, const char *);
+int f_meshbin_open(struct t_meshbin *, const char *);
+void f_meshbin_close(struct t_meshbin *);
+void f_meshbin_upload(const struct t_meshbin *, unsigned int *, unsigned int *);
+
+#endif
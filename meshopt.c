@@ -0,0 +1,462 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "meshopt.h"
+
+/* References
+ * ----------
+ * P. V. Sander, D. Nehab, J. Barczak, "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw" (SIGGRAPH 2007) [Tipsify]
+ * T. Forsyth, "Linear-Speed Vertex Cache Optimisation"
+ * "https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html"
+ * A. Kapoulkine, meshoptimizer
+ * "https://github.com/zeux/meshoptimizer"
+ * M. Garland, P. S. Heckbert, "Surface Simplification Using Quadric Error Metrics"
+ * (SIGGRAPH 1997)
+ */
+
+static uint32_t f_meshopt_hash(const unsigned char *p, size_t n) {
+	uint32_t h = 2166136261u;
+	for(size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+
+/* Find identical vertices, comparing the first keysize bytes of each stride sized vertex */
+/* (so trailing padding is ignored) - remap receives the unique index of every */
+/* vertex, in order of first occurrence, returns the number of unique vertices or -1 */
+long f_mesh_weld(const void *verts, size_t stride, size_t keysize, unsigned long n, uint32_t *remap) {
+	const unsigned char *v = verts;
+
+	unsigned long cap = 16;
+	while(cap < n * 2) cap *= 2;
+
+	/* Slots hold the first vertex with a given key */
+	uint32_t *slots = malloc(cap * sizeof *slots);
+	if(!slots) return -1;
+	memset(slots, 0xFF, cap * sizeof *slots);
+
+	unsigned long unique = 0;
+	for(unsigned long i = 0; i < n; ++i) {
+		const unsigned char *key = v + i * stride;
+		unsigned long h = f_meshopt_hash(key, keysize) & (cap - 1);
+
+		while(slots[h] != UINT32_MAX && memcmp(v + slots[h] * stride, key, keysize))
+			h = (h + 1) & (cap - 1);
+
+		if(slots[h] == UINT32_MAX) slots[h] = i, remap[i] = unique++;
+		else remap[i] = remap[slots[h]];
+	}
+
+	free(slots);
+	return unique;
+}
+
+/* dst[remap[i]] = src[i], for vertices of the given stride */
+void f_mesh_remap_vertices(void *dst, const void *src, size_t stride, unsigned long n, const uint32_t *remap) {
+	for(unsigned long i = 0; i < n; ++i)
+		if(remap[i] != UINT32_MAX) memcpy((char*)dst + remap[i] * stride, (const char*)src + i * stride, stride);
+}
+
+
+/* Indexed mesh from a triangle list of struct vert, with duplicates welded */
+int f_mesh_from_verts(struct t_mesh *m, const struct vert *v, unsigned long n) {
+	*m = (struct t_mesh){0};
+
+	struct vert *uv = malloc(n * sizeof *uv);
+	m->idx = malloc(n * sizeof *m->idx);
+	if(!uv || !m->idx) return free(uv), f_mesh_free(m), -1;
+
+	const long unique = f_mesh_weld(v, sizeof *v, offsetof(struct vert, clr) + sizeof v->clr, n, m->idx);
+	if(unique < 0) return free(uv), f_mesh_free(m), -1;
+
+	m->ni = n, m->nv = unique;
+	f_mesh_remap_vertices(uv, v, sizeof *v, n, m->idx);
+
+	m->v = malloc(m->nv * sizeof *m->v);
+	if(!m->v) return free(uv), f_mesh_free(m), -1;
+	f_vert_to_src(uv, m->nv, m->v);
+
+	free(uv);
+	return 0;
+}
+
+
+/* ------------------------- *
+ * Post-transform cache order *
+ * ------------------------- */
+
+/* Tipsify: fan out around the current vertex, then continue with the most recently */
+/* used vertex that would still be in the cache, or backtrack through dead ends */
+/* out receives the reordered index buffer (not in place), returns 0 or -1 */
+int f_mesh_vcache_tipsify(uint32_t *out, const uint32_t *idx, unsigned long ni, unsigned long nv, unsigned int cachesize) {
+	const unsigned long nt = ni / 3;
+
+	/* Triangles around every vertex */
+	uint32_t *first = calloc(nv + 1, sizeof *first), *adj = malloc(ni * sizeof *adj);
+	uint32_t *live = calloc(nv, sizeof *live), *stamp = calloc(nv, sizeof *stamp);
+	uint32_t *dead = malloc(ni * sizeof *dead), *cand = malloc(ni * sizeof *cand);
+	unsigned char *emitted = calloc(nt, 1);
+	if(!first || !adj || !live || !stamp || !dead || !cand || !emitted) {
+		free(first), free(adj), free(live), free(stamp), free(dead), free(cand), free(emitted);
+		return -1;
+	}
+
+	/* Time stamps double as fill cursors while the adjacency is built */
+	for(unsigned long i = 0; i < nt * 3; ++i) live[idx[i]]++;
+	for(unsigned long v = 0; v < nv; ++v) first[v + 1] = first[v] + live[v], stamp[v] = first[v];
+	for(unsigned long i = 0; i < nt * 3; ++i) adj[stamp[idx[i]]++] = i / 3;
+	memset(stamp, 0, nv * sizeof *stamp);
+
+	unsigned long ndead = 0, cursor = 0, k = 0;
+	uint32_t time = cachesize + 1;
+	long fan = nv ? 0 : -1;
+
+	while(fan >= 0) {
+		unsigned long ncand = 0;
+
+		for(uint32_t a = first[fan]; a < first[fan + 1]; ++a) {
+			const uint32_t t = adj[a];
+			if(emitted[t]) continue;
+			emitted[t] = 1;
+
+			for(int c = 0; c < 3; ++c) {
+				const uint32_t v = idx[t * 3 + c];
+				out[k++] = v;
+				dead[ndead++] = v, cand[ncand++] = v;
+				live[v]--;
+				if(time - stamp[v] > cachesize) stamp[v] = time++;
+			}
+		}
+
+		/* Best candidate still in the cache after its remaining triangles are emitted */
+		long next = -1, best = -1;
+		for(unsigned long i = 0; i < ncand; ++i) {
+			const uint32_t v = cand[i];
+			if(!live[v]) continue;
+
+			long prio = 0;
+			if(time - stamp[v] + 2 * live[v] <= cachesize) prio = time - stamp[v];
+			if(prio > best) best = prio, next = v;
+		}
+
+		/* Otherwise the most recent dead end with triangles left, or the next unused vertex */
+		while(next < 0 && ndead) {
+			const uint32_t v = dead[--ndead];
+			if(live[v]) next = v;
+		}
+		while(next < 0 && cursor < nv) {
+			if(live[cursor]) next = cursor;
+			cursor++;
+		}
+
+		fan = next;
+	}
+
+	free(first), free(adj), free(live), free(stamp), free(dead), free(cand), free(emitted);
+	return 0;
+}
+
+/* Number vertices in the order the index buffer first uses them, so vertex */
+/* fetches walk memory forwards - rewrites idx in place, remap receives the new */
+/* index of every vertex (UINT32_MAX if unused), returns the number of used vertices */
+unsigned long f_mesh_vfetch_remap(uint32_t *idx, unsigned long ni, unsigned long nv, uint32_t *remap) {
+	memset(remap, 0xFF, nv * sizeof *remap);
+
+	unsigned long next = 0;
+	for(unsigned long i = 0; i < ni; ++i) {
+		if(remap[idx[i]] == UINT32_MAX) remap[idx[i]] = next++;
+		idx[i] = remap[idx[i]];
+	}
+	return next;
+}
+
+/* Simulate a FIFO post-transform cache over the index buffer */
+void f_mesh_vcache_stats(const uint32_t *idx, unsigned long ni, unsigned long nv, unsigned int cachesize, struct t_vcachestats *st) {
+	*st = (struct t_vcachestats){0};
+	if(!ni || !nv) return;
+
+	/* A vertex is cached if it entered within the last cachesize misses */
+	uint32_t *entered = calloc(nv, sizeof *entered);
+	if(!entered) return;
+
+	unsigned long misses = 0;
+	for(unsigned long i = 0; i < ni; ++i) {
+		const uint32_t v = idx[i];
+		if(entered[v] && misses - entered[v] < cachesize) continue;
+		entered[v] = ++misses;
+	}
+
+	unsigned long used = 0;
+	for(unsigned long v = 0; v < nv; ++v) used += entered[v] != 0;
+
+	st->acmr = (float)misses / (ni / 3);
+	st->atvr = used ? (float)misses / used : 0;
+	free(entered);
+}
+
+/* Reorder triangles for the post-transform cache (each level of detail on its own), */
+/* then vertices for fetch locality */
+int f_mesh_optimize(struct t_mesh *m) {
+	uint32_t *idx = malloc(m->ni * sizeof *idx), *remap = malloc(m->nv * sizeof *remap);
+	struct t_vsrc *v = malloc(m->nv * sizeof *v);
+	if(!idx || !remap || !v) return free(idx), free(remap), free(v), -1;
+
+	const struct t_meshlod all = { 0, m->ni, 0, 0 };
+	const struct t_meshlod *lods = m->nlods ? m->lods : &all;
+	for(unsigned int l = 0; l < (m->nlods ? m->nlods : 1); ++l)
+		if(f_mesh_vcache_tipsify(idx + lods[l].first, m->idx + lods[l].first, lods[l].count, m->nv, MESHOPT_CACHE_SIZE))
+			return free(idx), free(remap), free(v), -1;
+
+	const unsigned long used = f_mesh_vfetch_remap(idx, m->ni, m->nv, remap);
+	f_mesh_remap_vertices(v, m->v, sizeof *v, m->nv, remap);
+
+	free(m->idx), free(m->v), free(remap);
+	m->idx = idx, m->v = v, m->nv = used;
+	return 0;
+}
+
+
+/* ---------------------------- *
+ * Quadric error simplification *
+ * ---------------------------- */
+
+/* Sum of squared distances to a set of planes: symmetric 4x4 matrix, upper triangle */
+struct t_quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+};
+
+/* A half edge collapse, key is the bit pattern of its (non negative) float cost */
+struct t_collapse {
+	uint32_t key, from, to;
+};
+
+static void f_quadric_add(struct t_quadric *q, const struct t_quadric *r) {
+	q->a2 += r->a2, q->ab += r->ab, q->ac += r->ac, q->ad += r->ad, q->b2 += r->b2;
+	q->bc += r->bc, q->bd += r->bd, q->c2 += r->c2, q->cd += r->cd, q->d2 += r->d2;
+}
+
+static double f_quadric_eval(const struct t_quadric *q, const float *p) {
+	const double x = p[0], y = p[1], z = p[2];
+	const double e = q->a2 * x * x + q->b2 * y * y + q->c2 * z * z + q->d2
+		+ 2 * (q->ab * x * y + q->ac * x * z + q->bc * y * z + q->ad * x + q->bd * y + q->cd * z);
+	return e > 0 ? e : 0;
+}
+
+/* Unnormalized triangle normal, returns its length */
+static double f_meshopt_normal(const float *a, const float *b, const float *c, double *n) {
+	const double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const double w[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	n[0] = u[1] * w[2] - u[2] * w[1];
+	n[1] = u[2] * w[0] - u[0] * w[2];
+	n[2] = u[0] * w[1] - u[1] * w[0];
+	return sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+}
+
+/* Drop triangles with repeated vertices, returns the new index count */
+static unsigned long f_meshopt_compact(uint32_t *idx, unsigned long ni) {
+	unsigned long k = 0;
+	for(unsigned long i = 0; i + 2 < ni; i += 3) {
+		const uint32_t a = idx[i], b = idx[i + 1], c = idx[i + 2];
+		if(a == b || b == c || c == a) continue;
+		idx[k++] = a, idx[k++] = b, idx[k++] = c;
+	}
+	return k;
+}
+
+/* LSD radix sort of collapses by cost, 8 bit digits */
+static void f_collapse_sort(struct t_collapse *c, struct t_collapse *tmp, unsigned long n) {
+	for(int d = 0; d < 32; d += 8) {
+		unsigned long off[256] = {0}, sum = 0;
+		for(unsigned long i = 0; i < n; ++i) off[(c[i].key >> d) & 0xFF]++;
+		for(int b = 0; b < 256; ++b) {
+			const unsigned long cnt = off[b];
+			off[b] = sum, sum += cnt;
+		}
+		for(unsigned long i = 0; i < n; ++i) tmp[off[(c[i].key >> d) & 0xFF]++] = c[i];
+		memcpy(c, tmp, n * sizeof *c);
+	}
+}
+
+/* Mark both ends of every edge without a twin, so open borders keep their outline */
+static int f_meshopt_borders(const uint32_t *idx, unsigned long ni, unsigned char *locked) {
+	unsigned long cap = 16;
+	while(cap < ni * 2) cap *= 2;
+
+	uint64_t *edges = malloc(cap * sizeof *edges);
+	if(!edges) return -1;
+	memset(edges, 0xFF, cap * sizeof *edges);
+
+	for(int pass = 0; pass < 2; ++pass)
+		for(unsigned long i = 0; i < ni; ++i) {
+			const uint32_t a = idx[i], b = idx[i - i % 3 + (i + 1) % 3];
+			const uint64_t key = pass ? (uint64_t)b << 32 | a : (uint64_t)a << 32 | b;
+			unsigned long h = (unsigned long)((key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+			while(edges[h] != UINT64_MAX && edges[h] != key) h = (h + 1) & (cap - 1);
+
+			/* First pass inserts the directed edges, second looks up their twins */
+			if(!pass) edges[h] = key;
+			else if(edges[h] == UINT64_MAX) locked[a] = locked[b] = 1;
+		}
+
+	free(edges);
+	return 0;
+}
+
+/* Collapse edges onto one of their endpoints, cheapest quadric error first, until */
+/* at most target indices remain or nothing can be collapsed without folding a triangle */
+/* over. Vertices sharing a position are collapsed together, and open borders are kept */
+/* out (ni entries, not in place) receives indices into the same vertices, error the */
+/* largest collapse error as a distance (conservative: the root of a sum over planes) */
+/* Returns the number of indices written, or -1 */
+long f_mesh_simplify(uint32_t *out, const uint32_t *idx, unsigned long ni, const struct t_vsrc *v, unsigned long nv, unsigned long target, float *error) {
+	*error = 0;
+
+	/* Every vertex is replaced by the first one with the same position */
+	uint32_t *rep = malloc(nv * sizeof *rep), *firstof = malloc(nv * sizeof *firstof);
+	uint32_t *into = malloc(nv * sizeof *into), *stamp = calloc(nv, sizeof *stamp);
+	uint32_t *first = malloc((nv + 1) * sizeof *first), *adj = malloc(ni * sizeof *adj);
+	struct t_quadric *q = calloc(nv, sizeof *q);
+	struct t_collapse *cand = malloc(ni * sizeof *cand), *tmp = malloc(ni * sizeof *tmp);
+	unsigned char *locked = calloc(nv, 1);
+	if(!rep || !firstof || !into || !stamp || !first || !adj || !q || !cand || !tmp || !locked)
+		goto fail;
+
+	const long unique = f_mesh_weld(v, sizeof *v, sizeof v->pos, nv, rep);
+	if(unique < 0) goto fail;
+	memset(firstof, 0xFF, unique * sizeof *firstof);
+	for(unsigned long i = 0; i < nv; ++i) {
+		if(firstof[rep[i]] == UINT32_MAX) firstof[rep[i]] = i;
+		rep[i] = firstof[rep[i]], into[i] = i;
+	}
+
+	for(unsigned long i = 0; i < ni; ++i) out[i] = rep[idx[i]];
+	unsigned long k = f_meshopt_compact(out, ni - ni % 3);
+	if(f_meshopt_borders(out, k, locked)) goto fail;
+
+	/* Plane of every triangle, accumulated at its corners */
+	for(unsigned long i = 0; i < k; i += 3) {
+		double n[3];
+		const double len = f_meshopt_normal(v[out[i]].pos, v[out[i + 1]].pos, v[out[i + 2]].pos, n);
+		if(len == 0) continue;
+
+		const double pa = n[0] / len, pb = n[1] / len, pc = n[2] / len;
+		const double pd = -(pa * v[out[i]].pos[0] + pb * v[out[i]].pos[1] + pc * v[out[i]].pos[2]);
+		const struct t_quadric p = { pa * pa, pa * pb, pa * pc, pa * pd, pb * pb, pb * pc, pb * pd, pc * pc, pc * pd, pd * pd };
+		for(int c = 0; c < 3; ++c) f_quadric_add(&q[out[i + c]], &p);
+	}
+
+	double maxcost = 0;
+	for(uint32_t pass = 1; k > target; ++pass) {
+		/* Triangles around every vertex */
+		memset(first, 0, (nv + 1) * sizeof *first);
+		for(unsigned long i = 0; i < k; ++i) first[out[i] + 1]++;
+		for(unsigned long i = 0; i < nv; ++i) first[i + 1] += first[i];
+		for(unsigned long i = 0; i < k; ++i) adj[first[out[i]]++] = i / 3;
+		for(unsigned long i = nv; i > 0; --i) first[i] = first[i - 1];
+		first[0] = 0;
+
+		/* Cheaper direction of every edge, once per pair of half edges */
+		unsigned long nc = 0;
+		for(unsigned long i = 0; i < k; ++i) {
+			const uint32_t a = out[i], b = out[i - i % 3 + (i + 1) % 3];
+			if(a > b || (locked[a] && locked[b])) continue;
+
+			struct t_quadric s = q[a];
+			f_quadric_add(&s, &q[b]);
+			const float ab = locked[a] ? INFINITY : (float)f_quadric_eval(&s, v[b].pos);
+			const float ba = locked[b] ? INFINITY : (float)f_quadric_eval(&s, v[a].pos);
+
+			struct t_collapse c = ab <= ba ? (struct t_collapse){ 0, a, b } : (struct t_collapse){ 0, b, a };
+			const float cost = ab <= ba ? ab : ba;
+			memcpy(&c.key, &cost, sizeof c.key);
+			cand[nc++] = c;
+		}
+		f_collapse_sort(cand, tmp, nc);
+
+		/* Each collapse removes about two triangles, and freezes the vertices */
+		/* around it for the rest of the pass so the fold over test stays valid */
+		const unsigned long want = (k - target) / 6 + 1;
+		unsigned long done = 0;
+		for(unsigned long i = 0; i < nc && done < want; ++i) {
+			const uint32_t a = cand[i].from, b = cand[i].to;
+			if(stamp[a] == pass || stamp[b] == pass) continue;
+
+			int ok = 1;
+			for(uint32_t j = first[a]; j < first[a + 1] && ok; ++j) {
+				const uint32_t *t = out + adj[j] * 3;
+				if(t[0] == b || t[1] == b || t[2] == b) continue;
+
+				const float *p[3], *r[3];
+				for(int c = 0; c < 3; ++c) p[c] = v[t[c]].pos, r[c] = t[c] == a ? v[b].pos : p[c];
+
+				double n0[3], n1[3];
+				f_meshopt_normal(p[0], p[1], p[2], n0);
+				ok = f_meshopt_normal(r[0], r[1], r[2], n1) > 0
+					&& n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] > 0;
+			}
+			if(!ok) continue;
+
+			float cost;
+			memcpy(&cost, &cand[i].key, sizeof cost);
+			if(cost > maxcost) maxcost = cost;
+
+			into[a] = b, done++;
+			f_quadric_add(&q[b], &q[a]);
+			for(uint32_t j = first[a]; j < first[a + 1]; ++j)
+				for(int c = 0; c < 3; ++c) stamp[out[adj[j] * 3 + c]] = pass;
+		}
+		if(!done) break;
+
+		for(unsigned long i = 0; i < k; ++i) out[i] = into[out[i]];
+		k = f_meshopt_compact(out, k);
+	}
+
+	*error = (float)sqrt(maxcost);
+	free(rep), free(firstof), free(into), free(stamp), free(first), free(adj);
+	free(q), free(cand), free(tmp), free(locked);
+	return k;
+
+fail:
+	free(rep), free(firstof), free(into), free(stamp), free(first), free(adj);
+	free(q), free(cand), free(tmp), free(locked);
+	return -1;
+}
+
+/* Append coarser levels of detail to the index buffer, each simplified from the previous */
+/* one to MESHOPT_LOD_RATIO of its triangles, until MESH_MAXLODS levels, MESHOPT_LOD_MINTRIS */
+/* triangles or a level that barely shrinks - errors add up along the chain */
+int f_mesh_build_lods(struct t_mesh *m) {
+	if(!m->ni) return 0;
+
+	const unsigned long cap = m->ni * 2;
+	uint32_t *idx = malloc(cap * sizeof *idx);
+	if(!idx) return -1;
+	memcpy(idx, m->idx, m->ni * sizeof *idx);
+
+	m->nlods = 1;
+	m->lods[0] = (struct t_meshlod){ 0, m->ni, 0, 0 };
+
+	while(m->nlods < MESH_MAXLODS) {
+		const struct t_meshlod *prev = &m->lods[m->nlods - 1];
+		const unsigned long target = (unsigned long)(prev->count / 3 * MESHOPT_LOD_RATIO) * 3;
+		if(target < MESHOPT_LOD_MINTRIS * 3 || prev->first + prev->count * 2UL > cap) break;
+
+		float err;
+		const uint32_t first = prev->first + prev->count;
+		const long n = f_mesh_simplify(idx + first, idx + prev->first, prev->count, m->v, m->nv, target, &err);
+		if(n < 0) return free(idx), -1;
+		if(!n || n * 10 > prev->count * 9L) break;
+
+		m->lods[m->nlods] = (struct t_meshlod){ first, n, prev->error + err, 0 };
+		m->nlods++;
+	}
+
+	const struct t_meshlod *last = &m->lods[m->nlods - 1];
+	free(m->idx);
+	m->ni = last->first + last->count;
+	m->idx = realloc(idx, m->ni * sizeof *idx);
+	if(!m->idx) m->idx = idx;
+	return 0;
+}
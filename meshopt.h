@@ -0,0 +1,33 @@
+#ifndef __H__MESHOPT_H___
+#define __H__MESHOPT_H___
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+/* Post-transform cache size assumed by the optimizer and the statistics */
+#define MESHOPT_CACHE_SIZE 16
+
+/* Each level of detail keeps about this share of the previous level's triangles */
+#define MESHOPT_LOD_RATIO 0.5f
+/* No levels are generated below this many triangles */
+#define MESHOPT_LOD_MINTRIS 64
+
+/* Average cache miss ratio (transformed vertices per triangle, 0.5 - 3) */
+/* and average transform to vertex ratio (1 is optimal) */
+struct t_vcachestats {
+	float acmr, atvr;
+};
+
+long f_mesh_weld(const void *, size_t, size_t, unsigned long, uint32_t *);
+void f_mesh_remap_vertices(void *, const void *, size_t, unsigned long, const uint32_t *);
+int f_mesh_from_verts(struct t_mesh *, const struct vert *, unsigned long);
+int f_mesh_vcache_tipsify(uint32_t *, const uint32_t *, unsigned long, unsigned long, unsigned int);
+unsigned long f_mesh_vfetch_remap(uint32_t *, unsigned long, unsigned long, uint32_t *);
+void f_mesh_vcache_stats(const uint32_t *, unsigned long, unsigned long, unsigned int, struct t_vcachestats *);
+int f_mesh_optimize(struct t_mesh *);
+long f_mesh_simplify(uint32_t *, const uint32_t *, unsigned long, const struct t_vsrc *, unsigned long, unsigned long, float *);
+int f_mesh_build_lods(struct t_mesh *);
+
+#endif
@@ -18,13 +18,14 @@
 #if DEBUG
 	#define M_CC "gcc", "-Wall", "-Wextra", "-Wpedantic", "-Wswitch", "-Wvla", "-g"
 #else
-	#define M_CC "gcc", "-Wall", "-Wextra", "-Wpedantic", "-Wswitch", "-Wvla"
+	#define M_CC "gcc", "-Wall", "-Wextra", "-Wpedantic", "-Wswitch", "-Wvla", "-O2"
 #endif
 
-#define M_OBJS "obj/window.o", "obj/main.o"
-#define M_HEADERS "window.h"
-#define M_LFLAGS "-lm", "-lglfw", "-lepoxy"
+#define M_OBJS "obj/window.o", "obj/headless.o", "obj/clock.o", "obj/bench.o", "obj/gputimer.o", "obj/stream.o", "obj/vertex.o", "obj/batch.o", "obj/instance.o", "obj/shader.o", "obj/hotreload.o", "obj/cmdqueue.o", "obj/vecmath.o", "obj/camera.o", "obj/cull.o", "obj/scene.o", "obj/jobs.o", "obj/mesh.o", "obj/meshbin.o", "obj/meshopt.o", "obj/texture.o", "obj/bcenc.o", "obj/texbin.o", "obj/pacing.o", "obj/inputlat.o", "obj/record.o", "obj/frame.o", "obj/render.o", "obj/benchmarks.o", "obj/main.o"
+#define M_HEADERS "window.h", "headless.h", "clock.h", "bench.h", "gputimer.h", "stream.h", "vertex.h", "batch.h", "instance.h", "shader.h", "hotreload.h", "cmdqueue.h", "vecmath.h", "camera.h", "cull.h", "scene.h", "jobs.h", "mesh.h", "meshbin.h", "meshopt.h", "texture.h", "bcenc.h", "texbin.h", "pacing.h", "inputlat.h", "record.h", "frame.h", "render.h", "benchmarks.h"
+#define M_LFLAGS "-lm", "-lpthread", "-lglfw", "-lepoxy"
 #define M_OBJCOMP "-c", "-I", "include"
+#define M_ASSETS "assets"
 
 void _die(const char* msg, int ret) {
 	fprintf(stderr, "%s\n", msg);
@@ -60,6 +61,10 @@ int main(int argc, char* argv[]) {
 		} else if(!strcmp(argv[1], "run")) {
 			nob_cmd_append(&cmd, "./render");
 			return nob_cmd_run(&cmd) ? 0 : -1;
+		} else if(!strcmp(argv[1], "bench")) {
+			/* Offscreen frame-time benchmark with golden image check */
+			nob_cmd_append(&cmd, "./render", "--headless", "1000", "128", "128", "golden/triangle_128x128.ppm");
+			return nob_cmd_run(&cmd) ? 0 : -1;
 		} else {
 			nob_log(NOB_ERROR, "Invalid option '%s'", argv[1]);
 			return -1;
@@ -77,22 +82,181 @@ int main(int argc, char* argv[]) {
 	putchar('\n');
 
 	/* Check for updates and recompile object files */
-	if(CHECK_REBUILD_WITH_NOB("obj/main.o", "main.c", "window.h")) {
+	if(CHECK_REBUILD_WITH_NOB("obj/main.o", "main.c", M_HEADERS)) {
 		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "main.c", "-o", "obj/main.o");
 		try_run(&cmd);
 	}
 
-	if(CHECK_REBUILD_WITH_NOB("obj/window.o", "window.c", "window.h")) {
+	if(CHECK_REBUILD_WITH_NOB("obj/window.o", "window.c", "window.h", "clock.h")) {
 		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "window.c", "-o", "obj/window.o");
 		try_run(&cmd);
 	}
 
+	if(CHECK_REBUILD_WITH_NOB("obj/headless.o", "headless.c", "headless.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "headless.c", "-o", "obj/headless.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/clock.o", "clock.c", "clock.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "clock.c", "-o", "obj/clock.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/bench.o", "bench.c", "bench.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "bench.c", "-o", "obj/bench.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/gputimer.o", "gputimer.c", "gputimer.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "gputimer.c", "-o", "obj/gputimer.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/stream.o", "stream.c", "stream.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "stream.c", "-o", "obj/stream.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/vertex.o", "vertex.c", "vertex.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "vertex.c", "-o", "obj/vertex.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/batch.o", "batch.c", "batch.h", "vertex.h", "stream.h", "shader.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "batch.c", "-o", "obj/batch.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/instance.o", "instance.c", "instance.h", "vertex.h", "stream.h", "shader.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "instance.c", "-o", "obj/instance.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/shader.o", "shader.c", "shader.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "shader.c", "-o", "obj/shader.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/hotreload.o", "hotreload.c", "hotreload.h", "shader.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "hotreload.c", "-o", "obj/hotreload.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/cmdqueue.o", "cmdqueue.c", "cmdqueue.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "cmdqueue.c", "-o", "obj/cmdqueue.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/vecmath.o", "vecmath.c", "vecmath.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "vecmath.c", "-o", "obj/vecmath.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/camera.o", "camera.c", "camera.h", "vecmath.h", "window.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "camera.c", "-o", "obj/camera.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/cull.o", "cull.c", "cull.h", "vecmath.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "cull.c", "-o", "obj/cull.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/scene.o", "scene.c", "scene.h", "vecmath.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "scene.c", "-o", "obj/scene.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/jobs.o", "jobs.c", "jobs.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "jobs.c", "-o", "obj/jobs.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/mesh.o", "mesh.c", "mesh.h", "vertex.h", "jobs.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "mesh.c", "-o", "obj/mesh.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/meshbin.o", "meshbin.c", "meshbin.h", "mesh.h", "vertex.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "meshbin.c", "-o", "obj/meshbin.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/meshopt.o", "meshopt.c", "meshopt.h", "mesh.h", "vertex.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "meshopt.c", "-o", "obj/meshopt.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/texture.o", "texture.c", "texture.h", "jobs.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "texture.c", "-o", "obj/texture.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/bcenc.o", "bcenc.c", "bcenc.h", "jobs.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "bcenc.c", "-o", "obj/bcenc.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/texbin.o", "texbin.c", "texbin.h", "bcenc.h", "jobs.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "texbin.c", "-o", "obj/texbin.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/pacing.o", "pacing.c", "pacing.h", "bench.h", "clock.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "pacing.c", "-o", "obj/pacing.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/inputlat.o", "inputlat.c", "inputlat.h", "window.h", "clock.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "inputlat.c", "-o", "obj/inputlat.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/record.o", "record.c", "record.h", "window.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "record.c", "-o", "obj/record.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/frame.o", "frame.c", "frame.h", "window.h", "pacing.h", "inputlat.h", "record.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "frame.c", "-o", "obj/frame.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/render.o", "render.c", "render.h", "window.h", "vertex.h", "gputimer.h", "cmdqueue.h", "vecmath.h", "cull.h", "scene.h", "jobs.h", "mesh.h", "meshbin.h", "shader.h", "meshopt.h")) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "render.c", "-o", "obj/render.o");
+		try_run(&cmd);
+	}
+
+	if(CHECK_REBUILD_WITH_NOB("obj/benchmarks.o", "benchmarks.c", M_HEADERS)) {
+		nob_cmd_append(&cmd, M_CC, M_OBJCOMP, "benchmarks.c", "-o", "obj/benchmarks.o");
+		try_run(&cmd);
+	}
+
 	/* Recompile final executable from objects */
 	if(CHECK_REBUILD_WITH_NOB("render", M_OBJS)) {
 		nob_cmd_append(&cmd, M_CC, M_LFLAGS, M_OBJS, "-o", "render");
 		try_run(&cmd);
 	}
 
+	/* Convert source meshes and images in assets/ to the containers loaded at startup */
+	/* (textures get their mip chain and block compression, see f_bake_texture) */
+	Nob_File_Paths assets = {0};
+	if(nob_get_file_type(M_ASSETS) == NOB_FILE_DIRECTORY && nob_read_entire_dir(M_ASSETS, &assets)) {
+		for(size_t i = 0; i < assets.count; ++i) {
+			const Nob_String_View name = nob_sv_from_cstr(assets.items[i]);
+			const int mesh = nob_sv_end_with(name, ".obj");
+			if(!mesh && !nob_sv_end_with(name, ".ppm") && !nob_sv_end_with(name, ".tga")) continue;
+
+			const char *in = nob_temp_sprintf(M_ASSETS "/%s", assets.items[i]);
+			const char *out = nob_temp_sprintf(M_ASSETS "/%.*s.%s", (int)name.count - 4, name.data, mesh ? "rmesh" : "rtex");
+			if(CHECK_REBUILD(out, in, "render")) {
+				nob_cmd_append(&cmd, "./render", mesh ? "--bake" : "--bake-texture", in, out);
+				try_run(&cmd);
+			}
+		}
+		nob_da_free(assets);
+	}
+
 	nob_cmd_free(cmd);
 	return 0;
 }
@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 200112L
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "clock.h"
+#include "pacing.h"
+
+/* References
+ * ----------
+ * GLX_EXT_swap_control_tear, WGL_EXT_swap_control_tear [adaptive vsync]
+ * J. M. P. van Waveren, "The Asynchronous Time Warp for Virtual Reality
+ * on Consumer Hardware" (VRST 2016) [late latching]
+ */
+
+const char* const pacemode_names[PACE_COUNT] = { "vsync", "off", "adaptive", "limit", "latch" };
+
+
+/* Mode by name, -1 if unknown */
+int f_pace_parse(const char *name) {
+	for(int m = 0; m < PACE_COUNT; ++m)
+		if(!strcmp(name, pacemode_names[m])) return m;
+	return -1;
+}
+
+/* The period is the limiter's target, and the refresh period for the latch */
+/* (hz <= 0 disables both waits) - swapinterval sets the current context's */
+/* interval and returns the one it could set, it may be NULL without a window */
+void f_pace_init(struct t_pacer *p, enum e_pacemode mode, double hz, int (*swapinterval)(int)) {
+	*p = (struct t_pacer){ .mode = mode, .period = hz > 0 ? 1 / hz : 0, .spin = PACE_SPIN };
+
+	const int want = mode == PACE_OFF || mode == PACE_LIMIT ? 0 : mode == PACE_ADAPTIVE ? -1 : 1;
+	p->interval = swapinterval ? swapinterval(want) : want;
+	p->next = f_clock_now();
+}
+
+/* Sleep on the monotonic clock until spin seconds before t, then spin up to t */
+void f_pace_sleepuntil(double t, double spin) {
+	const double wake = t - spin;
+	if(wake > f_clock_now()) {
+		const struct timespec ts = { (time_t)wake, (long)((wake - (time_t)wake) * 1e9) };
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+	}
+	while(f_clock_now() < t);
+}
+
+/* Before a frame, returns the time input may be sampled - the latch waits */
+/* until the expected refresh minus the recent sampling to submission time, */
+/* so the frame is submitted just in time for it */
+double f_pace_begin(struct t_pacer *p) {
+	if(p->period > 0 && p->mode == PACE_LATCH) f_pace_sleepuntil(p->next - p->work - PACE_LATCH_MARGIN, p->spin);
+	return p->sampled = f_clock_now();
+}
+
+/* Just before the swap - the limiter waits for its deadline here, so frames */
+/* are presented on its clock whatever their work */
+void f_pace_submit(struct t_pacer *p) {
+	p->submit = f_clock_now();
+	if(p->period > 0 && p->mode == PACE_LIMIT) f_pace_sleepuntil(p->next, p->spin);
+}
+
+/* After the swap: record the frame interval and plan the next frame */
+void f_pace_end(struct t_pacer *p) {
+	const double now = f_clock_now();
+	if(p->last > 0) {
+		p->hist[p->frames++ % PACE_HISTORY] = now - p->last;
+		p->latsum += now - p->sampled;
+	}
+	p->last = now;
+
+	/* Submission time estimate: rises at once, decays slowly */
+	const double w = p->submit - p->sampled;
+	p->work = w > p->work ? w : p->work + (w - p->work) / 16;
+
+	/* The limiter keeps its own clock (restarted after a late frame), */
+	/* otherwise the swap returning marks the last refresh */
+	if(p->mode != PACE_LIMIT) p->next = now + p->period;
+	else if((p->next += p->period) < now) p->next = now;
+}
+
+void f_pace_stats(const struct t_pacer *p, struct t_pace_stats *st) {
+	const unsigned int n = p->frames < PACE_HISTORY ? p->frames : PACE_HISTORY;
+	*st = (struct t_pace_stats){ .n = n };
+	if(!n) return;
+
+	double sum = 0, sq = 0;
+	for(unsigned int i = 0; i < n; ++i) sum += p->hist[i];
+	st->mean = sum / n;
+	for(unsigned int i = 0; i < n; ++i) sq += (p->hist[i] - st->mean) * (p->hist[i] - st->mean);
+	st->jitter = sqrt(sq / n);
+	st->latency = p->latsum / p->frames;
+
+	const double target = p->mode == PACE_OFF || p->period <= 0 ? st->mean : p->period;
+	double dev[PACE_HISTORY];
+	for(unsigned int i = 0; i < n; ++i) dev[i] = fabs(p->hist[i] - target);
+
+	struct t_bench_stats bs;
+	f_bench_stats(dev, n, &bs);
+	st->p99dev = bs.p99;
+}
+
+void f_pace_print(FILE *f, const struct t_pacer *p) {
+	struct t_pace_stats st;
+	f_pace_stats(p, &st);
+	fprintf(f, "Pacing %s (swap interval %d): n = %u, mean = %.3f ms, jitter = %.3f ms, p99 deviation = %.3f ms, input to swap = %.3f ms\n",
+		pacemode_names[p->mode], p->interval, st.n, st.mean * 1e3, st.jitter * 1e3, st.p99dev * 1e3, st.latency * 1e3);
+}
@@ -0,0 +1,55 @@
+#ifndef __H__PACING_H___
+#define __H__PACING_H___
+
+#include <stdio.h>
+
+/* vsync: swap interval 1, off: 0, adaptive: -1 (late frames tear instead of */
+/* waiting a whole refresh), limit: no vsync, frames presented on a fixed clock, */
+/* latch: vsync, input sampled as late as the measured frame time allows */
+enum e_pacemode { PACE_VSYNC, PACE_OFF, PACE_ADAPTIVE, PACE_LIMIT, PACE_LATCH, PACE_COUNT };
+
+/* Frame intervals kept for the jitter statistics */
+#define PACE_HISTORY 1024
+
+/* Last part of a wait spent spinning, sleeps overshoot by up to this much (s) */
+#define PACE_SPIN 0.002
+
+/* Input is latched this much earlier than the frame time estimate requires (s) */
+#define PACE_LATCH_MARGIN 0.002
+
+/* Measured frame intervals: jitter is their standard deviation, and the p99 */
+/* of their distance to the target period (to the mean if there is none) */
+struct t_pace_stats {
+	double mean, jitter, p99dev, latency;
+	unsigned int n;
+};
+
+/* Frame pacing state, all times in seconds on CLOCK_MONOTONIC */
+struct t_pacer {
+	enum e_pacemode mode;
+	int interval;
+	double period, spin;
+
+	/* Deadline of the current frame, when its input was sampled and when */
+	/* it was submitted (just before the swap) */
+	double next, sampled, submit;
+	/* End of the previous frame, and smoothed time from sampling to the end */
+	double last, work;
+
+	double hist[PACE_HISTORY];
+	unsigned long frames;
+	double latsum;
+};
+
+extern const char* const pacemode_names[PACE_COUNT];
+
+int f_pace_parse(const char *);
+void f_pace_init(struct t_pacer *, enum e_pacemode, double, int (*)(int));
+void f_pace_sleepuntil(double, double);
+double f_pace_begin(struct t_pacer *);
+void f_pace_submit(struct t_pacer *);
+void f_pace_end(struct t_pacer *);
+void f_pace_stats(const struct t_pacer *, struct t_pace_stats *);
+void f_pace_print(FILE *, const struct t_pacer *);
+
+#endif
@@ -0,0 +1,239 @@
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "record.h"
+
+/* References
+ * ----------
+ * G. Fiedler, "Fix Your Timestep!"
+ * "https://gafferongames.com/post/fix_your_timestep/"
+ * G. Fiedler, "Deterministic Lockstep"
+ * "https://gafferongames.com/post/deterministic_lockstep/"
+ */
+
+/* Field bytes of each record type, after the type byte */
+static const size_t rec_fields[] = {
+	[REC_FRAME] = 0, [REC_CURSOR] = 8, [REC_RESIZE] = 8,
+	[REC_KEY] = 12, [REC_MOUSEBUTTON] = 12, [REC_SCROLL] = 16
+};
+
+/* Little endian fields, whatever the byte order of the host */
+static void f_le16_put(unsigned char *p, uint16_t v) {
+	p[0] = v, p[1] = v >> 8;
+}
+
+static void f_le32_put(unsigned char *p, uint32_t v) {
+	p[0] = v, p[1] = v >> 8, p[2] = v >> 16, p[3] = v >> 24;
+}
+
+static void f_lef32_put(unsigned char *p, float v) {
+	uint32_t u;
+	memcpy(&u, &v, 4);
+	f_le32_put(p, u);
+}
+
+static uint16_t f_le16_get(const unsigned char *p) {
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t f_le32_get(const unsigned char *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static float f_lef32_get(const unsigned char *p) {
+	const uint32_t u = f_le32_get(p);
+	float v;
+	memcpy(&v, &u, 4);
+	return v;
+}
+
+static void f_record_put(struct t_recorder *r, enum e_rectype type, const unsigned char *fields) {
+	if(!r->f) return;
+	fputc(type, r->f);
+	if(rec_fields[type]) fwrite(fields, 1, rec_fields[type], r->f);
+}
+
+/* Write the header - the size is the framebuffer's when recording starts */
+int f_record_open(struct t_recorder *r, const char *path, int width, int height) {
+	*r = (struct t_recorder){ .mx = NAN, .my = NAN };
+
+	unsigned char h[RECORD_HEADER_SIZE];
+	memcpy(h, RECORD_MAGIC, 4);
+	f_le32_put(h + 4, RECORD_VERSION);
+	f_le32_put(h + 8, width), f_le32_put(h + 12, height);
+
+	if(!(r->f = fopen(path, "wb"))) return -1;
+	if(fwrite(h, sizeof h, 1, r->f) != 1) return fclose(r->f), r->f = NULL, -1;
+	return 0;
+}
+
+int f_record_close(struct t_recorder *r) {
+	if(!r->f) return -1;
+	const int err = ferror(r->f) | fclose(r->f);
+	r->f = NULL;
+	return err ? -1 : 0;
+}
+
+void f_record_resize(struct t_recorder *r, int width, int height) {
+	unsigned char b[8];
+	f_le32_put(b, width), f_le32_put(b + 4, height);
+	f_record_put(r, REC_RESIZE, b);
+}
+
+/* An event consumed by the frame in progress (its time is not kept) */
+void f_record_event(struct t_recorder *r, const struct t_glfw_inputevent *ev) {
+	unsigned char b[16];
+
+	switch(ev->type) {
+		case IEV_KEYPRESS:
+		case IEV_MOUSEBUTTON: {
+			/* Key and mouse button data share their layout */
+			const struct t_glfw_inputevent_key *k = &ev->data.key_ev;
+			f_le16_put(b, (uint16_t)k->key);
+			b[2] = k->action, b[3] = k->mods;
+			f_lef32_put(b + 4, ev->mx), f_lef32_put(b + 8, ev->my);
+			f_record_put(r, ev->type == IEV_KEYPRESS ? REC_KEY : REC_MOUSEBUTTON, b);
+			break;
+		}
+
+		case IEV_SCROLL: {
+			f_lef32_put(b, ev->data.scroll_ev.sx), f_lef32_put(b + 4, ev->data.scroll_ev.sy);
+			f_lef32_put(b + 8, ev->mx), f_lef32_put(b + 12, ev->my);
+			f_record_put(r, REC_SCROLL, b);
+			break;
+		}
+	}
+}
+
+/* End of the input of a frame, which read the cursor at mx, my */
+void f_record_frame(struct t_recorder *r, double mx, double my) {
+	if((float)mx != r->mx || (float)my != r->my) {
+		r->mx = mx, r->my = my;
+		unsigned char b[8];
+		f_lef32_put(b, r->mx), f_lef32_put(b + 4, r->my);
+		f_record_put(r, REC_CURSOR, b);
+	}
+	f_record_put(r, REC_FRAME, NULL);
+	r->frames++;
+}
+
+/* Check every record, records after the last complete frame (a recording cut */
+/* short) are ignored - returns 0, -2 (not a recording), -3 (other version), -4 (corrupt) */
+static int f_replay_scan(struct t_replay *rp) {
+	const unsigned char *b = rp->base;
+	if(rp->size < RECORD_HEADER_SIZE || memcmp(b, RECORD_MAGIC, 4)) return -2;
+
+	struct t_record_header *h = &rp->h;
+	memcpy(h->magic, b, 4);
+	h->version = f_le32_get(b + 4);
+	h->width = f_le32_get(b + 8), h->height = f_le32_get(b + 12);
+	if(h->version != RECORD_VERSION) return -3;
+	if(h->width <= 0 || h->height <= 0) return -4;
+
+	rp->maxwidth = h->width, rp->maxheight = h->height;
+
+	unsigned int events = 0;
+	for(size_t pos = RECORD_HEADER_SIZE; pos < rp->size; ) {
+		const unsigned char type = b[pos];
+		if(type < REC_FRAME || type > REC_SCROLL) return -4;
+		if(rec_fields[type] >= rp->size - pos) break;
+
+		if(type == REC_RESIZE) {
+			const int32_t wh[2] = { f_le32_get(b + pos + 1), f_le32_get(b + pos + 5) };
+			if(wh[0] <= 0 || wh[1] <= 0) return -4;
+			if(wh[0] > rp->maxwidth) rp->maxwidth = wh[0];
+			if(wh[1] > rp->maxheight) rp->maxheight = wh[1];
+		}
+		else if(type == REC_FRAME) {
+			if(events > rp->maxevents) rp->maxevents = events;
+			events = 0, rp->frames++;
+		}
+		else if(type != REC_CURSOR) events++;
+
+		pos += 1 + rec_fields[type];
+	}
+
+	rp->pos = RECORD_HEADER_SIZE;
+	return 0;
+}
+
+/* Map a recording, returns 0, -1 if it can't be mapped, or an error of the scan */
+int f_replay_open(struct t_replay *rp, const char *path) {
+	*rp = (struct t_replay){0};
+
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) || st.st_size <= 0) return close(fd), -1;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return -1;
+
+	rp->base = map, rp->size = st.st_size;
+	const int ret = f_replay_scan(rp);
+	if(ret) f_replay_close(rp);
+	return ret;
+}
+
+void f_replay_close(struct t_replay *rp) {
+	if(rp->base) munmap(rp->base, rp->size);
+	*rp = (struct t_replay){0};
+}
+
+/* Replay the input of the next frame: events go through the window's queue, */
+/* stamped with the given time, resizes and the cursor into the window state */
+/* Returns 1, 0 once every frame was replayed, -1 if the queue is too small */
+/* (it needs room for maxevents) */
+int f_replay_frame(struct t_replay *rp, struct t_glfw_winstate *wst, double time) {
+	if(rp->frame >= rp->frames) return 0;
+
+	const unsigned char *b = rp->base;
+	for(;;) {
+		const enum e_rectype type = b[rp->pos];
+		const unsigned char *f = b + rp->pos + 1;
+		rp->pos += 1 + rec_fields[type];
+
+		struct t_glfw_inputevent ev = { .time = time };
+		float xy[2] = { 0, 0 };
+		switch(type) {
+			case REC_FRAME:
+				rp->frame++;
+				return 1;
+
+			case REC_CURSOR:
+				wst->mx = f_lef32_get(f), wst->my = f_lef32_get(f + 4);
+				continue;
+
+			case REC_RESIZE: {
+				wst->width = (int32_t)f_le32_get(f), wst->height = (int32_t)f_le32_get(f + 4);
+				wst->szrefresh = 1;
+				wst->resizes++;
+				continue;
+			}
+
+			case REC_KEY:
+			case REC_MOUSEBUTTON: {
+				ev.type = type == REC_KEY ? IEV_KEYPRESS : IEV_MOUSEBUTTON;
+				ev.data.key_ev = (struct t_glfw_inputevent_key){ (int16_t)f_le16_get(f), f[2], f[3] };
+				xy[0] = f_lef32_get(f + 4), xy[1] = f_lef32_get(f + 8);
+				break;
+			}
+
+			case REC_SCROLL: {
+				ev.type = IEV_SCROLL;
+				ev.data.scroll_ev = (struct t_glfw_inputevent_scroll){ f_lef32_get(f), f_lef32_get(f + 4) };
+				xy[0] = f_lef32_get(f + 8), xy[1] = f_lef32_get(f + 12);
+				break;
+			}
+		}
+
+		ev.mx = xy[0], ev.my = xy[1];
+		if(f_iqappend(&wst->iq, &ev)) return -1;
+	}
+}
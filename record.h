@@ -0,0 +1,60 @@
+#ifndef __H__RECORD_H___
+#define __H__RECORD_H___
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "window.h"
+
+#define RECORD_MAGIC "RINP"
+#define RECORD_VERSION 1
+
+/* Record types - each record is its type byte followed by its fields, packed: */
+/* frame: none (ends the input consumed by one frame) */
+/* cursor: f32 x, y (cursor position of the frames that follow) */
+/* resize: i32 width, height */
+/* key, mouse button: i16 key or button, u8 action, u8 mods, f32 x, y */
+/* scroll: f32 sx, sy, x, y */
+enum e_rectype { REC_FRAME = 1, REC_CURSOR, REC_RESIZE, REC_KEY, REC_MOUSEBUTTON, REC_SCROLL };
+
+/* File header (RECORD_HEADER_SIZE bytes) - records follow until the end of */
+/* the file, every field of the header and the records is little endian */
+#define RECORD_HEADER_SIZE 16
+
+struct t_record_header {
+	char magic[4];
+	uint32_t version;
+	int32_t width, height;
+};
+
+/* Input consumed by the render loop, written as it goes */
+struct t_recorder {
+	FILE *f;
+	float mx, my;
+	unsigned long frames;
+};
+
+/* A mapped recording - opening it checks every record, and finds the number of */
+/* complete frames, the most events in one frame and the largest framebuffer */
+struct t_replay {
+	void *base;
+	size_t size, pos;
+	struct t_record_header h;
+
+	unsigned long frames, frame;
+	unsigned int maxevents;
+	int maxwidth, maxheight;
+};
+
+int f_record_open(struct t_recorder *, const char *, int, int);
+int f_record_close(struct t_recorder *);
+void f_record_resize(struct t_recorder *, int, int);
+void f_record_event(struct t_recorder *, const struct t_glfw_inputevent *);
+void f_record_frame(struct t_recorder *, double, double);
+
+int f_replay_open(struct t_replay *, const char *);
+void f_replay_close(struct t_replay *);
+int f_replay_frame(struct t_replay *, struct t_glfw_winstate *, double);
+
+#endif
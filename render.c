@@ -0,0 +1,259 @@
+#include <epoxy/gl.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "render.h"
+#include "shader.h"
+#include "meshopt.h"
+
+struct vert vertices[3] = {
+	{ { -1, -1, 0 }, { 0xFF, 0x00, 0x00 } },
+	{ {  1, -1, 0 }, { 0x00, 0xFF, 0x00 } },
+	{ {  0,  1, 0 }, { 0x00, 0x00, 0xFF } },
+};
+
+/* Bind the main program and set its uniforms (again after it is reloaded) */
+void f_render_useprogram(struct t_render_state *rs) {
+	glUseProgram(rs->sp);
+	glUniform3fv(0, 1, rs->q.scale);
+	glUniform3fv(1, 1, rs->q.bias);
+}
+
+/* Mesh containers hold vertices colored by their normals, as the main shader has no lighting */
+void f_mesh_normal_colors(struct t_mesh *m) {
+	for(unsigned long i = 0; i < m->nv; ++i)
+		for(int c = 0; c < 3; ++c) m->v[i].clr[c] = m->v[i].nrm[c] * 0.5f + 0.5f;
+}
+
+/* Reorder a mesh for the vertex caches, reporting the cache statistics if asked to */
+int f_render_optimize(struct t_mesh *m, FILE *report) {
+	struct t_vcachestats before, after;
+	if(report) f_mesh_vcache_stats(m->idx, m->ni, m->nv, MESHOPT_CACHE_SIZE, &before);
+	if(f_mesh_optimize(m)) return -1;
+
+	if(report) {
+		f_mesh_vcache_stats(m->idx, m->ni, m->nv, MESHOPT_CACHE_SIZE, &after);
+		fprintf(report, "Vertex cache (%d entries): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+			MESHOPT_CACHE_SIZE, before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+	return 0;
+}
+
+/* Generate levels of detail, reporting their sizes and errors if asked to */
+int f_render_lods(struct t_mesh *m, FILE *report) {
+	if(f_mesh_build_lods(m)) return -1;
+
+	if(report)
+		for(unsigned int l = 0; l < m->nlods; ++l)
+			fprintf(report, "LOD %u: %u triangles, error %g\n", l, m->lods[l].count / 3, m->lods[l].error);
+	return 0;
+}
+
+/* Meshes lying in a z plane (like the built in triangle) drop z and take 8 bytes */
+/* per vertex, others 12 */
+static const struct t_vformat* f_render_vformat(const struct t_mesh *m) {
+	for(unsigned long i = 1; i < m->nv; ++i)
+		if(m->v[i].pos[2] != m->v[0].pos[2]) return &vfmt_compact;
+	return &vfmt_flat;
+}
+
+/* Draws the given mesh container, or the built in triangle without one */
+int f_render_init(struct t_render_state *rs, const struct t_meshbin *mesh) {
+	/* Zeroed first, so every failure can unwind through f_render_destroy */
+	*rs = (struct t_render_state){0};
+
+	glGenVertexArrays(1, &rs->VAO);
+	glBindVertexArray(rs->VAO);
+
+	/* The triangle list is welded into an indexed mesh like any other */
+	struct t_meshbin tri;
+	if(!mesh) {
+		struct t_mesh m;
+		if(f_mesh_from_verts(&m, vertices, sizeof vertices / sizeof *vertices)) return f_render_destroy(rs), -1;
+
+		const int err = f_render_optimize(&m, NULL) || f_meshbin_build(&tri, &m, f_render_vformat(&m));
+		f_mesh_free(&m);
+		if(err) return f_render_destroy(rs), -1;
+	}
+	const struct t_meshbin *mb = mesh ? mesh : &tri;
+
+	/* Streams are already in their GPU layout */
+	f_meshbin_upload(mb, &rs->VBO, &rs->EBO);
+	glBindBuffer(GL_ARRAY_BUFFER, rs->VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, rs->EBO);
+	f_vformat_apply(&mb->h->fmt);
+
+	rs->q = mb->h->q;
+	rs->nlods = mb->h->nlods;
+	memcpy(rs->lods, mb->h->lods, rs->nlods * sizeof *rs->lods);
+	rs->eye = (struct t_vec3){ 0, 0, 0 }, rs->fovy = 0;
+	const struct t_aabb bounds = {
+		{ mb->h->center[0], mb->h->center[1], mb->h->center[2] },
+		{ mb->h->extent[0], mb->h->extent[1], mb->h->extent[2] }
+	};
+	if(!mesh) f_meshbin_close(&tri);
+
+	char *vs = f_shader_read(MAIN_VERT), *fs = f_shader_read(MAIN_FRAG);
+	rs->sp = vs && fs ? f_program_load(vs, fs) : 0;
+	free(vs), free(fs);
+	if(!rs->sp) return f_render_destroy(rs), -1;
+
+	f_render_useprogram(rs);
+
+	/* Per pass GPU times, optionally dumped as CSV */
+	f_gputimer_init(&rs->gt, getenv("RENDER_GPU_CSV"));
+	if(f_cmdq_init(&rs->cq, RENDER_MAXDRAWS, NULL, NULL)) return f_render_destroy(rs), -1;
+
+	/* The mesh is the only object so far */
+	rs->viewproj = f_mat4_identity();
+	if(f_cullset_init(&rs->cs, RENDER_MAXDRAWS) || f_scene_init(&rs->scene, RENDER_MAXDRAWS)) return f_render_destroy(rs), -1;
+	rs->visible = malloc(sizeof rs->nvisible / sizeof *rs->nvisible * (RENDER_CULLCHUNK + CULL_SLACK) * sizeof *rs->visible);
+	rs->bounds = malloc(RENDER_MAXDRAWS * sizeof *rs->bounds);
+	rs->changed = malloc(RENDER_MAXDRAWS * sizeof *rs->changed);
+	if(!rs->visible || !rs->bounds || !rs->changed) return f_render_destroy(rs), -1;
+
+	const struct t_mat4 id = f_mat4_identity();
+	rs->bounds[f_scene_add(&rs->scene, -1, &id)] = bounds;
+	f_cullset_add(&rs->cs, rs->bounds[0].c, rs->bounds[0].e);
+	return 0;
+}
+
+/* Worker threads for per frame CPU work: RENDER_THREADS, or one per core */
+/* Returns NULL if they can't be started, then the work runs inline on the GL thread */
+struct t_jobsys* f_render_startjobs(struct t_jobsys *js) {
+	const char *env = getenv("RENDER_THREADS");
+	return f_jobs_init(js, env ? atoi(env) : 0) ? NULL : js;
+}
+
+/* Start the worker threads (in js), load the mesh if there is one and create */
+/* the renderer's GL objects on the current context */
+int f_render_setup(struct t_render_state *rs, struct t_jobsys *js, const char *meshpath) {
+	struct t_jobsys *jobs = f_render_startjobs(js);
+
+	struct t_meshbin mb;
+	if(meshpath && f_render_loadmesh(&mb, meshpath, jobs, stdout)) {
+		fprintf(stderr, "Unable to load mesh '%s'\n", meshpath);
+		if(jobs) f_jobs_destroy(jobs);
+		return -1;
+	}
+
+	const int err = f_render_init(rs, meshpath ? &mb : NULL);
+	if(meshpath) f_meshbin_close(&mb);
+	if(err) {
+		if(jobs) f_jobs_destroy(jobs);
+		return -1;
+	}
+	rs->js = jobs;
+	return 0;
+}
+
+/* Also unwinds a partial f_render_init */
+void f_render_destroy(struct t_render_state *rs) {
+	if(rs->js) f_jobs_destroy(rs->js);
+	if(rs->sp) glDeleteProgram(rs->sp);
+	if(rs->VBO) glDeleteBuffers(1, &rs->VBO);
+	if(rs->EBO) glDeleteBuffers(1, &rs->EBO);
+	if(rs->VAO) glDeleteVertexArrays(1, &rs->VAO);
+	f_gputimer_destroy(&rs->gt);
+	f_cmdq_destroy(&rs->cq);
+	f_cullset_destroy(&rs->cs);
+	f_scene_destroy(&rs->scene);
+	free(rs->visible), free(rs->bounds), free(rs->changed);
+	*rs = (struct t_render_state){0};
+}
+
+/* Culling job for chunks [cbegin, cend) of RENDER_CULLCHUNK objects */
+/* Bounding spheres only: they read 4 arrays instead of 6 and need one */
+/* reduction over the planes, a few more objects pass than with boxes */
+void f_render_cull(void *data, unsigned long cbegin, unsigned long cend) {
+	struct t_render_state *rs = data;
+	for(unsigned long c = cbegin; c < cend; ++c) {
+		const unsigned long begin = c * RENDER_CULLCHUNK;
+		const unsigned long end = rs->cs.n - begin > RENDER_CULLCHUNK ? begin + RENDER_CULLCHUNK : rs->cs.n;
+		rs->nvisible[c] = f_cull_spheres_part(&rs->frustum, &rs->cs, begin, end, rs->visible + c * (RENDER_CULLCHUNK + CULL_SLACK));
+	}
+}
+
+/* Draw a single frame into the currently bound framebuffer */
+/* The caller marks the swap pass and ends the GPU timer frame after presenting */
+void f_render_frame(struct t_render_state *rs, struct t_glfw_winstate *wst) {
+	if(wst->szrefresh)
+		glViewport(0, 0, wst->width, wst->height), wst->szrefresh = 0;
+
+	f_gputimer_begin(&rs->gt);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+	f_gputimer_mark(&rs->gt, GPASS_CLEAR);
+
+	/* World bounds follow the objects whose transforms changed */
+	const unsigned long nchanged = f_scene_update(&rs->scene, rs->changed);
+	for(unsigned long i = 0; i < nchanged; ++i) {
+		const uint32_t o = rs->changed[i];
+		const struct t_aabb wb = f_aabb_transform(&rs->scene.world[o], rs->bounds[o]);
+		f_cullset_set(&rs->cs, o, wb.c, wb.e);
+	}
+
+	/* One object so far, so its model matrix can be part of a program uniform */
+	const struct t_mat4 mvp = f_mat4_mul(&rs->viewproj, &rs->scene.world[0]);
+	glProgramUniformMatrix4fv(rs->sp, 2, 1, GL_FALSE, mvp.m);
+
+	/* Only objects intersecting the view frustum are submitted */
+	f_frustum_extract(&rs->frustum, &rs->viewproj);
+	const unsigned long nchunks = (rs->cs.n + RENDER_CULLCHUNK - 1) / RENDER_CULLCHUNK;
+	if(rs->js) f_jobs_parallel_for(rs->js, nchunks, 1, f_render_cull, rs);
+	else f_render_cull(rs, 0, nchunks);
+
+	/* Coarsest level whose error stays under RENDER_LOD_PIXELS at the bounding sphere's near side */
+	const float pxscale = rs->fovy > 0 ? wst->height / (2 * tanf(rs->fovy / 2)) : 0;
+	for(unsigned long c = 0; c * RENDER_CULLCHUNK < rs->cs.n; ++c)
+		for(unsigned long i = 0; i < rs->nvisible[c]; ++i) {
+			const uint32_t o = rs->visible[c * (RENDER_CULLCHUNK + CULL_SLACK) + i];
+			const struct t_vec3 d = f_vec3_sub((struct t_vec3){ rs->cs.cx[o], rs->cs.cy[o], rs->cs.cz[o] }, rs->eye);
+			const struct t_meshlod *lod = &rs->lods[f_mesh_lod_select(rs->lods, rs->nlods,
+				f_vec3_len(d) - rs->cs.r[o], pxscale, RENDER_LOD_PIXELS)];
+
+			const struct t_drawpacket tri = {
+				.sp = rs->sp, .vao = rs->VAO,
+				.mode = GL_TRIANGLES, .count = lod->count, .first = lod->first, .instances = 1,
+				.indexed = 1
+			};
+			f_cmdq_push(&rs->cq, f_cmdkey(0, rs->sp, 0, rs->VAO, 0), &tri);
+		}
+
+	f_cmdq_sort(&rs->cq);
+	f_cmdq_execute(&rs->cq);
+	f_gputimer_mark(&rs->gt, GPASS_DRAW);
+}
+
+/* Map a mesh container (.rmesh), or load an OBJ file and convert it in memory */
+int f_render_loadmesh(struct t_meshbin *mb, const char *path, struct t_jobsys *js, FILE *report) {
+	const size_t len = strlen(path);
+	if(len > 6 && !strcmp(path + len - 6, ".rmesh")) return f_meshbin_open(mb, path);
+
+	struct t_mesh m;
+	if(f_obj_load(&m, path, js)) return -1;
+
+	f_mesh_normal_colors(&m);
+	const int ret = f_render_lods(&m, report) || f_render_optimize(&m, report) || f_meshbin_build(mb, &m, f_render_vformat(&m)) ? -1 : 0;
+	f_mesh_free(&m);
+	return ret;
+}
+
+/* Convert an OBJ file to a mesh container */
+int f_bake_mesh(const char *in, const char *out) {
+	struct t_jobsys js;
+	struct t_jobsys *jobs = f_render_startjobs(&js);
+
+	struct t_meshbin mb;
+	int ret = f_render_loadmesh(&mb, in, jobs, stdout);
+	if(!ret) {
+		ret = f_meshbin_write(&mb, out);
+		f_meshbin_close(&mb);
+	}
+
+	if(jobs) f_jobs_destroy(jobs);
+	if(ret) fprintf(stderr, "Unable to convert '%s' to '%s'\n", in, out);
+	return ret;
+}
@@ -0,0 +1,82 @@
+#ifndef __H__RENDER_H___
+#define __H__RENDER_H___
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "window.h"
+#include "vertex.h"
+#include "gputimer.h"
+#include "cmdqueue.h"
+#include "vecmath.h"
+#include "cull.h"
+#include "scene.h"
+#include "jobs.h"
+#include "mesh.h"
+#include "meshbin.h"
+
+/* Capacity of the per frame draw command queue */
+#define RENDER_MAXDRAWS 4096
+
+/* Objects culled per job */
+#define RENDER_CULLCHUNK 1024
+
+/* Input events buffered between two frames (a power of two) */
+#define RENDER_MAXEVENTS 256
+
+/* Largest projected simplification error, in pixels, for a level of detail to be drawn */
+#define RENDER_LOD_PIXELS 1.0f
+
+/* Main program sources, in the shader directory */
+#define MAIN_VERT "main.vert"
+#define MAIN_FRAG "main.frag"
+
+/* Built in triangle, drawn without a mesh */
+extern struct vert vertices[3];
+
+/* GL objects owned by the renderer */
+struct t_render_state {
+	unsigned int VBO, EBO, VAO, sp;
+	struct t_vquant q;
+	struct t_gputimer gt;
+	struct t_cmdqueue cq;
+
+	/* World to clip transform, and bounds of every object for culling */
+	struct t_mat4 viewproj;
+	struct t_cullset cs;
+
+	/* Levels of detail of the mesh, picked per object from the camera */
+	/* distance and field of view (0 draws full detail) */
+	struct t_meshlod lods[MESH_MAXLODS];
+	unsigned int nlods;
+	struct t_vec3 eye;
+	float fovy;
+	struct t_frustum frustum;
+
+	/* Visible objects, per chunk of RENDER_CULLCHUNK (+ CULL_SLACK entries) */
+	uint32_t *visible;
+	unsigned long nvisible[RENDER_MAXDRAWS / RENDER_CULLCHUNK];
+
+	/* Per frame CPU work fans out to the job system, if there is one */
+	struct t_jobsys *js;
+
+	/* Object transforms, with local bounds kept to refresh the culling set */
+	struct t_scene scene;
+	struct t_aabb *bounds;
+	uint32_t *changed;
+};
+
+void f_render_useprogram(struct t_render_state *);
+void f_mesh_normal_colors(struct t_mesh *);
+int f_render_optimize(struct t_mesh *, FILE *);
+int f_render_lods(struct t_mesh *, FILE *);
+int f_render_init(struct t_render_state *, const struct t_meshbin *);
+struct t_jobsys* f_render_startjobs(struct t_jobsys *);
+int f_render_setup(struct t_render_state *, struct t_jobsys *, const char *);
+void f_render_destroy(struct t_render_state *);
+void f_render_cull(void *, unsigned long, unsigned long);
+void f_render_frame(struct t_render_state *, struct t_glfw_winstate *);
+int f_render_loadmesh(struct t_meshbin *, const char *, struct t_jobsys *, FILE *);
+int f_bake_mesh(const char *, const char *);
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scene.h"
+
+/* References
+ * ----------
+ * S. Lagarde, "Transform hierarchies in data oriented design"
+ * T. Forsyth, "Scene graphs - just say no"
+ * "https://tomforsyth1000.github.io/blog.wiki.html#%5B%5BScene%20Graphs%20-%20just%20say%20no%5D%5D"
+ */
+
+
+int f_scene_init(struct t_scene *s, unsigned long cap) {
+	*s = (struct t_scene){ .cap = cap, .ordered = 1 };
+
+	s->parent = malloc(cap * sizeof *s->parent);
+	s->local = aligned_alloc(16, cap * sizeof *s->local);
+	s->world = aligned_alloc(16, cap * sizeof *s->world);
+	s->end = malloc(cap * sizeof *s->end);
+	s->roots = malloc(cap * sizeof *s->roots);
+	s->dirty = malloc(cap * sizeof *s->dirty);
+	if(!s->parent || !s->local || !s->world || !s->end || !s->roots || !s->dirty) return f_scene_destroy(s), -1;
+
+	return 0;
+}
+
+void f_scene_destroy(struct t_scene *s) {
+	free(s->parent), free(s->local), free(s->world), free(s->end), free(s->roots), free(s->dirty);
+	*s = (struct t_scene){0};
+}
+
+/* Queue a changed node, unless it or one of its ancestors is already queued */
+/* (the subtree of a queued node is recomputed as a whole) */
+static void f_scene_mark(struct t_scene *s, unsigned long i) {
+	for(long a = i; a >= 0; a = s->parent[a]) if(s->dirty[a]) return;
+	s->dirty[i] = 1;
+	s->roots[s->nroots++] = i;
+}
+
+static void f_scene_clear(struct t_scene *s) {
+	for(unsigned long r = 0; r < s->nroots; ++r) s->dirty[s->roots[r]] = 0;
+	s->nroots = 0;
+}
+
+/* Add a node under an existing one (or a root, with parent -1) */
+/* Returns its index, or -1 if the scene is full or the parent is invalid */
+/* Adding under a node whose subtree is not the last one breaks the depth */
+/* first order, updates then scan the whole scene until the next sort */
+long f_scene_add(struct t_scene *s, long parent, const struct t_mat4 *local) {
+	if(s->n >= s->cap || parent >= (long)s->n || parent < -1) return -1;
+
+	const unsigned long i = s->n++;
+	s->parent[i] = parent;
+	s->local[i] = *local;
+	s->end[i] = i + 1;
+	s->dirty[i] = 0;
+
+	for(long a = parent; a >= 0 && s->ordered; a = s->parent[a]) {
+		if(s->end[a] != i) s->ordered = 0;
+		else s->end[a] = i + 1;
+	}
+
+	f_scene_mark(s, i);
+	return i;
+}
+
+/* The world matrices of the node and its subtree are recomputed on the next update */
+void f_scene_setlocal(struct t_scene *s, unsigned long i, const struct t_mat4 *local) {
+	s->local[i] = *local;
+	f_scene_mark(s, i);
+}
+
+/* Reorder nodes depth first, so every subtree is a contiguous range */
+/* remap (optional, n entries) receives the new index of every node */
+int f_scene_sort(struct t_scene *s, uint32_t *remap) {
+	const unsigned long n = s->n;
+	if(!n) return 0;
+
+	/* Children of every node, grouped by parent (counting sort) */
+	uint32_t *first = calloc(n + 1, sizeof *first);
+	uint32_t *child = malloc(n * sizeof *child), *order = malloc(n * sizeof *order), *stack = malloc(n * sizeof *stack);
+	uint32_t *newidx = remap ? remap : malloc(n * sizeof *newidx);
+	int32_t *parent = malloc(n * sizeof *parent);
+	struct t_mat4 *local = aligned_alloc(16, n * sizeof *local);
+	if(!first || !child || !order || !stack || !newidx || !parent || !local) {
+		free(first), free(child), free(order), free(stack), free(parent), free(local);
+		if(!remap) free(newidx);
+		return -1;
+	}
+
+	for(unsigned long i = 0; i < n; ++i) if(s->parent[i] >= 0) first[s->parent[i] + 1]++;
+	for(unsigned long i = 0; i < n; ++i) first[i + 1] += first[i];
+
+	uint32_t *next = order; /* fill cursors, reused before order is built */
+	memcpy(next, first, n * sizeof *next);
+	for(unsigned long i = 0; i < n; ++i) if(s->parent[i] >= 0) child[next[s->parent[i]]++] = i;
+
+	/* Pushed in reverse, so roots and siblings keep their relative order */
+	unsigned long top = 0, tail = 0;
+	for(unsigned long i = n; i-- > 0;) if(s->parent[i] < 0) stack[top++] = i;
+	while(top) {
+		const uint32_t i = stack[--top];
+		order[tail++] = i;
+		for(uint32_t c = first[i + 1]; c-- > first[i];) stack[top++] = child[c];
+	}
+
+	for(unsigned long i = 0; i < n; ++i) newidx[order[i]] = i;
+	for(unsigned long i = 0; i < n; ++i) {
+		const int32_t p = s->parent[order[i]];
+		parent[i] = p < 0 ? -1 : (int32_t)newidx[p];
+		local[i] = s->local[order[i]];
+	}
+
+	memcpy(s->parent, parent, n * sizeof *parent);
+	memcpy(s->local, local, n * sizeof *local);
+
+	/* Children follow their parent, so subtree ends are pushed up in one backward pass */
+	for(unsigned long i = 0; i < n; ++i) s->end[i] = i + 1;
+	for(unsigned long i = n; i-- > 0;)
+		if(s->parent[i] >= 0 && s->end[s->parent[i]] < s->end[i]) s->end[s->parent[i]] = s->end[i];
+	s->ordered = 1;
+
+	/* World matrices are recomputed rather than permuted */
+	memset(s->dirty, 0, n);
+	s->nroots = 0;
+	for(unsigned long i = 0; i < n; ++i) if(s->parent[i] < 0) f_scene_mark(s, i);
+
+	free(first), free(child), free(order), free(stack), free(parent), free(local);
+	if(!remap) free(newidx);
+	return 0;
+}
+
+/* Forward pass from the first queued node, for scenes out of depth first order */
+static unsigned long f_scene_update_scan(struct t_scene *s, uint32_t *changed) {
+	unsigned long start = s->n;
+	for(unsigned long r = 0; r < s->nroots; ++r) if(start > s->roots[r]) start = s->roots[r];
+
+	unsigned long k = 0;
+	for(unsigned long i = start; i < s->n; ++i) {
+		const int32_t p = s->parent[i];
+
+		/* Parents come first, so their flag already includes their own ancestors */
+		if(!s->dirty[i] && (p < 0 || !s->dirty[p])) continue;
+		s->dirty[i] = 1;
+
+		s->world[i] = p < 0 ? s->local[i] : f_mat4_mul(&s->world[p], &s->local[i]);
+		if(changed) changed[k] = i;
+		k++;
+	}
+
+	memset(s->dirty + start, 0, s->n - start);
+	s->nroots = 0;
+	return k;
+}
+
+/* Recompute world matrices of changed nodes and their descendants */
+/* Only the subtrees of queued nodes are visited, so the cost follows the number of changed nodes */
+/* changed (optional, n entries) receives the updated indices, returns their count */
+unsigned long f_scene_update(struct t_scene *s, uint32_t *changed) {
+	if(!s->nroots) return 0;
+	if(!s->ordered) return f_scene_update_scan(s, changed);
+
+	unsigned long k = 0;
+	for(unsigned long r = 0; r < s->nroots; ++r) {
+		const uint32_t root = s->roots[r];
+
+		/* Queued before one of its ancestors, that subtree covers it */
+		int covered = 0;
+		for(int32_t a = s->parent[root]; a >= 0 && !covered; a = s->parent[a]) covered = s->dirty[a];
+		if(covered) continue;
+
+		for(uint32_t i = root; i < s->end[root]; ++i) {
+			const int32_t p = s->parent[i];
+			s->world[i] = p < 0 ? s->local[i] : f_mat4_mul(&s->world[p], &s->local[i]);
+			if(changed) changed[k] = i;
+			k++;
+		}
+	}
+
+	f_scene_clear(s);
+	return k;
+}
+
+/* Recompute every world matrix, regardless of what changed */
+void f_scene_update_all(struct t_scene *s) {
+	for(unsigned long i = 0; i < s->n; ++i) {
+		const int32_t p = s->parent[i];
+		s->world[i] = p < 0 ? s->local[i] : f_mat4_mul(&s->world[p], &s->local[i]);
+	}
+
+	f_scene_clear(s);
+}
@@ -0,0 +1,34 @@
+#ifndef __H__SCENE_H___
+#define __H__SCENE_H___
+
+#include <stdint.h>
+
+#include "vecmath.h"
+
+/* Flat transform hierarchy: parents are always stored before their children, */
+/* so world matrices are computed in a single forward pass */
+/* Local and world matrices live in separate arrays */
+struct t_scene {
+	int32_t *parent;
+	struct t_mat4 *local, *world;
+	unsigned long n, cap;
+
+	/* In depth first order the subtree of node i is the range [i, end[i]) */
+	uint32_t *end;
+	int ordered;
+
+	/* Changed nodes without a changed ancestor, flagged in dirty */
+	uint32_t *roots;
+	unsigned long nroots;
+	uint8_t *dirty;
+};
+
+int f_scene_init(struct t_scene *, unsigned long);
+void f_scene_destroy(struct t_scene *);
+long f_scene_add(struct t_scene *, long, const struct t_mat4 *);
+void f_scene_setlocal(struct t_scene *, unsigned long, const struct t_mat4 *);
+int f_scene_sort(struct t_scene *, uint32_t *);
+unsigned long f_scene_update(struct t_scene *, uint32_t *);
+void f_scene_update_all(struct t_scene *);
+
+#endif
@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200112L
+#include <epoxy/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "shader.h"
+
+/* References
+ * ----------
+ * ARB_get_program_binary
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_get_program_binary.txt"
+ * KHR_parallel_shader_compile
+ * "https://registry.khronos.org/OpenGL/extensions/KHR/KHR_parallel_shader_compile.txt"
+ */
+
+struct t_progcache_stats progcache_stats = {0};
+
+/* Header of a cache file, followed by the program binary */
+struct t_progcache_hdr {
+	char magic[4];
+	uint32_t format, length, pad_;
+	uint64_t key;
+};
+
+static const char progcache_magic[4] = { 'G', 'L', 'P', 'B' };
+
+
+/* FNV-1a, including the terminating null so concatenations can't collide */
+static uint64_t f_fnv1a(uint64_t h, const char *s) {
+	if(!s) s = "";
+	do h = (h ^ (unsigned char)*s) * 0x100000001B3ull; while(*s++);
+	return h;
+}
+
+/* Cache key: the sources and the driver identity, since binaries */
+/* are only valid for the exact driver that produced them */
+uint64_t f_program_key(const char *vs, const char *fs) {
+	uint64_t h = 0xCBF29CE484222325ull;
+	h = f_fnv1a(h, vs);
+	h = f_fnv1a(h, fs);
+	h = f_fnv1a(h, (const char*)glGetString(GL_VENDOR));
+	h = f_fnv1a(h, (const char*)glGetString(GL_RENDERER));
+	h = f_fnv1a(h, (const char*)glGetString(GL_VERSION));
+	return h;
+}
+
+static void f_progcache_path(char *path, size_t sz, uint64_t key) {
+	const char *dir = getenv("RENDER_SHADER_CACHE");
+	snprintf(path, sz, "%s/%016llx.bin", dir ? dir : SHADER_CACHE_DIR, (unsigned long long)key);
+}
+
+/* Try to create a program from a cached binary, returns 0 on a miss or rejection */
+static unsigned int f_progcache_read(uint64_t key) {
+	char path[4096];
+	f_progcache_path(path, sizeof path, key);
+
+	FILE *f = fopen(path, "rb");
+	if(!f) return 0;
+
+	struct t_progcache_hdr hdr;
+	struct stat st;
+	void *bin = NULL;
+	unsigned int sp = 0;
+
+	if(fstat(fileno(f), &st) || fread(&hdr, sizeof hdr, 1, f) != 1 || memcmp(hdr.magic, progcache_magic, 4) || hdr.key != key)
+		goto end;
+
+	/* The length comes from the file, it must fit in what follows the header */
+	if(!hdr.length || hdr.length > (uint64_t)st.st_size - sizeof hdr) goto end;
+	if(!(bin = malloc(hdr.length)) || fread(bin, 1, hdr.length, f) != hdr.length)
+		goto end;
+
+	sp = glCreateProgram();
+	glProgramBinary(sp, hdr.format, bin, hdr.length);
+
+	/* Drivers reject binaries after updates or with different settings */
+	int ok;
+	glGetProgramiv(sp, GL_LINK_STATUS, &ok);
+	if(!ok) glDeleteProgram(sp), sp = 0, atomic_fetch_add(&progcache_stats.rejected, 1);
+
+end:
+	free(bin);
+	fclose(f);
+	return sp;
+}
+
+static void f_progcache_write(uint64_t key, unsigned int sp) {
+	int len = 0;
+	glGetProgramiv(sp, GL_PROGRAM_BINARY_LENGTH, &len);
+	if(len <= 0) return;
+
+	void *bin = malloc(len);
+	if(!bin) return;
+
+	struct t_progcache_hdr hdr = { .key = key };
+	memcpy(hdr.magic, progcache_magic, 4);
+
+	GLenum format;
+	glGetProgramBinary(sp, len, NULL, &format, bin);
+	hdr.format = format, hdr.length = len;
+
+	const char *dir = getenv("RENDER_SHADER_CACHE");
+	if(mkdir(dir ? dir : SHADER_CACHE_DIR, 0755) && errno != EEXIST) {
+		free(bin);
+		return;
+	}
+
+	/* Write to a temporary file first so readers never see partial binaries, */
+	/* named per process and per write so concurrent writers can't clobber it */
+	static atomic_uint seq;
+	char path[4096], tmp[4096 + 32];
+	f_progcache_path(path, sizeof path, key);
+	snprintf(tmp, sizeof tmp, "%s.%d.%u.tmp", path, (int)getpid(), atomic_fetch_add(&seq, 1));
+
+	FILE *f = fopen(tmp, "wb");
+	if(f) {
+		const int ok = fwrite(&hdr, sizeof hdr, 1, f) == 1 && fwrite(bin, 1, len, f) == (size_t)len;
+		if(!fclose(f) && ok && !rename(tmp, path)) atomic_fetch_add(&progcache_stats.stored, 1);
+		else remove(tmp);
+	}
+
+	free(bin);
+}
+
+const char* f_shader_dir(void) {
+	const char *dir = getenv("RENDER_SHADER_DIR");
+	return dir ? dir : SHADER_DIR;
+}
+
+/* Read a shader source file from the shader directory, caller frees */
+char* f_shader_read(const char *name) {
+	char path[4096];
+	snprintf(path, sizeof path, "%s/%s", f_shader_dir(), name);
+
+	FILE *f = fopen(path, "rb");
+	if(!f) return fprintf(stderr, "Unable to open shader '%s'\n", path), NULL;
+
+	char *src = NULL;
+	long len;
+	if(fseek(f, 0, SEEK_END) || (len = ftell(f)) < 0 || fseek(f, 0, SEEK_SET))
+		goto end;
+
+	if((src = malloc(len + 1)) && fread(src, 1, len, f) == (size_t)len)
+		src[len] = 0;
+	else
+		free(src), src = NULL;
+
+end:
+	fclose(f);
+	return src;
+}
+
+/* Whether compiles and links run asynchronously (checked once per process, any */
+/* thread with a context may get there first, they all find the same answer) */
+static atomic_int parallel = -1;
+
+/* Start building every requested program without waiting on any of them */
+/* Cached binaries are restored immediately, everything else is compiled and */
+/* linked from source - status is only queried once the driver reports completion */
+void f_program_begin(struct t_progreq *r, unsigned int n) {
+	if(atomic_load(&parallel) < 0) {
+		const int has = epoxy_has_gl_extension("GL_KHR_parallel_shader_compile");
+		if(has) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		atomic_store(&parallel, has);
+	}
+
+	int nformats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nformats);
+
+	for(unsigned int i = 0; i < n; ++i) {
+		r[i].sp = r[i].vert = r[i].frag = 0, r[i].key = 0;
+		r[i].pending = 0;
+
+		if(nformats && !r[i].nocache) {
+			r[i].key = f_program_key(r[i].vs, r[i].fs);
+			if((r[i].sp = f_progcache_read(r[i].key))) {
+				atomic_fetch_add(&progcache_stats.hits, 1);
+				continue;
+			}
+			atomic_fetch_add(&progcache_stats.misses, 1);
+		}
+
+		r[i].vert = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(r[i].vert, 1, &r[i].vs, NULL);
+		glCompileShader(r[i].vert);
+
+		r[i].frag = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(r[i].frag, 1, &r[i].fs, NULL);
+		glCompileShader(r[i].frag);
+
+		/* Linking right away lets the driver chain it after the compiles */
+		/* The binary is kept retrievable so it can be stored in the cache */
+		r[i].sp = glCreateProgram();
+		glProgramParameteri(r[i].sp, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glAttachShader(r[i].sp, r[i].vert);
+		glAttachShader(r[i].sp, r[i].frag);
+		glLinkProgram(r[i].sp);
+
+		r[i].pending = 1;
+	}
+}
+
+/* Check the result of a finished build, logging and deleting failed programs */
+static void f_program_finish(struct t_progreq *r) {
+	int ok;
+	glGetProgramiv(r->sp, GL_LINK_STATUS, &ok);
+
+	if(!ok) {
+		char log[1024];
+		const unsigned int sh[2] = { r->vert, r->frag };
+
+		for(int i = 0; i < 2; ++i) {
+			int compiled;
+			glGetShaderiv(sh[i], GL_COMPILE_STATUS, &compiled);
+			if(compiled) continue;
+
+			glGetShaderInfoLog(sh[i], sizeof log, NULL, log);
+			fprintf(stderr, "%s shader compilation failed:\n%s\n", i ? "Fragment" : "Vertex", log);
+		}
+
+		glGetProgramInfoLog(r->sp, sizeof log, NULL, log);
+		fprintf(stderr, "Program linking failed:\n%s\n", log);
+		glDeleteProgram(r->sp), r->sp = 0;
+	} else if(r->key) {
+		f_progcache_write(r->key, r->sp);
+	}
+
+	if(r->sp) glDetachShader(r->sp, r->vert), glDetachShader(r->sp, r->frag);
+	glDeleteShader(r->vert), glDeleteShader(r->frag);
+	r->vert = r->frag = 0;
+	r->pending = 0;
+}
+
+/* Finish the builds the driver has completed, returns how many are still pending */
+/* (without parallel compilation every build completes on the first call) */
+unsigned int f_program_poll(struct t_progreq *r, unsigned int n) {
+	unsigned int left = 0;
+
+	for(unsigned int i = 0; i < n; ++i) {
+		if(!r[i].pending) continue;
+
+		int done = 1;
+		if(atomic_load(&parallel) > 0) glGetProgramiv(r[i].sp, GL_COMPLETION_STATUS_KHR, &done);
+
+		if(done) f_program_finish(&r[i]);
+		else left++;
+	}
+
+	return left;
+}
+
+/* Poll until every build is finished, returns the number of failed programs */
+unsigned int f_program_wait(struct t_progreq *r, unsigned int n) {
+	while(f_program_poll(r, n)) sched_yield();
+
+	unsigned int failed = 0;
+	for(unsigned int i = 0; i < n; ++i) failed += !r[i].sp;
+	return failed;
+}
+
+/* Build a single program, through the on-disk binary cache */
+unsigned int f_program_load(const char *vs, const char *fs) {
+	struct t_progreq r = { .vs = vs, .fs = fs };
+	f_program_begin(&r, 1);
+	f_program_wait(&r, 1);
+	return r.sp;
+}
@@ -0,0 +1,39 @@
+#ifndef __H__SHADER_H___
+#define __H__SHADER_H___
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/* Directories used when RENDER_SHADER_CACHE / RENDER_SHADER_DIR are not set */
+#define SHADER_CACHE_DIR ".shadercache"
+#define SHADER_DIR "shaders"
+
+/* Program binary cache statistics (updated from the render and hot reload threads) */
+struct t_progcache_stats {
+	atomic_ulong hits, misses, rejected, stored;
+};
+
+extern struct t_progcache_stats progcache_stats;
+
+/* One program to build - set vs, fs (and nocache to bypass the binary cache), */
+/* sp holds the program once the build is finished, or 0 if it failed */
+struct t_progreq {
+	const char *vs, *fs;
+	unsigned int sp;
+	unsigned char nocache;
+
+	unsigned int vert, frag;
+	uint64_t key;
+	unsigned char pending;
+};
+
+void f_program_begin(struct t_progreq *, unsigned int);
+unsigned int f_program_poll(struct t_progreq *, unsigned int);
+unsigned int f_program_wait(struct t_progreq *, unsigned int);
+unsigned int f_program_load(const char *, const char *);
+uint64_t f_program_key(const char *, const char *);
+
+const char* f_shader_dir(void);
+char* f_shader_read(const char *);
+
+#endif
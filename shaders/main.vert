@@ -0,0 +1,15 @@
+#version 460 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 clr_in;
+
+layout(location = 0) uniform vec3 pos_scale;
+layout(location = 1) uniform vec3 pos_bias;
+layout(location = 2) uniform mat4 mvp;
+
+out vec3 clr;
+
+void main() {
+	gl_Position = mvp * vec4(pos * pos_scale + pos_bias, 1.0f);
+	clr = clr_in;
+}
@@ -0,0 +1,75 @@
+#include <epoxy/gl.h>
+
+#include "stream.h"
+
+/* References
+ * ----------
+ * ARB_buffer_storage
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_buffer_storage.txt"
+ * OpenGL wiki [Buffer Object Streaming]
+ * "https://www.khronos.org/opengl/wiki/Buffer_Object_Streaming"
+ */
+
+#define STREAM_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+/* Allocate immutable storage for all regions and map it once for the buffer lifetime */
+/* (bound to GL_COPY_WRITE_BUFFER so no vertex/index bindings are disturbed) */
+int f_stream_init(struct t_streambuf *sb, size_t regionsz) {
+	/* Keep every region start aligned for any allocation alignment up to 256 */
+	regionsz = (regionsz + 255) & ~(size_t)255;
+	*sb = (struct t_streambuf){ .regionsz = regionsz, .region = STREAM_REGIONS - 1 };
+
+	glGenBuffers(1, &sb->buf);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buf);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, regionsz * STREAM_REGIONS, NULL, STREAM_FLAGS);
+
+	sb->map = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionsz * STREAM_REGIONS, STREAM_FLAGS);
+	if(!sb->map) return glDeleteBuffers(1, &sb->buf), sb->buf = 0, -1;
+
+	return 0;
+}
+
+void f_stream_destroy(struct t_streambuf *sb) {
+	for(int i = 0; i < STREAM_REGIONS; ++i)
+		if(sb->fence[i]) glDeleteSync(sb->fence[i]);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, sb->buf);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glDeleteBuffers(1, &sb->buf);
+
+	*sb = (struct t_streambuf){0};
+}
+
+/* Move to the next region, waiting for the GPU to release it if necessary */
+void f_stream_begin(struct t_streambuf *sb) {
+	sb->region = (sb->region + 1) % STREAM_REGIONS;
+	sb->head = 0;
+
+	GLsync f = sb->fence[sb->region];
+	if(!f) return;
+
+	if(glClientWaitSync(f, 0, 0) == GL_TIMEOUT_EXPIRED) {
+		sb->stalls++;
+		while(glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(f);
+	sb->fence[sb->region] = NULL;
+}
+
+/* Bump-allocate from the current region (align must be a power of two, at most 256) */
+/* Returns the write pointer and stores the offset into the GL buffer, */
+/* or returns NULL if the region is exhausted for this frame */
+void* f_stream_alloc(struct t_streambuf *sb, size_t size, size_t align, size_t *offset) {
+	const size_t start = (sb->head + align - 1) & ~(align - 1);
+	if(start + size > sb->regionsz) return NULL;
+
+	sb->head = start + size;
+	*offset = sb->region * sb->regionsz + start;
+	return sb->map + *offset;
+}
+
+/* Fence the region after the last command reading from it has been issued */
+void f_stream_end(struct t_streambuf *sb) {
+	sb->fence[sb->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,29 @@
+#ifndef __H__STREAM_H___
+#define __H__STREAM_H___
+
+#include <stddef.h>
+
+/* Number of regions in the ring - the CPU may run this many frames ahead */
+#define STREAM_REGIONS 3
+
+/* Persistently mapped buffer for per-frame (streamed) data */
+/* Each frame bump-allocates from one region, guarded by a fence */
+/* so the CPU never overwrites data the GPU may still be reading */
+struct t_streambuf {
+	unsigned int buf;
+	unsigned char *map;
+	size_t regionsz, head;
+	unsigned int region;
+	void *fence[STREAM_REGIONS];
+
+	/* Frames where the region was still in use and the CPU had to wait */
+	unsigned long stalls;
+};
+
+int f_stream_init(struct t_streambuf *, size_t);
+void f_stream_destroy(struct t_streambuf *);
+void f_stream_begin(struct t_streambuf *);
+void* f_stream_alloc(struct t_streambuf *, size_t, size_t, size_t *);
+void f_stream_end(struct t_streambuf *);
+
+#endif
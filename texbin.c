@@ -0,0 +1,196 @@
+#include <epoxy/gl.h>
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "texbin.h"
+
+/* References
+ * ----------
+ * Khronos, KTX File Format Specification 2.0
+ * "https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html"
+ * J. Blinn, "Dirty Pixels" (IEEE CG&A 1989) [Filtering in linear space]
+ * ARB_texture_compression_bptc, EXT_texture_compression_s3tc, ARB_texture_compression_rgtc
+ */
+
+static uint64_t f_texbin_align(uint64_t x) {
+	return (x + TEXBIN_ALIGN - 1) & ~(uint64_t)(TEXBIN_ALIGN - 1);
+}
+
+static uint32_t f_texbin_dim(uint32_t size, uint32_t level) {
+	return size >> level ? size >> level : 1;
+}
+
+/* Check every level is in bounds and sized for its format */
+static int f_texbin_bind(struct t_texbin *tb) {
+	const struct t_texbin_header *h = tb->base;
+	if(tb->size < sizeof *h || memcmp(h->magic, TEXBIN_MAGIC, 4)) return -2;
+	if(h->version != TEXBIN_VERSION) return -3;
+
+	if(h->format >= BCFMT_COUNT || !h->width || !h->height
+	|| h->nlevels == 0 || h->nlevels > TEXBIN_MAXLEVELS) return -4;
+
+	for(uint32_t l = 0; l < h->nlevels; ++l) {
+		const struct t_texlevel *lv = &h->levels[l];
+		if(lv->width != f_texbin_dim(h->width, l) || lv->height != f_texbin_dim(h->height, l)
+		|| lv->size != f_bc_size(h->format, lv->width, lv->height)
+		|| lv->offset % TEXBIN_ALIGN || lv->offset > tb->size || lv->size > tb->size - lv->offset) return -4;
+	}
+
+	tb->h = h;
+	return 0;
+}
+
+/* Box filter one level down in linear space, odd sizes repeat their last row or column */
+static void f_texbin_downsample(float *dst, const float *src, int sw, int sh) {
+	const int dw = sw > 1 ? sw / 2 : 1, dh = sh > 1 ? sh / 2 : 1;
+
+	for(int y = 0; y < dh; ++y)
+		for(int x = 0; x < dw; ++x) {
+			const int x0 = 2 * x < sw ? 2 * x : sw - 1, x1 = 2 * x + 1 < sw ? 2 * x + 1 : sw - 1;
+			const int y0 = 2 * y < sh ? 2 * y : sh - 1, y1 = 2 * y + 1 < sh ? 2 * y + 1 : sh - 1;
+			for(int c = 0; c < 4; ++c)
+				dst[((size_t)y * dw + x) * 4 + c] = 0.25f * (src[((size_t)y0 * sw + x0) * 4 + c] + src[((size_t)y0 * sw + x1) * 4 + c]
+					+ src[((size_t)y1 * sw + x0) * 4 + c] + src[((size_t)y1 * sw + x1) * 4 + c]);
+		}
+}
+
+static float f_srgb_to_linear(float v) {
+	return v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static float f_linear_to_srgb(float v) {
+	return v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1 / 2.4f) - 0.055f;
+}
+
+/* Build the full mip chain of an RGBA8 image and encode every level in memory */
+/* Levels are filtered in linear space when srgb is set (alpha is always linear) */
+int f_texbin_build(struct t_texbin *tb, const unsigned char *rgba, int width, int height, enum e_bcfmt fmt, int srgb, struct t_jobsys *js) {
+	*tb = (struct t_texbin){0};
+	if(width <= 0 || height <= 0 || fmt >= BCFMT_COUNT) return -1;
+
+	uint32_t nlevels = 1;
+	while(nlevels < TEXBIN_MAXLEVELS && ((uint32_t)width | (uint32_t)height) >> nlevels) nlevels++;
+
+	struct t_texlevel levels[TEXBIN_MAXLEVELS];
+	uint64_t off = f_texbin_align(sizeof(struct t_texbin_header));
+	for(uint32_t l = 0; l < nlevels; ++l) {
+		levels[l] = (struct t_texlevel){ off, 0, f_texbin_dim(width, l), f_texbin_dim(height, l) };
+		levels[l].size = f_bc_size(fmt, levels[l].width, levels[l].height);
+		off = f_texbin_align(off + levels[l].size);
+	}
+
+	tb->size = off;
+	tb->base = aligned_alloc(TEXBIN_ALIGN, tb->size);
+	const size_t npx = (size_t)width * height;
+	/* Levels alternate between two buffers, odd ones have at most half the pixels */
+	float *lin[2] = { malloc(npx * 4 * sizeof(float)), malloc((npx / 2 + 1) * 4 * sizeof(float)) };
+	unsigned char *px = malloc((npx / 2 + 1) * 4);
+	if(!tb->base || !lin[0] || !lin[1] || !px) return free(tb->base), free(lin[0]), free(lin[1]), free(px), -1;
+	memset(tb->base, 0, tb->size);
+
+	struct t_texbin_header *h = tb->base;
+	memcpy(h->magic, TEXBIN_MAGIC, 4);
+	h->version = TEXBIN_VERSION;
+	h->format = fmt, h->srgb = srgb;
+	h->width = width, h->height = height;
+	h->nlevels = nlevels;
+	memcpy(h->levels, levels, nlevels * sizeof *levels);
+
+	float tolin[256];
+	for(int i = 0; i < 256; ++i) tolin[i] = srgb ? f_srgb_to_linear(i / 255.0f) : i / 255.0f;
+	for(size_t i = 0; i < npx * 4; ++i) lin[0][i] = i % 4 == 3 ? rgba[i] / 255.0f : tolin[rgba[i]];
+
+	/* Each level is filtered from the previous one, kept in float */
+	f_bc_encode(fmt, (unsigned char*)tb->base + levels[0].offset, rgba, width, height, js);
+	for(uint32_t l = 1; l < nlevels; ++l) {
+		const struct t_texlevel *p = &levels[l - 1], *lv = &levels[l];
+		float *src = lin[(l - 1) & 1], *dst = lin[l & 1];
+		f_texbin_downsample(dst, src, p->width, p->height);
+
+		for(size_t i = 0; i < (size_t)lv->width * lv->height * 4; ++i) {
+			const float v = i % 4 == 3 || !srgb ? dst[i] : f_linear_to_srgb(dst[i]);
+			px[i] = (unsigned char)(v <= 0 ? 0 : v >= 1 ? 255 : v * 255 + 0.5f);
+		}
+		f_bc_encode(fmt, (unsigned char*)tb->base + lv->offset, px, lv->width, lv->height, js);
+	}
+
+	free(lin[0]), free(lin[1]), free(px);
+	return f_texbin_bind(tb);
+}
+
+/* Written to a temporary file and renamed, so readers never see a partial file */
+int f_texbin_write(const struct t_texbin *tb, const char *path) {
+	char tmp[4096];
+	if(snprintf(tmp, sizeof tmp, "%s.%d.tmp", path, (int)getpid()) >= (int)sizeof tmp) return -1;
+
+	FILE *f = fopen(tmp, "wb");
+	if(!f) return -1;
+
+	const int ok = fwrite(tb->base, 1, tb->size, f) == tb->size;
+	if(fclose(f) || !ok || rename(tmp, path)) return remove(tmp), -1;
+	return 0;
+}
+
+/* Map a container file, returns 0, -1 if it can't be mapped, -2 (not a container), */
+/* -3 (other version), -4 (corrupt) */
+int f_texbin_open(struct t_texbin *tb, const char *path) {
+	*tb = (struct t_texbin){0};
+
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return -1;
+
+	struct stat st;
+	if(fstat(fd, &st) || st.st_size <= 0) return close(fd), -1;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) return -1;
+
+	*tb = (struct t_texbin){ .base = map, .size = st.st_size, .mapped = 1 };
+	const int ret = f_texbin_bind(tb);
+	if(ret) f_texbin_close(tb);
+	return ret;
+}
+
+void f_texbin_close(struct t_texbin *tb) {
+	if(tb->mapped) munmap(tb->base, tb->size);
+	else free(tb->base);
+	*tb = (struct t_texbin){0};
+}
+
+/* Compressed internal format of the container's blocks (BC5 has no sRGB variant) */
+unsigned int f_texbin_glformat(const struct t_texbin *tb) {
+	const int srgb = tb->h->srgb;
+	switch((enum e_bcfmt)tb->h->format) {
+	case BCFMT_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BCFMT_BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BCFMT_BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BCFMT_BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case BCFMT_COUNT: break;
+	}
+	return 0;
+}
+
+/* Create an immutable texture and upload every level straight from the container */
+/* The container can be closed afterwards */
+unsigned int f_texbin_upload(const struct t_texbin *tb) {
+	const struct t_texbin_header *h = tb->h;
+	const unsigned int fmt = f_texbin_glformat(tb);
+
+	unsigned int tex;
+	glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+	glTextureStorage2D(tex, h->nlevels, fmt, h->width, h->height);
+	for(uint32_t l = 0; l < h->nlevels; ++l) {
+		const struct t_texlevel *lv = &h->levels[l];
+		glCompressedTextureSubImage2D(tex, l, 0, 0, lv->width, lv->height, fmt, lv->size, (const char*)tb->base + lv->offset);
+	}
+	glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	return tex;
+}
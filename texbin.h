@@ -0,0 +1,51 @@
+#ifndef __H__TEXBIN_H___
+#define __H__TEXBIN_H___
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bcenc.h"
+#include "jobs.h"
+
+#define TEXBIN_MAGIC "RTEX"
+#define TEXBIN_VERSION 1
+#define TEXBIN_MAXLEVELS 16
+
+/* Levels start on this boundary within the file */
+#define TEXBIN_ALIGN 64
+
+/* One mip level of compressed blocks */
+struct t_texlevel {
+	uint64_t offset, size;
+	uint32_t width, height;
+};
+
+/* File header, little endian - levels follow from the largest, */
+/* in the block layout GL expects for the format */
+struct t_texbin_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t format, srgb;
+	uint32_t width, height;
+	uint32_t nlevels, pad_;
+
+	struct t_texlevel levels[TEXBIN_MAXLEVELS];
+} __attribute__((aligned(TEXBIN_ALIGN)));
+
+/* A mapped (or built in memory) container */
+struct t_texbin {
+	void *base;
+	size_t size;
+	unsigned char mapped:1;
+
+	const struct t_texbin_header *h;
+};
+
+int f_texbin_build(struct t_texbin *, const unsigned char *, int, int, enum e_bcfmt, int, struct t_jobsys *);
+int f_texbin_write(const struct t_texbin *, const char *);
+int f_texbin_open(struct t_texbin *, const char *);
+void f_texbin_close(struct t_texbin *);
+unsigned int f_texbin_glformat(const struct t_texbin *);
+unsigned int f_texbin_upload(const struct t_texbin *);
+
+#endif
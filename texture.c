@@ -0,0 +1,328 @@
+#include <epoxy/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "texture.h"
+#include "jobs.h"
+
+/* References
+ * ----------
+ * OpenGL wiki [Pixel Buffer Object]
+ * "https://www.khronos.org/opengl/wiki/Pixel_Buffer_Object"
+ * ARB_buffer_storage
+ * "https://registry.khronos.org/OpenGL/extensions/ARB/ARB_buffer_storage.txt"
+ * Truevision TGA File Format Specification, version 2.0
+ */
+
+#define TEXLOAD_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+
+/* --------------------------------- *
+ * Uncompressed image files, by rows *
+ * --------------------------------- */
+
+/* Binary PPM (P6), or uncompressed true color / grayscale TGA */
+/* TGA stores BGR(A), and the bottom row first unless its descriptor says otherwise */
+struct t_texfile {
+	FILE *f;
+	int width, height, channels;
+	unsigned char bgr:1;
+	unsigned char flipped:1;
+};
+
+static int f_texfile_open(struct t_texfile *tf, const char *path) {
+	*tf = (struct t_texfile){ .f = fopen(path, "rb") };
+	if(!tf->f) return -1;
+
+	const size_t len = strlen(path);
+	if(len > 4 && !strcmp(path + len - 4, ".tga")) {
+		unsigned char h[18];
+		if(fread(h, 1, sizeof h, tf->f) != sizeof h || h[1] || fseek(tf->f, h[0], SEEK_CUR)) goto fail;
+
+		tf->width = h[12] | h[13] << 8, tf->height = h[14] | h[15] << 8;
+		tf->channels = h[16] / 8, tf->bgr = 1, tf->flipped = !(h[17] & 0x20);
+		if(!(h[2] == 2 && (h[16] == 24 || h[16] == 32)) && !(h[2] == 3 && h[16] == 8)) goto fail;
+		if(h[17] & 0x10) goto fail;
+	} else {
+		int maxval;
+		if(fscanf(tf->f, "P6 %d %d %d", &tf->width, &tf->height, &maxval) != 3 || maxval != 255 || fgetc(tf->f) == EOF)
+			goto fail;
+		tf->channels = 3;
+	}
+
+	if(tf->width > 0 && tf->height > 0) return 0;
+
+fail:
+	fclose(tf->f);
+	tf->f = NULL;
+	return -2;
+}
+
+/* Decode the next rows as RGBA8 into dst, through a row buffer (dst may be write combined) */
+/* Rows are stored top down whatever the file order, so flipped files fill dst backwards */
+static int f_texfile_rows(struct t_texfile *tf, unsigned char *row, unsigned char *dst, unsigned int rows) {
+	const size_t in = (size_t)tf->width * tf->channels, out = (size_t)tf->width * 4;
+
+	for(unsigned int r = 0; r < rows; ++r) {
+		if(fread(row, 1, in, tf->f) != in) return -1;
+
+		uint32_t *px = (uint32_t*)(dst + (tf->flipped ? rows - 1 - r : r) * out);
+		const unsigned char *s = row;
+		const int red = tf->bgr ? 2 : 0;
+		for(int x = 0; x < tf->width; ++x, s += tf->channels) {
+			const unsigned char rgba[4] = {
+				s[tf->channels > 1 ? red : 0], s[tf->channels > 1 ? 1 : 0], s[tf->channels > 1 ? 2 - red : 0],
+				tf->channels == 4 ? s[3] : 0xFF
+			};
+			memcpy(&px[x], rgba, sizeof rgba);
+		}
+	}
+	return 0;
+}
+
+
+/* Decode a whole PPM or TGA file as RGBA8, top row first */
+unsigned char* f_image_read(const char *path, int *width, int *height) {
+	struct t_texfile tf;
+	if(f_texfile_open(&tf, path)) return NULL;
+
+	unsigned char *row = malloc((size_t)tf.width * tf.channels);
+	unsigned char *px = malloc((size_t)tf.width * tf.height * 4);
+	if(!row || !px || f_texfile_rows(&tf, row, px, tf.height)) free(px), px = NULL;
+
+	*width = tf.width, *height = tf.height;
+	free(row);
+	fclose(tf.f);
+	return px;
+}
+
+
+/* -------------- *
+ * Decode threads *
+ * -------------- */
+
+/* Take the next request and decode it a strip at a time into free slots, */
+/* waiting for the GL thread to release one when the ring is full */
+static void* f_texload_thread(void *data) {
+	struct t_texloader *tl = data;
+	unsigned char *row = NULL;
+	size_t rowsz = 0;
+
+	pthread_mutex_lock(&tl->lock);
+	while(!tl->quit) {
+		if(tl->next == tl->nreqs) {
+			pthread_cond_wait(&tl->cond, &tl->lock);
+			continue;
+		}
+
+		const unsigned int r = tl->next++;
+		struct t_texreq *req = &tl->reqs[r];
+		req->state = TEX_LOADING;
+		pthread_mutex_unlock(&tl->lock);
+
+		/* A single row must fit in a slot */
+		struct t_texfile tf;
+		int ok = !f_texfile_open(&tf, req->path) && (size_t)tf.width * 4 <= TEXLOAD_SLOTSIZE;
+		if(ok && rowsz < (size_t)tf.width * tf.channels) {
+			free(row);
+			rowsz = (size_t)tf.width * tf.channels;
+			ok = (row = malloc(rowsz)) != NULL;
+			if(!ok) rowsz = 0;
+		}
+		/* Strips no larger than the budget, so they can be uploaded one per frame */
+		const size_t strip = tl->budget < TEXLOAD_SLOTSIZE ? tl->budget : TEXLOAD_SLOTSIZE;
+		const unsigned int perslot = ok ? (strip > (size_t)tf.width * 4 ? strip / ((size_t)tf.width * 4) : 1) : 0;
+
+		pthread_mutex_lock(&tl->lock);
+		if(ok) req->width = tf.width, req->height = tf.height;
+
+		for(int y = 0; ok && y < tf.height && !tl->quit; ) {
+			int s = 0;
+			while(s < TEXLOAD_SLOTS && tl->slots[s].state != SLOT_FREE) s++;
+			if(s == TEXLOAD_SLOTS) {
+				tl->stalls++;
+				pthread_cond_wait(&tl->cond, &tl->lock);
+				continue;
+			}
+
+			struct t_texslot *slot = &tl->slots[s];
+			slot->state = SLOT_FILLING;
+			pthread_mutex_unlock(&tl->lock);
+
+			const unsigned int rows = tf.height - y < (int)perslot ? (unsigned int)(tf.height - y) : perslot;
+			ok = !f_texfile_rows(&tf, row, tl->map + (size_t)s * TEXLOAD_SLOTSIZE, rows);
+
+			pthread_mutex_lock(&tl->lock);
+			if(ok) *slot = (struct t_texslot){ r, tf.flipped ? tf.height - y - rows : (unsigned int)y, rows, NULL, SLOT_FILLED };
+			else slot->state = SLOT_FREE, pthread_cond_broadcast(&tl->cond);
+			y += rows;
+		}
+
+		if(!ok) req->state = TEX_FAILED;
+		if(tf.f) fclose(tf.f);
+	}
+	pthread_mutex_unlock(&tl->lock);
+
+	free(row);
+	return NULL;
+}
+
+
+/* --- *
+ * API *
+ * --- */
+
+/* Start nthreads decoders (0 for one per core) and map the unpack ring */
+/* budget limits the bytes uploaded per frame (0 for TEXLOAD_BUDGET) */
+int f_texload_init(struct t_texloader *tl, unsigned int nthreads, size_t budget) {
+	if(!nthreads) nthreads = f_jobs_cores();
+	if(nthreads > TEXLOAD_MAXTHREADS) nthreads = TEXLOAD_MAXTHREADS;
+
+	memset(tl, 0, sizeof *tl);
+	tl->budget = budget ? budget : TEXLOAD_BUDGET;
+
+	glCreateBuffers(1, &tl->pbo);
+	glNamedBufferStorage(tl->pbo, (size_t)TEXLOAD_SLOTS * TEXLOAD_SLOTSIZE, NULL, TEXLOAD_FLAGS);
+	tl->map = glMapNamedBufferRange(tl->pbo, 0, (size_t)TEXLOAD_SLOTS * TEXLOAD_SLOTSIZE, TEXLOAD_FLAGS);
+	if(!tl->map) return glDeleteBuffers(1, &tl->pbo), tl->pbo = 0, -1;
+
+	pthread_mutex_init(&tl->lock, NULL);
+	pthread_cond_init(&tl->cond, NULL);
+
+	for(; tl->nthreads < nthreads; tl->nthreads++)
+		if(pthread_create(&tl->threads[tl->nthreads], NULL, f_texload_thread, tl))
+			return f_texload_destroy(tl), -2;
+
+	return 0;
+}
+
+/* Stops the decoders, and deletes the ring and every texture loaded */
+void f_texload_destroy(struct t_texloader *tl) {
+	if(!tl->pbo) return;
+
+	pthread_mutex_lock(&tl->lock);
+	tl->quit = 1;
+	pthread_cond_broadcast(&tl->cond);
+	pthread_mutex_unlock(&tl->lock);
+	for(unsigned int i = 0; i < tl->nthreads; ++i) pthread_join(tl->threads[i], NULL);
+
+	for(int s = 0; s < TEXLOAD_SLOTS; ++s)
+		if(tl->slots[s].fence) {
+			glClientWaitSync(tl->slots[s].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(tl->slots[s].fence);
+		}
+	for(unsigned int i = 0; i < tl->nreqs; ++i)
+		if(tl->reqs[i].tex) glDeleteTextures(1, &tl->reqs[i].tex);
+
+	glUnmapNamedBuffer(tl->pbo);
+	glDeleteBuffers(1, &tl->pbo);
+	pthread_mutex_destroy(&tl->lock);
+	pthread_cond_destroy(&tl->cond);
+	tl->pbo = 0, tl->map = NULL;
+}
+
+/* Queue a texture for loading, sampled as sRGB (color) or linear (data), */
+/* returns its id or -1 */
+int f_texload_request(struct t_texloader *tl, const char *path, int srgb) {
+	if(strlen(path) >= TEXLOAD_PATHLEN) return -1;
+
+	pthread_mutex_lock(&tl->lock);
+	const int id = tl->nreqs < TEXLOAD_MAXTEX ? (int)tl->nreqs : -1;
+	if(id >= 0) {
+		tl->reqs[id] = (struct t_texreq){ .state = TEX_QUEUED, .srgb = srgb != 0 };
+		strcpy(tl->reqs[id].path, path);
+		tl->nreqs++;
+		pthread_cond_broadcast(&tl->cond);
+	}
+	pthread_mutex_unlock(&tl->lock);
+	return id;
+}
+
+/* Once per frame on the GL thread: release slots the GPU is done with, and upload */
+/* filled ones while within the budget (at least one, so large strips still progress) */
+/* Textures get their storage with the first strip, and mipmaps with the last */
+/* Returns the number of bytes uploaded */
+size_t f_texload_update(struct t_texloader *tl) {
+	unsigned int up[TEXLOAD_SLOTS], n = 0;
+	size_t bytes = 0;
+	int freed = 0;
+
+	pthread_mutex_lock(&tl->lock);
+	for(int s = 0; s < TEXLOAD_SLOTS; ++s) {
+		struct t_texslot *slot = &tl->slots[s];
+
+		if(slot->state == SLOT_INFLIGHT && glClientWaitSync(slot->fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+			glDeleteSync(slot->fence);
+			slot->fence = NULL, slot->state = SLOT_FREE, freed = 1;
+		}
+		if(slot->state != SLOT_FILLED) continue;
+
+		const struct t_texreq *req = &tl->reqs[slot->req];
+		const size_t sz = (size_t)req->width * 4 * slot->rows;
+		if(req->state == TEX_FAILED) slot->state = SLOT_FREE, freed = 1;
+		else if(!bytes || bytes + sz <= tl->budget) up[n++] = s, bytes += sz;
+	}
+	if(freed) pthread_cond_broadcast(&tl->cond);
+	pthread_mutex_unlock(&tl->lock);
+
+	if(!n) return 0;
+
+	/* Filled slots and their requests' sizes only change once released again */
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, tl->pbo);
+	for(unsigned int i = 0; i < n; ++i) {
+		struct t_texslot *slot = &tl->slots[up[i]];
+		struct t_texreq *req = &tl->reqs[slot->req];
+
+		if(!req->tex) {
+			int levels = 1;
+			while((req->width | req->height) >> levels) levels++;
+
+			glCreateTextures(GL_TEXTURE_2D, 1, &req->tex);
+			glTextureStorage2D(req->tex, levels, req->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, req->width, req->height);
+			glTextureParameteri(req->tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+
+		glTextureSubImage2D(req->tex, 0, 0, slot->y, req->width, slot->rows, GL_RGBA, GL_UNSIGNED_BYTE,
+			(void*)((uintptr_t)up[i] * TEXLOAD_SLOTSIZE));
+		slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		req->rowsdone += slot->rows;
+		if(req->rowsdone == (unsigned int)req->height) glGenerateTextureMipmap(req->tex);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	pthread_mutex_lock(&tl->lock);
+	for(unsigned int i = 0; i < n; ++i) {
+		struct t_texslot *slot = &tl->slots[up[i]];
+		struct t_texreq *req = &tl->reqs[slot->req];
+
+		slot->state = SLOT_INFLIGHT;
+		if(req->rowsdone == (unsigned int)req->height) req->state = TEX_READY;
+	}
+	pthread_mutex_unlock(&tl->lock);
+
+	tl->uploaded += bytes;
+	return bytes;
+}
+
+/* GL texture of a request, 0 until it is completely uploaded */
+unsigned int f_texload_texture(struct t_texloader *tl, int id) {
+	pthread_mutex_lock(&tl->lock);
+	const unsigned int tex = id >= 0 && (unsigned int)id < tl->nreqs && tl->reqs[id].state == TEX_READY ? tl->reqs[id].tex : 0;
+	pthread_mutex_unlock(&tl->lock);
+	return tex;
+}
+
+/* Requests neither uploaded nor failed yet */
+unsigned int f_texload_pending(struct t_texloader *tl) {
+	unsigned int n = 0;
+
+	pthread_mutex_lock(&tl->lock);
+	for(unsigned int i = 0; i < tl->nreqs; ++i)
+		n += tl->reqs[i].state == TEX_QUEUED || tl->reqs[i].state == TEX_LOADING;
+	pthread_mutex_unlock(&tl->lock);
+	return n;
+}
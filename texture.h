@@ -0,0 +1,69 @@
+#ifndef __H__TEXTURE_H___
+#define __H__TEXTURE_H___
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define TEXLOAD_MAXTEX 1024
+#define TEXLOAD_MAXTHREADS 16
+#define TEXLOAD_PATHLEN 256
+
+/* Pixel unpack ring: a decoder fills one slot with a strip of rows at a time */
+#define TEXLOAD_SLOTS 8
+#define TEXLOAD_SLOTSIZE (4 << 20)
+
+/* Bytes uploaded per frame when no budget is given */
+#define TEXLOAD_BUDGET (8 << 20)
+
+enum e_texstate { TEX_QUEUED, TEX_LOADING, TEX_READY, TEX_FAILED };
+enum e_slotstate { SLOT_FREE, SLOT_FILLING, SLOT_FILLED, SLOT_INFLIGHT };
+
+/* A requested texture - size is known once a decoder has read the header */
+struct t_texreq {
+	char path[TEXLOAD_PATHLEN];
+	int width, height;
+	unsigned int tex, rowsdone;
+	enum e_texstate state;
+
+	/* Color textures are stored as sRGB, data (normal maps, masks) as linear */
+	unsigned char srgb;
+};
+
+/* Rows [y, y + rows) of a texture, tightly packed RGBA8 at the slot's offset */
+/* in the ring - in flight slots are released when their fence signals */
+struct t_texslot {
+	unsigned int req, y, rows;
+	void *fence;
+	enum e_slotstate state;
+};
+
+/* Textures decoded by a pool of threads straight into a persistently mapped ring */
+/* of pixel unpack buffer slots, and uploaded from it by the GL thread under a */
+/* per frame byte budget - requests, slots and their states share one lock */
+struct t_texloader {
+	struct t_texreq reqs[TEXLOAD_MAXTEX];
+	unsigned int nreqs, next;
+
+	unsigned int pbo;
+	unsigned char *map;
+	struct t_texslot slots[TEXLOAD_SLOTS];
+
+	size_t budget;
+	unsigned long uploaded, stalls;
+
+	pthread_t threads[TEXLOAD_MAXTHREADS];
+	unsigned int nthreads;
+	unsigned char quit:1;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+unsigned char* f_image_read(const char *, int *, int *);
+int f_texload_init(struct t_texloader *, unsigned int, size_t);
+void f_texload_destroy(struct t_texloader *);
+int f_texload_request(struct t_texloader *, const char *, int);
+size_t f_texload_update(struct t_texloader *);
+unsigned int f_texload_texture(struct t_texloader *, int);
+unsigned int f_texload_pending(struct t_texloader *);
+
+#endif
@@ -0,0 +1,433 @@
+#include <math.h>
+#include <pthread.h>
+
+#include "vecmath.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define VM_X86 1
+#endif
+
+#ifdef __SSE__
+	#define VM_SSE 1
+#endif
+
+/* References
+ * ----------
+ * Intel Intrinsics Guide
+ * "https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html"
+ * K. Shoemake, "Animating rotation with quaternion curves" (SIGGRAPH 1985)
+ */
+
+
+/* ------- *
+ * Vectors *
+ * ------- */
+
+struct t_vec3 f_vec3_add(struct t_vec3 a, struct t_vec3 b) {
+	return (struct t_vec3){ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+struct t_vec3 f_vec3_sub(struct t_vec3 a, struct t_vec3 b) {
+	return (struct t_vec3){ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+struct t_vec3 f_vec3_scale(struct t_vec3 a, float s) {
+	return (struct t_vec3){ a.x * s, a.y * s, a.z * s };
+}
+
+float f_vec3_dot(struct t_vec3 a, struct t_vec3 b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+struct t_vec3 f_vec3_cross(struct t_vec3 a, struct t_vec3 b) {
+	return (struct t_vec3){ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float f_vec3_len(struct t_vec3 a) {
+	return sqrtf(f_vec3_dot(a, a));
+}
+
+/* Zero vectors are returned unchanged */
+struct t_vec3 f_vec3_norm(struct t_vec3 a) {
+	const float l = f_vec3_len(a);
+	return l > 0 ? f_vec3_scale(a, 1 / l) : a;
+}
+
+#ifdef VM_SSE
+/* Sum of the four lanes, in every lane */
+static inline __m128 f_vm_hsum(__m128 v) {
+	v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+/* vec4 and quaternions fill an SSE register, vec3 stays scalar (12 bytes, unaligned) */
+struct t_vec4 f_vec4_add(struct t_vec4 a, struct t_vec4 b) {
+#ifdef VM_SSE
+	struct t_vec4 r;
+	_mm_store_ps(&r.x, _mm_add_ps(_mm_load_ps(&a.x), _mm_load_ps(&b.x)));
+	return r;
+#else
+	return (struct t_vec4){ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+#endif
+}
+
+struct t_vec4 f_vec4_scale(struct t_vec4 a, float s) {
+#ifdef VM_SSE
+	struct t_vec4 r;
+	_mm_store_ps(&r.x, _mm_mul_ps(_mm_load_ps(&a.x), _mm_set1_ps(s)));
+	return r;
+#else
+	return (struct t_vec4){ a.x * s, a.y * s, a.z * s, a.w * s };
+#endif
+}
+
+float f_vec4_dot(struct t_vec4 a, struct t_vec4 b) {
+#ifdef VM_SSE
+	return _mm_cvtss_f32(f_vm_hsum(_mm_mul_ps(_mm_load_ps(&a.x), _mm_load_ps(&b.x))));
+#else
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+#endif
+}
+
+
+/* -------- *
+ * Matrices *
+ * -------- */
+
+struct t_mat4 f_mat4_identity(void) {
+	return (struct t_mat4){{ 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 }};
+}
+
+struct t_mat4 f_mat4_mul_ref(const struct t_mat4 *a, const struct t_mat4 *b) {
+	struct t_mat4 r;
+	for(int c = 0; c < 4; ++c)
+		for(int i = 0; i < 4; ++i)
+			r.m[c*4 + i] = a->m[i] * b->m[c*4] + a->m[4 + i] * b->m[c*4 + 1]
+				+ a->m[8 + i] * b->m[c*4 + 2] + a->m[12 + i] * b->m[c*4 + 3];
+	return r;
+}
+
+/* a * b: every column of the result is a linear combination of the columns of a */
+struct t_mat4 f_mat4_mul(const struct t_mat4 *a, const struct t_mat4 *b) {
+#ifdef VM_SSE
+	struct t_mat4 r;
+	const __m128 a0 = _mm_load_ps(a->m), a1 = _mm_load_ps(a->m + 4);
+	const __m128 a2 = _mm_load_ps(a->m + 8), a3 = _mm_load_ps(a->m + 12);
+
+	for(int c = 0; c < 4; ++c) {
+		__m128 v = _mm_mul_ps(a0, _mm_set1_ps(b->m[c*4]));
+		v = _mm_add_ps(v, _mm_mul_ps(a1, _mm_set1_ps(b->m[c*4 + 1])));
+		v = _mm_add_ps(v, _mm_mul_ps(a2, _mm_set1_ps(b->m[c*4 + 2])));
+		v = _mm_add_ps(v, _mm_mul_ps(a3, _mm_set1_ps(b->m[c*4 + 3])));
+		_mm_store_ps(r.m + c*4, v);
+	}
+	return r;
+#else
+	return f_mat4_mul_ref(a, b);
+#endif
+}
+
+struct t_vec4 f_mat4_mulv(const struct t_mat4 *a, struct t_vec4 v) {
+#ifdef VM_SSE
+	__m128 r = _mm_mul_ps(_mm_load_ps(a->m), _mm_set1_ps(v.x));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(a->m + 4), _mm_set1_ps(v.y)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(a->m + 8), _mm_set1_ps(v.z)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(a->m + 12), _mm_set1_ps(v.w)));
+
+	struct t_vec4 o;
+	_mm_store_ps(&o.x, r);
+	return o;
+#else
+	const float *m = a->m;
+	return (struct t_vec4){
+		m[0]*v.x + m[4]*v.y + m[8]*v.z + m[12]*v.w,
+		m[1]*v.x + m[5]*v.y + m[9]*v.z + m[13]*v.w,
+		m[2]*v.x + m[6]*v.y + m[10]*v.z + m[14]*v.w,
+		m[3]*v.x + m[7]*v.y + m[11]*v.z + m[15]*v.w,
+	};
+#endif
+}
+
+struct t_mat4 f_mat4_transpose(const struct t_mat4 *a) {
+	struct t_mat4 r;
+	for(int c = 0; c < 4; ++c)
+		for(int i = 0; i < 4; ++i)
+			r.m[i*4 + c] = a->m[c*4 + i];
+	return r;
+}
+
+/* General inverse by cofactor expansion - singular matrices give the identity */
+struct t_mat4 f_mat4_inverse(const struct t_mat4 *a) {
+	const float *m = a->m;
+	struct t_mat4 r;
+	float *o = r.m;
+
+	o[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+	o[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+	o[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+	o[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+	o[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+	o[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+	o[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+	o[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+	o[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+	o[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+	o[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+	o[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+	o[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+	o[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+	o[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+	o[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+
+	const float det = m[0]*o[0] + m[1]*o[4] + m[2]*o[8] + m[3]*o[12];
+	if(det == 0) return f_mat4_identity();
+
+	for(int i = 0; i < 16; ++i) o[i] /= det;
+	return r;
+}
+
+struct t_mat4 f_mat4_translate(struct t_vec3 t) {
+	struct t_mat4 r = f_mat4_identity();
+	r.m[12] = t.x, r.m[13] = t.y, r.m[14] = t.z;
+	return r;
+}
+
+struct t_mat4 f_mat4_scale(struct t_vec3 s) {
+	struct t_mat4 r = f_mat4_identity();
+	r.m[0] = s.x, r.m[5] = s.y, r.m[10] = s.z;
+	return r;
+}
+
+/* translate * rotate * scale, built directly */
+struct t_mat4 f_mat4_trs(struct t_vec3 t, struct t_quat q, struct t_vec3 s) {
+	struct t_mat4 r = f_quat_mat4(q);
+	for(int i = 0; i < 3; ++i)
+		r.m[i] *= s.x, r.m[4 + i] *= s.y, r.m[8 + i] *= s.z;
+	r.m[12] = t.x, r.m[13] = t.y, r.m[14] = t.z;
+	return r;
+}
+
+/* Right handed, clip space z in [-1, 1] (glm/gluPerspective convention) */
+/* fovy in radians */
+struct t_mat4 f_mat4_perspective(float fovy, float aspect, float near, float far) {
+	const float f = 1 / tanf(fovy / 2);
+	struct t_mat4 r = {{0}};
+	r.m[0] = f / aspect;
+	r.m[5] = f;
+	r.m[10] = (far + near) / (near - far);
+	r.m[11] = -1;
+	r.m[14] = 2 * far * near / (near - far);
+	return r;
+}
+
+struct t_mat4 f_mat4_lookat(struct t_vec3 eye, struct t_vec3 target, struct t_vec3 up) {
+	const struct t_vec3 f = f_vec3_norm(f_vec3_sub(target, eye));
+	const struct t_vec3 s = f_vec3_norm(f_vec3_cross(f, up));
+	const struct t_vec3 u = f_vec3_cross(s, f);
+
+	return (struct t_mat4){{
+		s.x, u.x, -f.x, 0,
+		s.y, u.y, -f.y, 0,
+		s.z, u.z, -f.z, 0,
+		-f_vec3_dot(s, eye), -f_vec3_dot(u, eye), f_vec3_dot(f, eye), 1
+	}};
+}
+
+
+/* ----------- *
+ * Quaternions *
+ * ----------- */
+
+struct t_quat f_quat_identity(void) {
+	return (struct t_quat){ 0, 0, 0, 1 };
+}
+
+/* Rotation by angle (radians) around an axis (need not be normalized) */
+struct t_quat f_quat_axisangle(struct t_vec3 axis, float angle) {
+	const struct t_vec3 a = f_vec3_scale(f_vec3_norm(axis), sinf(angle / 2));
+	return (struct t_quat){ a.x, a.y, a.z, cosf(angle / 2) };
+}
+
+/* a * b: rotates by b first, then by a */
+/* (SSE: a.w * b plus a.x, a.y, a.z times sign flipped permutations of b) */
+struct t_quat f_quat_mul(struct t_quat a, struct t_quat b) {
+#ifdef VM_SSE
+	const __m128 vb = _mm_load_ps(&b.x);
+	const __m128 bx = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(0, 1, 2, 3)), _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+	const __m128 by = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f));
+	const __m128 bz = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+
+	__m128 r = _mm_mul_ps(_mm_set1_ps(a.w), vb);
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.x), bx));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.y), by));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.z), bz));
+
+	struct t_quat q;
+	_mm_store_ps(&q.x, r);
+	return q;
+#else
+	return (struct t_quat){
+		a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+		a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+		a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w,
+		a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+	};
+#endif
+}
+
+struct t_quat f_quat_norm(struct t_quat q) {
+#ifdef VM_SSE
+	const __m128 v = _mm_load_ps(&q.x);
+	const __m128 l2 = f_vm_hsum(_mm_mul_ps(v, v));
+	if(!(_mm_cvtss_f32(l2) > 0)) return f_quat_identity();
+
+	struct t_quat r;
+	_mm_store_ps(&r.x, _mm_div_ps(v, _mm_sqrt_ps(l2)));
+	return r;
+#else
+	const float l = sqrtf(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w);
+	return l > 0 ? (struct t_quat){ q.x / l, q.y / l, q.z / l, q.w / l } : f_quat_identity();
+#endif
+}
+
+/* Spherical interpolation along the shorter arc, normalized lerp when nearly parallel */
+struct t_quat f_quat_slerp(struct t_quat a, struct t_quat b, float t) {
+	float d = a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
+	if(d < 0) d = -d, b = (struct t_quat){ -b.x, -b.y, -b.z, -b.w };
+
+	float wa = 1 - t, wb = t;
+	if(d < 0.9995f) {
+		const float th = acosf(d), s = sinf(th);
+		wa = sinf(wa * th) / s, wb = sinf(wb * th) / s;
+	}
+
+	return f_quat_norm((struct t_quat){
+		wa*a.x + wb*b.x, wa*a.y + wb*b.y, wa*a.z + wb*b.z, wa*a.w + wb*b.w
+	});
+}
+
+/* v + 2w(q x v) + 2 q x (q x v), for a unit quaternion */
+struct t_vec3 f_quat_rotate(struct t_quat q, struct t_vec3 v) {
+	const struct t_vec3 u = { q.x, q.y, q.z };
+	const struct t_vec3 t = f_vec3_scale(f_vec3_cross(u, v), 2);
+	return f_vec3_add(f_vec3_add(v, f_vec3_scale(t, q.w)), f_vec3_cross(u, t));
+}
+
+struct t_mat4 f_quat_mat4(struct t_quat q) {
+	const float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+	const float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+	const float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+
+	return (struct t_mat4){{
+		1 - 2*(yy + zz), 2*(xy + wz), 2*(xz - wy), 0,
+		2*(xy - wz), 1 - 2*(xx + zz), 2*(yz + wx), 0,
+		2*(xz + wy), 2*(yz - wx), 1 - 2*(xx + yy), 0,
+		0, 0, 0, 1
+	}};
+}
+
+
+/* ------------------ *
+ * Batched transforms *
+ * ------------------ */
+
+/* Points (w = 1) in array of structures layout */
+void f_mat4_transform_aos_ref(const struct t_mat4 *a, const struct t_vec3 *in, struct t_vec4 *out, unsigned long n) {
+	const float *m = a->m;
+	for(unsigned long i = 0; i < n; ++i) {
+		const struct t_vec3 p = in[i];
+		out[i] = (struct t_vec4){
+			m[0]*p.x + m[4]*p.y + m[8]*p.z + m[12],
+			m[1]*p.x + m[5]*p.y + m[9]*p.z + m[13],
+			m[2]*p.x + m[6]*p.y + m[10]*p.z + m[14],
+			m[3]*p.x + m[7]*p.y + m[11]*p.z + m[15],
+		};
+	}
+}
+
+void f_mat4_transform_aos(const struct t_mat4 *a, const struct t_vec3 *in, struct t_vec4 *out, unsigned long n) {
+#ifdef VM_SSE
+	const __m128 c0 = _mm_load_ps(a->m), c1 = _mm_load_ps(a->m + 4);
+	const __m128 c2 = _mm_load_ps(a->m + 8), c3 = _mm_load_ps(a->m + 12);
+
+	for(unsigned long i = 0; i < n; ++i) {
+		__m128 r = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(in[i].x)));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(in[i].z)));
+		_mm_store_ps(&out[i].x, r);
+	}
+#else
+	f_mat4_transform_aos_ref(a, in, out, n);
+#endif
+}
+
+/* Points (w = 1) in structure of arrays layout */
+void f_mat4_transform_soa_ref(const struct t_mat4 *a, struct t_soa3 in, struct t_soa4 out, unsigned long n) {
+	const float *m = a->m;
+	for(unsigned long i = 0; i < n; ++i) {
+		const float x = in.x[i], y = in.y[i], z = in.z[i];
+		out.x[i] = m[0]*x + m[4]*y + m[8]*z + m[12];
+		out.y[i] = m[1]*x + m[5]*y + m[9]*z + m[13];
+		out.z[i] = m[2]*x + m[6]*y + m[10]*z + m[14];
+		out.w[i] = m[3]*x + m[7]*y + m[11]*z + m[15];
+	}
+}
+
+#ifdef VM_X86
+/* 8 points per iteration, one row of the matrix per output array */
+__attribute__((target("avx2,fma")))
+static void f_mat4_transform_soa_avx2(const struct t_mat4 *a, struct t_soa3 in, struct t_soa4 out, unsigned long n) {
+	const float *m = a->m;
+	__m256 r[4][4];
+	for(int row = 0; row < 4; ++row)
+		for(int c = 0; c < 4; ++c)
+			r[row][c] = _mm256_set1_ps(m[c*4 + row]);
+
+	float* const o[4] = { out.x, out.y, out.z, out.w };
+	unsigned long i = 0;
+	for(; i + 8 <= n; i += 8) {
+		const __m256 x = _mm256_loadu_ps(in.x + i), y = _mm256_loadu_ps(in.y + i), z = _mm256_loadu_ps(in.z + i);
+		for(int row = 0; row < 4; ++row) {
+			__m256 v = _mm256_fmadd_ps(r[row][0], x, r[row][3]);
+			v = _mm256_fmadd_ps(r[row][1], y, v);
+			v = _mm256_fmadd_ps(r[row][2], z, v);
+			_mm256_storeu_ps(o[row] + i, v);
+		}
+	}
+
+	const struct t_soa3 tin = { in.x + i, in.y + i, in.z + i };
+	const struct t_soa4 tout = { out.x + i, out.y + i, out.z + i, out.w + i };
+	f_mat4_transform_soa_ref(a, tin, tout, n - i);
+}
+#endif
+
+#ifdef VM_X86
+static int vm_avx2;
+static pthread_once_t vm_once = PTHREAD_ONCE_INIT;
+
+static void f_vecmath_setup(void) {
+	vm_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#endif
+
+/* Whether the AVX2 + FMA paths are used (checked once, from any thread) */
+int f_vecmath_avx2(void) {
+#ifdef VM_X86
+	pthread_once(&vm_once, f_vecmath_setup);
+	return vm_avx2;
+#else
+	return 0;
+#endif
+}
+
+void f_mat4_transform_soa(const struct t_mat4 *a, struct t_soa3 in, struct t_soa4 out, unsigned long n) {
+#ifdef VM_X86
+	if(f_vecmath_avx2()) {
+		f_mat4_transform_soa_avx2(a, in, out, n);
+		return;
+	}
+#endif
+	f_mat4_transform_soa_ref(a, in, out, n);
+}
@@ -0,0 +1,60 @@
+#ifndef __H__VECMATH_H___
+#define __H__VECMATH_H___
+
+/* Vector, matrix and quaternion math for the transform pipeline */
+/* Matrices are column major (as OpenGL expects): m[col * 4 + row] */
+/* SSE is used where available for mat4, vec4 and quaternion operations and */
+/* the AoS batch transform (vec3 is scalar), the SoA batch transform uses AVX2 */
+/* + FMA when the CPU supports it; the *_ref functions are the scalar reference path */
+
+#define VM_ALIGN __attribute__((aligned(16)))
+
+struct t_vec3 { float x, y, z; };
+struct t_vec4 { float x, y, z, w; } VM_ALIGN;
+struct t_quat { float x, y, z, w; } VM_ALIGN;
+struct t_mat4 { float m[16]; } VM_ALIGN;
+
+/* Points in structure of arrays layout, for batched transforms */
+struct t_soa3 { float *x, *y, *z; };
+struct t_soa4 { float *x, *y, *z, *w; };
+
+struct t_vec3 f_vec3_add(struct t_vec3, struct t_vec3);
+struct t_vec3 f_vec3_sub(struct t_vec3, struct t_vec3);
+struct t_vec3 f_vec3_scale(struct t_vec3, float);
+float f_vec3_dot(struct t_vec3, struct t_vec3);
+struct t_vec3 f_vec3_cross(struct t_vec3, struct t_vec3);
+float f_vec3_len(struct t_vec3);
+struct t_vec3 f_vec3_norm(struct t_vec3);
+
+struct t_vec4 f_vec4_add(struct t_vec4, struct t_vec4);
+struct t_vec4 f_vec4_scale(struct t_vec4, float);
+float f_vec4_dot(struct t_vec4, struct t_vec4);
+
+struct t_mat4 f_mat4_identity(void);
+struct t_mat4 f_mat4_mul(const struct t_mat4 *, const struct t_mat4 *);
+struct t_mat4 f_mat4_mul_ref(const struct t_mat4 *, const struct t_mat4 *);
+struct t_vec4 f_mat4_mulv(const struct t_mat4 *, struct t_vec4);
+struct t_mat4 f_mat4_transpose(const struct t_mat4 *);
+struct t_mat4 f_mat4_inverse(const struct t_mat4 *);
+struct t_mat4 f_mat4_translate(struct t_vec3);
+struct t_mat4 f_mat4_scale(struct t_vec3);
+struct t_mat4 f_mat4_trs(struct t_vec3, struct t_quat, struct t_vec3);
+struct t_mat4 f_mat4_perspective(float, float, float, float);
+struct t_mat4 f_mat4_lookat(struct t_vec3, struct t_vec3, struct t_vec3);
+
+struct t_quat f_quat_identity(void);
+struct t_quat f_quat_axisangle(struct t_vec3, float);
+struct t_quat f_quat_mul(struct t_quat, struct t_quat);
+struct t_quat f_quat_norm(struct t_quat);
+struct t_quat f_quat_slerp(struct t_quat, struct t_quat, float);
+struct t_vec3 f_quat_rotate(struct t_quat, struct t_vec3);
+struct t_mat4 f_quat_mat4(struct t_quat);
+
+void f_mat4_transform_aos(const struct t_mat4 *, const struct t_vec3 *, struct t_vec4 *, unsigned long);
+void f_mat4_transform_aos_ref(const struct t_mat4 *, const struct t_vec3 *, struct t_vec4 *, unsigned long);
+void f_mat4_transform_soa(const struct t_mat4 *, struct t_soa3, struct t_soa4, unsigned long);
+void f_mat4_transform_soa_ref(const struct t_mat4 *, struct t_soa3, struct t_soa4, unsigned long);
+
+int f_vecmath_avx2(void);
+
+#endif
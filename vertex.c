@@ -0,0 +1,207 @@
+#include <epoxy/gl.h>
+
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "vertex.h"
+
+/* References
+ * ----------
+ * OpenGL 4.6 core specification [10.3.8 Vertex Attributes, 2.3.5 Fixed-Point Data Conversions]
+ * "https://registry.khronos.org/OpenGL/specs/gl/glspec46.core.pdf"
+ */
+
+/* GL type, normalization and component size of each storage type */
+static const struct {
+	unsigned int gltype;
+	unsigned char normalized, size;
+} vtypes[VT_COUNT] = {
+	[VT_F32]  = { GL_FLOAT,                  GL_FALSE, 4 },
+	[VT_F16]  = { GL_HALF_FLOAT,             GL_FALSE, 2 },
+	[VT_I32]  = { GL_INT,                    GL_FALSE, 4 },
+	[VT_SN16] = { GL_SHORT,                  GL_TRUE,  2 },
+	[VT_UN8]  = { GL_UNSIGNED_BYTE,          GL_TRUE,  1 },
+	[VT_SN10] = { GL_INT_2_10_10_10_REV,     GL_TRUE,  0 },
+};
+
+/* Legacy layout of struct vert (16 bytes) */
+const struct t_vformat vfmt_vert = {
+	.stride = sizeof(struct vert), .nattrs = 2,
+	.attr = {
+		{ VSEM_POS, 0, VT_I32, 3, offsetof(struct vert, pos) },
+		{ VSEM_CLR, 1, VT_UN8, 3, offsetof(struct vert, clr) },
+	}
+};
+
+/* snorm16 position (padded to 8 bytes), RGBA8 color - 12 bytes, the smallest */
+/* layout keeping 16 bit xyz, as attributes should start 4 byte aligned */
+const struct t_vformat vfmt_compact = {
+	.stride = 12, .nattrs = 2,
+	.attr = {
+		{ VSEM_POS, 0, VT_SN16, 3, 0 },
+		{ VSEM_CLR, 1, VT_UN8, 4, 8 },
+	}
+};
+
+/* As above with a 2_10_10_10 normal at location 2 - 16 bytes */
+const struct t_vformat vfmt_compact_nrm = {
+	.stride = 16, .nattrs = 3,
+	.attr = {
+		{ VSEM_POS, 0, VT_SN16, 3, 0 },
+		{ VSEM_CLR, 1, VT_UN8, 4, 8 },
+		{ VSEM_NRM, 2, VT_SN10, 4, 12 },
+	}
+};
+
+/* Half float position (padded to 8 bytes), RGBA8 color - 12 bytes */
+const struct t_vformat vfmt_half = {
+	.stride = 12, .nattrs = 2,
+	.attr = {
+		{ VSEM_POS, 0, VT_F16, 3, 0 },
+		{ VSEM_CLR, 1, VT_UN8, 4, 8 },
+	}
+};
+
+/* snorm16 xy position, RGBA8 color - 8 bytes, half of struct vert, for meshes */
+/* lying in a z plane (z is restored by the dequantization bias) */
+const struct t_vformat vfmt_flat = {
+	.stride = 8, .nattrs = 2,
+	.attr = {
+		{ VSEM_POS, 0, VT_SN16, 2, 0 },
+		{ VSEM_CLR, 1, VT_UN8, 4, 4 },
+	}
+};
+
+/* Check a format read from a file, returns -1 if an attribute has an unknown */
+/* semantic or type, an invalid component count or location, or lies outside */
+/* the stride */
+int f_vformat_check(const struct t_vformat *fmt) {
+	if(!fmt->stride || fmt->nattrs > VFMT_MAXATTRS) return -1;
+
+	for(int i = 0; i < fmt->nattrs; ++i) {
+		const struct t_vattr *a = &fmt->attr[i];
+		if(a->sem > VSEM_CLR || a->type >= VT_COUNT || a->loc >= VFMT_MAXLOCS) return -1;
+		if(a->comps < 1 || a->comps > 4 || (a->type == VT_SN10 && a->comps != 4)) return -1;
+
+		const unsigned int size = a->type == VT_SN10 ? 4 : (unsigned int)vtypes[a->type].size * a->comps;
+		if(a->offset + size > fmt->stride) return -1;
+	}
+	return 0;
+}
+
+/* Set up attributes for the buffer bound to GL_ARRAY_BUFFER */
+void f_vformat_apply(const struct t_vformat *fmt) {
+	for(int i = 0; i < fmt->nattrs; ++i) {
+		const struct t_vattr *a = &fmt->attr[i];
+		glEnableVertexAttribArray(a->loc);
+		glVertexAttribPointer(a->loc, a->comps, vtypes[a->type].gltype, vtypes[a->type].normalized,
+			fmt->stride, (void*)(uintptr_t)a->offset);
+	}
+}
+
+/* Round to nearest even, handles overflow to infinity, NaN and denormals */
+uint16_t f_f32_to_f16(float f) {
+	uint32_t x;
+	memcpy(&x, &f, sizeof x);
+
+	const uint16_t sign = (x >> 16) & 0x8000;
+	const uint32_t absx = x & 0x7FFFFFFF;
+
+	if(absx >= 0x7F800000) return sign | 0x7C00 | (absx > 0x7F800000 ? 0x200 : 0);
+	if(absx >= 0x477FF000) return sign | 0x7C00;
+
+	if(absx < 0x38800000) {
+		/* Denormal half: align mantissa (with implicit bit) to 2^-24 units */
+		if(absx < 0x33000000) return sign;
+		const uint32_t m = (absx & 0x7FFFFF) | 0x800000;
+		const int shift = 126 - (absx >> 23);
+		const uint32_t r = m >> shift, rem = m & ((1u << shift) - 1), half = 1u << (shift - 1);
+		return sign | (r + (rem > half || (rem == half && (r & 1))));
+	}
+
+	const uint32_t r = absx - 0x38000000;
+	return sign | ((r + 0xFFF + ((r >> 13) & 1)) >> 13);
+}
+
+static int32_t f_snorm(float v, int bits) {
+	const float m = (1 << (bits - 1)) - 1;
+	v = v < -1 ? -1 : v > 1 ? 1 : v;
+	return (int32_t)lrintf(v * m);
+}
+
+static uint8_t f_unorm8(float v) {
+	v = v < 0 ? 0 : v > 1 ? 1 : v;
+	return (uint8_t)lrintf(v * 255);
+}
+
+/* Quantize vertices into the format, writing n * stride bytes to out */
+/* Positions in normalized or half float formats are remapped to the mesh */
+/* bounds (half floats then keep their precision away from the origin), */
+/* the dequantization is returned in q (identity otherwise) */
+void f_vformat_encode(
+	const struct t_vformat *fmt,
+	const struct t_vsrc *src, unsigned int n,
+	void *out, struct t_vquant *q
+) {
+	float lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+	for(unsigned int i = 0; i < n; ++i)
+		for(int c = 0; c < 3; ++c) {
+			if(!i || src[i].pos[c] < lo[c]) lo[c] = src[i].pos[c];
+			if(!i || src[i].pos[c] > hi[c]) hi[c] = src[i].pos[c];
+		}
+
+	int quantize = 0;
+	for(int i = 0; i < fmt->nattrs; ++i)
+		if(fmt->attr[i].sem == VSEM_POS && (vtypes[fmt->attr[i].type].normalized || fmt->attr[i].type == VT_F16)) quantize = 1;
+
+	for(int c = 0; c < 3; ++c) {
+		const float ext = (hi[c] - lo[c]) / 2;
+		q->scale[c] = quantize && ext > 0 ? ext : 1;
+		q->bias[c] = quantize ? (hi[c] + lo[c]) / 2 : 0;
+	}
+
+	unsigned char *dst = out;
+	memset(dst, 0, (size_t)n * fmt->stride);
+
+	for(unsigned int i = 0; i < n; ++i, dst += fmt->stride) {
+		for(int j = 0; j < fmt->nattrs; ++j) {
+			const struct t_vattr *a = &fmt->attr[j];
+			unsigned char *p = dst + a->offset;
+
+			float v[4] = { 0, 0, 0, 1 };
+			const float *s = a->sem == VSEM_POS ? src[i].pos : a->sem == VSEM_NRM ? src[i].nrm : src[i].clr;
+			memcpy(v, s, (a->sem == VSEM_CLR ? 4 : 3) * sizeof *v);
+			if(a->sem == VSEM_POS)
+				for(int c = 0; c < 3; ++c) v[c] = (v[c] - q->bias[c]) / q->scale[c];
+
+			if(a->type == VT_SN10) {
+				uint32_t packed = 0;
+				for(int c = 0; c < 3; ++c) packed |= (uint32_t)(f_snorm(v[c], 10) & 0x3FF) << (10 * c);
+				packed |= (uint32_t)(f_snorm(a->comps > 3 ? v[3] : 0, 2) & 0x3) << 30;
+				memcpy(p, &packed, 4);
+				continue;
+			}
+
+			for(int c = 0; c < a->comps; ++c, p += vtypes[a->type].size) {
+				switch(a->type) {
+					case VT_F32: memcpy(p, &v[c], 4); break;
+					case VT_F16: { uint16_t h = f_f32_to_f16(v[c]); memcpy(p, &h, 2); } break;
+					case VT_I32: { int32_t x = (int32_t)lrintf(v[c]); memcpy(p, &x, 4); } break;
+					case VT_SN16: { int16_t x = f_snorm(v[c], 16); memcpy(p, &x, 2); } break;
+					case VT_UN8: *p = f_unorm8(v[c]); break;
+				}
+			}
+		}
+	}
+}
+
+/* Widen legacy vertices (normal is +z, alpha is opaque) */
+void f_vert_to_src(const struct vert *v, unsigned int n, struct t_vsrc *out) {
+	for(unsigned int i = 0; i < n; ++i)
+		out[i] = (struct t_vsrc){
+			{ v[i].pos[0], v[i].pos[1], v[i].pos[2] },
+			{ 0, 0, 1 },
+			{ v[i].clr[0] / 255.0f, v[i].clr[1] / 255.0f, v[i].clr[2] / 255.0f, 1 }
+		};
+}
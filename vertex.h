@@ -0,0 +1,62 @@
+#ifndef __H__VERTEX_H___
+#define __H__VERTEX_H___
+
+#include <stdint.h>
+
+struct vert {
+	int32_t pos[3];
+	uint8_t clr[3];
+};
+
+/* Full precision source vertex, input to the quantizing encoder */
+struct t_vsrc {
+	float pos[3], nrm[3], clr[4];
+};
+
+/* What an attribute holds - selects the t_vsrc field it is encoded from */
+enum e_vsem { VSEM_POS, VSEM_NRM, VSEM_CLR };
+
+/* Storage type of an attribute */
+enum e_vtype {
+	VT_F32,    /* float */
+	VT_F16,    /* half float */
+	VT_I32,    /* int32, converted to float unnormalized */
+	VT_SN16,   /* int16, normalized to [-1, 1] */
+	VT_UN8,    /* uint8, normalized to [0, 1] */
+	VT_SN10,   /* GL_INT_2_10_10_10_REV, normalized - always 4 bytes */
+	VT_COUNT
+};
+
+#define VFMT_MAXATTRS 4
+
+/* Attribute locations a format may use - the shaders declare theirs below this */
+#define VFMT_MAXLOCS 4
+
+struct t_vattr {
+	uint8_t sem, loc, type, comps, offset;
+};
+
+/* Vertex layout descriptor - drives both GL attribute setup and encoding */
+struct t_vformat {
+	uint8_t stride, nattrs;
+	struct t_vattr attr[VFMT_MAXATTRS];
+};
+
+/* Dequantization of positions: object position = stored * scale + bias */
+struct t_vquant {
+	float scale[3], bias[3];
+};
+
+extern const struct t_vformat vfmt_vert;
+extern const struct t_vformat vfmt_compact;
+extern const struct t_vformat vfmt_flat;
+extern const struct t_vformat vfmt_compact_nrm;
+extern const struct t_vformat vfmt_half;
+
+int f_vformat_check(const struct t_vformat *);
+void f_vformat_apply(const struct t_vformat *);
+void f_vformat_encode(const struct t_vformat *, const struct t_vsrc *, unsigned int, void *, struct t_vquant *);
+void f_vert_to_src(const struct vert *, unsigned int, struct t_vsrc *);
+uint16_t f_f32_to_f16(float);
+
+#endif
@@ -1,30 +1,82 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <stdlib.h>
+
+#include "clock.h"
 #include "window.h"
 
 /* References
  * ----------
  * GLFW documentation [window guide]
  * "https://www.glfw.org/docs/latest/window_guide.html"
+ * D. Vyukov, "Single-Producer/Single-Consumer Queue"
+ * "https://www.1024cores.net/home/lock-free-algorithms/queues/unbounded-spsc-queue"
+ * E. Rigtorp, "Optimizing a ring buffer for throughput"
+ * "https://rigtorp.se/ringbuffer/"
  */
 
 
-/* Append input events to queue to handle later */
-void f_iqappend(struct t_glfw_winstate *wst, struct t_glfw_inputevent *ev) {
-	if(wst->iqoverflow || !wst->iq) return;
+/* ----------- *
+ * Input queue *
+ * ----------- */
+
+/* Capacity must be a power of two, returns -1 otherwise or if out of memory */
+int f_iq_init(struct t_inputqueue *q, unsigned int capacity) {
+	if(!capacity || capacity & (capacity - 1) || capacity > 1u << 31) return -1;
+
+	q->ev = malloc(capacity * sizeof *q->ev);
+	if(!q->ev) return -1;
+
+	atomic_init(&q->head, 0), atomic_init(&q->tail, 0), atomic_init(&q->dropped, 0);
+	q->tailcache = q->headcache = 0;
+	q->mask = capacity - 1;
+	return 0;
+}
+
+void f_iq_destroy(struct t_inputqueue *q) {
+	free(q->ev);
+	q->ev = NULL;
+}
+
+/* Producer side: append an event to handle later, returns -1 (and counts it */
+/* as dropped) if the queue is full or was never initialized */
+/* The tail is only reloaded when the cached copy says the queue is full */
+int f_iqappend(struct t_inputqueue *q, const struct t_glfw_inputevent *ev) {
+	if(!q->ev) return -1;
+
+	const unsigned int h = atomic_load_explicit(&q->head, memory_order_relaxed);
+	if(h - q->tailcache > q->mask) {
+		q->tailcache = atomic_load_explicit(&q->tail, memory_order_acquire);
+		if(h - q->tailcache > q->mask) {
+			atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+			return -1;
+		}
+	}
+
+	q->ev[h & q->mask] = *ev;
+	atomic_store_explicit(&q->head, h + 1, memory_order_release);
+	return 0;
+}
+
+/* Consumer side: move up to max queued events to out, oldest first, */
+/* with at most one acquire of the head and one release of the tail per batch */
+unsigned int f_iqdrain(struct t_inputqueue *q, struct t_glfw_inputevent *out, unsigned int max) {
+	if(!q->ev) return 0;
+
+	const unsigned int t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	if(q->headcache - t < max) q->headcache = atomic_load_explicit(&q->head, memory_order_acquire);
 
-	wst->iq [(wst->iqstart + wst->iqlength) % wst->iqmaxsz] = *ev;
-	wst->iqlength += 1;
-	if(wst->iqlength >= wst->iqmaxsz) wst->iqoverflow = 1;
+	const unsigned int avail = q->headcache - t, n = avail < max ? avail : max;
+	for(unsigned int i = 0; i < n; ++i) out[i] = q->ev[(t + i) & q->mask];
 
-	wst->iqstart %= wst->iqmaxsz;
+	if(n) atomic_store_explicit(&q->tail, t + n, memory_order_release);
+	return n;
 }
 
-void f_iqpop(struct t_glfw_inputevent *ev, struct t_glfw_winstate *wst) {
-	*ev = wst->iq[wst->iqstart];
-	wst->iqstart = (wst->iqstart + 1) % wst->iqmaxsz;
-	wst->iqlength --;
+/* Consumer side: a single event, returns 0 if the queue is empty */
+int f_iqpop(struct t_inputqueue *q, struct t_glfw_inputevent *ev) {
+	return f_iqdrain(q, ev, 1) != 0;
 }
 
 int f_event_cmp_key(struct t_glfw_inputevent *ev, int key, int mods, int action) {
@@ -34,6 +86,45 @@ int f_event_cmp_key(struct t_glfw_inputevent *ev, int key, int mods, int action)
 }
 
 
+/* --------------------- *
+ * Window state snapshot *
+ * --------------------- */
+
+static void f_winshare_fill(struct t_winsnapshot *s, const struct t_glfw_winstate *wst) {
+	*s = (struct t_winsnapshot){
+		.width = wst->width, .height = wst->height,
+		.mx = wst->mx, .my = wst->my, .time = wst->time,
+		.resizes = wst->resizes, .runstate = wst->runstate
+	};
+}
+
+int f_winshare_init(struct t_winshare *sh, const struct t_glfw_winstate *wst) {
+	f_winshare_fill(&sh->buf[0], wst);
+	sh->buf[1] = sh->buf[0];
+	sh->front = 0;
+	return pthread_mutex_init(&sh->lock, NULL) ? -1 : 0;
+}
+
+void f_winshare_destroy(struct t_winshare *sh) {
+	pthread_mutex_destroy(&sh->lock);
+}
+
+/* Event thread only: the back copy is never read by the other side */
+void f_winshare_publish(struct t_winshare *sh, const struct t_glfw_winstate *wst) {
+	f_winshare_fill(&sh->buf[sh->front ^ 1], wst);
+
+	pthread_mutex_lock(&sh->lock);
+	sh->front ^= 1;
+	pthread_mutex_unlock(&sh->lock);
+}
+
+void f_winshare_read(struct t_winshare *sh, struct t_winsnapshot *s) {
+	pthread_mutex_lock(&sh->lock);
+	*s = sh->buf[sh->front];
+	pthread_mutex_unlock(&sh->lock);
+}
+
+
 /* ----------------------- *
  * GLFW Callback functions *
  * ----------------------- */
@@ -46,10 +137,10 @@ void f_glfw_callback_key(GLFWwindow *window, int key, int scancode, int action,
 	struct t_glfw_inputevent e = {
 		.type = IEV_KEYPRESS,
 		.data = { .key_ev = { key, action, mods } },
-		.mx = wst->mx, .my = wst->my, .time = wst->time
+		.mx = wst->mx, .my = wst->my, .time = f_clock_now()
 	};
 
-	f_iqappend(wst, &e);
+	f_iqappend(&wst->iq, &e);
 
 	/* Scancode remains unused */
 	(void)scancode;
@@ -69,10 +160,10 @@ void f_glfw_callback_mouseclick(GLFWwindow *window, int button, int action, int
 	struct t_glfw_inputevent e = {
 		.type = IEV_MOUSEBUTTON,
 		.data = { .mb_ev = { button, action, mods } },
-		.mx = wst->mx, .my = wst->my, .time = wst->time
+		.mx = wst->mx, .my = wst->my, .time = f_clock_now()
 	};
 
-	f_iqappend(wst, &e);
+	f_iqappend(&wst->iq, &e);
 }
 
 /* Scroll callback: add event to queue */
@@ -82,16 +173,17 @@ void f_glfw_callback_scroll(GLFWwindow* window, double xoffset, double yoffset)
 	struct t_glfw_inputevent e = {
 		.type = IEV_SCROLL,
 		.data = { .scroll_ev = { xoffset, yoffset } },
-		.mx = wst->mx, .my = wst->my, .time = wst->time
+		.mx = wst->mx, .my = wst->my, .time = f_clock_now()
 	};
 
-	f_iqappend(wst, &e);
+	f_iqappend(&wst->iq, &e);
 }
 
 /* Callback for framebuffer resize events (i.e window resize events) */
 void f_glfw_callback_fbresize(GLFWwindow *window, int width, int height) {
 	struct t_glfw_winstate* const wst = glfwGetWindowUserPointer(window);
 	wst->width = width, wst->height = height, wst->szrefresh = 1;
+	wst->resizes++;
 }
 
 /* Callback for window close event */
@@ -167,3 +259,37 @@ void* f_glfw_initwin (
 	return win;
 }
 
+
+/* Create a hidden window whose context shares objects with the given window */
+/* (for building GL objects on another thread) - call from the main thread */
+void* f_glfw_initshared(void* win) {
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_MAXIMIZED, GLFW_FALSE);
+
+	void* const shared = glfwCreateWindow(1, 1, "", NULL, win);
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	return shared;
+}
+
+/* Set the swap interval of the current context, -1 (adaptive vsync) needs */
+/* swap_control_tear and falls back to 1 - returns the interval set */
+int f_glfw_swapinterval(int interval) {
+	if(interval < 0 && !glfwExtensionSupported("GLX_EXT_swap_control_tear")
+	&& !glfwExtensionSupported("WGL_EXT_swap_control_tear")) interval = 1;
+
+	glfwSwapInterval(interval);
+	return interval;
+}
+
+/* Refresh rate of the primary monitor, 60 Hz if unknown - call from the main thread */
+double f_glfw_refreshrate(void) {
+	GLFWmonitor* mon = glfwGetPrimaryMonitor();
+	const GLFWvidmode* mode = mon ? glfwGetVideoMode(mon) : NULL;
+	return mode && mode->refreshRate > 0 ? mode->refreshRate : 60;
+}
+
+/* Make a window's context current on the calling thread (NULL releases it) */
+void f_glfw_makecurrent(void* win) {
+	glfwMakeContextCurrent(win);
+}
@@ -1,6 +1,9 @@
 #ifndef __H__WINDOW_H___
 #define __H__WINDOW_H___
 
+#include <stdatomic.h>
+#include <pthread.h>
+
 enum e_wintype { WIN_DEF, WIN_MAX, WIN_FSCR };
 
 /* Different input data for key press, mouse button press, and scroll events */
@@ -21,6 +24,7 @@ enum e_inputevent_type {
 };
 
 /* Tagged union for storing multiple types of input events in a single queue */
+/* Events are stamped in their callback, in seconds on CLOCK_MONOTONIC (f_clock_now) */
 struct t_glfw_inputevent {
 	union t_glfw_inputevent_u_ {
 		struct t_glfw_inputevent_key
@@ -34,11 +38,26 @@ struct t_glfw_inputevent {
 	enum e_inputevent_type type;
 };
 
+/* Lock-free ring of input events from one producer (the GLFW callbacks) to one */
+/* consumer (the render loop) - capacity is a power of two, head and tail count */
+/* events forever and are each written by one side only, on separate cache lines, */
+/* next to that side's cached copy of the other index */
+struct t_inputqueue {
+	_Alignas(64) atomic_uint head;
+	unsigned int tailcache;
+	atomic_ulong dropped;
+
+	_Alignas(64) atomic_uint tail;
+	unsigned int headcache;
+
+	_Alignas(64) unsigned int mask;
+	struct t_glfw_inputevent *ev;
+};
+
 /* Global structure for the purpose of being modified by GLFW callback functions */
 struct t_glfw_winstate {
 	unsigned char szrefresh:1;
 	unsigned char runstate:1;
-	unsigned char iqoverflow:1;
 
 	int width, height;
 
@@ -46,16 +65,47 @@ struct t_glfw_winstate {
 	double mx, my;
 	double time;
 
-	unsigned int iqstart, iqlength, iqmaxsz;
-	struct t_glfw_inputevent *iq;
+	/* Framebuffer size changes so far, for readers on other threads */
+	unsigned int resizes;
+
+	struct t_inputqueue iq;
+};
+
+/* The part of the window state the render thread reads once per frame */
+struct t_winsnapshot {
+	int width, height;
+	double mx, my, time;
+	unsigned int resizes;
+	unsigned char runstate;
+};
+
+/* Window state handed from the event thread to the render thread: the event */
+/* thread fills the back copy without the lock and swaps it in, the lock only */
+/* covers the swap and the render thread's copy of the front one */
+struct t_winshare {
+	struct t_winsnapshot buf[2];
+	unsigned int front;
+	pthread_mutex_t lock;
 };
 
-void f_iqpop(struct t_glfw_inputevent *, struct t_glfw_winstate *);
+int f_iq_init(struct t_inputqueue *, unsigned int);
+void f_iq_destroy(struct t_inputqueue *);
+int f_iqappend(struct t_inputqueue *, const struct t_glfw_inputevent *);
+unsigned int f_iqdrain(struct t_inputqueue *, struct t_glfw_inputevent *, unsigned int);
+int f_iqpop(struct t_inputqueue *, struct t_glfw_inputevent *);
+int f_winshare_init(struct t_winshare *, const struct t_glfw_winstate *);
+void f_winshare_destroy(struct t_winshare *);
+void f_winshare_publish(struct t_winshare *, const struct t_glfw_winstate *);
+void f_winshare_read(struct t_winshare *, struct t_winsnapshot *);
 int f_event_cmp_key(struct t_glfw_inputevent *, int, int, int);
 void* f_glfw_initwin (
 	const char*, int, int,
 	enum e_wintype, struct t_glfw_winstate *
 );
+void* f_glfw_initshared(void *);
+void f_glfw_makecurrent(void *);
+int f_glfw_swapinterval(int);
+double f_glfw_refreshrate(void);
 
 
 #endif